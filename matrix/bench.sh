@@ -0,0 +1,6 @@
+#!/bin/bash
+
+set -e
+
+g++ -std=c++17 -O2 -DNDEBUG -I./ bench/*.cpp src/*.cpp -o matrix_bench -pthread
+./matrix_bench "$@"
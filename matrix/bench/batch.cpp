@@ -0,0 +1,84 @@
+#include <string>
+#include <vector>
+#include "bench/bench.h"
+#include "src/matrix_batch.h"
+
+using task::Matrix;
+using task::MatrixBatch;
+
+namespace {
+
+void Compare(const std::string &name, size_t count, double loop, double batch) {
+  bench::Report("loop " + name, loop / count, "ns/matrix", loop / count * 1e9);
+  bench::Report("batch " + name, batch / count, "x faster", loop / batch);
+}
+
+void Run(size_t count, size_t n) {
+  std::vector<Matrix> as, bs;
+  for (size_t i = 0; i < count; ++i) {
+    as.push_back(bench::RandomMatrix(n, n));
+    bs.push_back(bench::RandomMatrix(n, n));
+  }
+  MatrixBatch a(as), b(bs);
+  std::vector<Matrix> results(count);
+  std::vector<double> scalars(count);
+  std::string shape = std::to_string(count) + " x " + std::to_string(n) + "x" + std::to_string(n);
+
+  Compare("* " + shape, count, bench::Measure([&] {
+    for (size_t i = 0; i < count; ++i) {
+      results[i] = as[i] * bs[i];
+    }
+    bench::DoNotOptimize(results[0].data());
+  }), bench::Measure([&] {
+    MatrixBatch c = a * b;
+    bench::DoNotOptimize(c.lanes(0, 0));
+  }));
+
+  Compare("+ " + shape, count, bench::Measure([&] {
+    for (size_t i = 0; i < count; ++i) {
+      results[i] = as[i] + bs[i];
+    }
+    bench::DoNotOptimize(results[0].data());
+  }), bench::Measure([&] {
+    MatrixBatch c = a + b;
+    bench::DoNotOptimize(c.lanes(0, 0));
+  }));
+
+  Compare("transposed() " + shape, count, bench::Measure([&] {
+    for (size_t i = 0; i < count; ++i) {
+      results[i] = as[i].transposed();
+    }
+    bench::DoNotOptimize(results[0].data());
+  }), bench::Measure([&] {
+    MatrixBatch c = a.transposed();
+    bench::DoNotOptimize(c.lanes(0, 0));
+  }));
+
+  Compare("trace() " + shape, count, bench::Measure([&] {
+    for (size_t i = 0; i < count; ++i) {
+      scalars[i] = as[i].trace();
+    }
+    bench::DoNotOptimize(scalars.data());
+  }), bench::Measure([&] {
+    auto traces = a.trace();
+    bench::DoNotOptimize(traces.data());
+  }));
+
+  Compare("det() " + shape, count, bench::Measure([&] {
+    for (size_t i = 0; i < count; ++i) {
+      scalars[i] = as[i].det();
+    }
+    bench::DoNotOptimize(scalars.data());
+  }), bench::Measure([&] {
+    auto dets = a.det();
+    bench::DoNotOptimize(dets.data());
+  }));
+}
+
+} // namespace
+
+BENCHMARK(batch) {
+  for (size_t n : {2, 3, 4, 8, 16}) {
+    Run(20000, n);
+  }
+}
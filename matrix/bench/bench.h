@@ -0,0 +1,132 @@
+#pragma once
+
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+#include "src/matrix.h"
+#include "src/storage.h"
+
+namespace bench {
+
+using BenchFunction = void (*)();
+
+struct Benchmark {
+  const char *name;
+  BenchFunction run;
+};
+
+inline std::vector<Benchmark> &Registry() {
+  static std::vector<Benchmark> registry;
+  return registry;
+}
+
+struct Registrar {
+  Registrar(const char *name, BenchFunction run) {
+    Registry().push_back({name, run});
+  }
+};
+
+// One reported measurement, kept for matrix_bench --json.
+struct Result {
+  std::string benchmark;  // filled in by main.cpp
+  std::string name;
+  double ns_per_op;
+  std::string unit;    // of value; empty when there is none
+  double value;
+  double gflops;       // negative when the operation has no flop count
+  double allocations;  // per operation; negative when not counted
+};
+
+inline std::vector<Result> &Results() {
+  static std::vector<Result> results;
+  return results;
+}
+
+// Calls to the global operator new since start; counted by main.cpp.
+size_t HeapAllocations();
+
+// Heap allocations plus Matrix buffer requests made by one call of fn.
+// Buffers are counted through the pool statistics, so they are seen
+// under the default POOLED policy even when the pool serves them.
+template <class F>
+double CountAllocations(F &&fn) {
+  size_t before = HeapAllocations() + task::storage::poolStats().requests;
+  fn();
+  return static_cast<double>(HeapAllocations() + task::storage::poolStats().requests - before);
+}
+
+// Keeps the compiler from optimizing away a computed value.
+template <class T>
+void DoNotOptimize(const T &value) {
+  asm volatile("" : : "r,m"(value) : "memory");
+}
+
+// Calls fn until at least min_seconds have passed and returns the average
+// time of a single call in seconds. A single slow call is measured as is.
+// The clock is read once per batch of calls, doubling the batch each time,
+// so that nanosecond-scale operations are not dominated by reading it.
+template <class F>
+double Measure(F &&fn, double min_seconds = 0.2) {
+  using Clock = std::chrono::steady_clock;
+  auto start = Clock::now();
+  fn();
+  double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+  if (elapsed >= min_seconds) {
+    return elapsed;
+  }
+  size_t iterations = 0;
+  start = Clock::now();
+  for (size_t batch = 1; elapsed < min_seconds; batch *= 2) {
+    for (size_t i = 0; i < batch; ++i) {
+      fn();
+    }
+    iterations += batch;
+    elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+  }
+  return elapsed / iterations;
+}
+
+inline task::Matrix RandomMatrix(size_t rows, size_t cols) {
+  static std::mt19937 rand(42);
+  std::uniform_real_distribution<double> dist{-10., 10.};
+  task::Matrix result(rows, cols);
+  for (size_t i = 0; i < rows; ++i) {
+    for (size_t j = 0; j < cols; ++j) {
+      result[i][j] = dist(rand);
+    }
+  }
+  return result;
+}
+
+inline void Report(const std::string &name, double seconds,
+                   const char *unit = nullptr, double value = 0.) {
+  if (unit) {
+    std::printf("%-48s %14.1f ns %12.3f %s\n", name.c_str(), seconds * 1e9, value, unit);
+  } else {
+    std::printf("%-48s %14.1f ns\n", name.c_str(), seconds * 1e9);
+  }
+  Results().push_back({"", name, seconds * 1e9, unit ? unit : "", value, -1., -1.});
+}
+
+// Reports an operation that does flops floating-point operations (0 for
+// none) and allocations allocations per call.
+inline void Record(const std::string &name, double seconds, double flops, double allocations) {
+  double gflops = flops > 0 ? flops / seconds * 1e-9 : -1.;
+  if (gflops >= 0) {
+    std::printf("%-48s %14.1f ns %9.3f GFLOP/s %8.0f allocs\n", name.c_str(), seconds * 1e9,
+                gflops, allocations);
+  } else {
+    std::printf("%-48s %14.1f ns %17s %8.0f allocs\n", name.c_str(), seconds * 1e9, "",
+                allocations);
+  }
+  Results().push_back({"", name, seconds * 1e9, "", 0., gflops, allocations});
+}
+
+} // namespace bench
+
+#define BENCHMARK(name)                                        \
+  static void name();                                          \
+  static bench::Registrar name##_registrar(#name, name);       \
+  static void name()
@@ -0,0 +1,129 @@
+#include <sstream>
+#include <string>
+#include "bench/bench.h"
+
+using task::Matrix;
+namespace bounds = task::bounds;
+
+namespace {
+
+// Element-at-a-time versions of the operations, the way they were written
+// before the algorithms moved to unchecked access, with the policy as a
+// parameter.
+
+template <class Bounds>
+Matrix Transposed(const Matrix &a) {
+  Matrix result(a.colCount(), a.rowCount());
+  for (size_t i = 0; i < a.rowCount(); ++i) {
+    for (size_t j = 0; j < a.colCount(); ++j) {
+      result.set<Bounds>(j, i, a.get<Bounds>(i, j));
+    }
+  }
+  return result;
+}
+
+template <class Bounds>
+double Trace(const Matrix &a) {
+  double result = 0.;
+  for (size_t i = 0; i < a.rowCount(); ++i) {
+    result += a.get<Bounds>(i, i);
+  }
+  return result;
+}
+
+template <class Bounds>
+void Write(std::ostream &output, const Matrix &a) {
+  for (size_t i = 0; i < a.rowCount(); ++i) {
+    for (size_t j = 0; j < a.colCount(); ++j) {
+      output << a.get<Bounds>(i, j) << " ";
+    }
+    output << "\n";
+  }
+}
+
+template <class Bounds>
+void Read(std::istream &input, Matrix &a) {
+  size_t rows, cols;
+  input >> rows >> cols;
+  a = Matrix(rows, cols);
+  for (size_t i = 0; i < rows; ++i) {
+    for (size_t j = 0; j < cols; ++j) {
+      input >> a.get<Bounds>(i, j);
+    }
+  }
+}
+
+template <class F>
+void Run(const std::string &name, F &&fn) {
+  bench::Report(name, bench::Measure(fn));
+}
+
+} // namespace
+
+BENCHMARK(bounds_check) {
+  for (size_t n : {64, 256, 1024}) {
+    std::string shape = " " + std::to_string(n) + "x" + std::to_string(n);
+    Matrix a = bench::RandomMatrix(n, n);
+
+    Run("transposed checked get/set" + shape, [&] {
+      Matrix t = Transposed<bounds::Checked>(a);
+      bench::DoNotOptimize(t.data());
+    });
+    Run("transposed unchecked get/set" + shape, [&] {
+      Matrix t = Transposed<bounds::Unchecked>(a);
+      bench::DoNotOptimize(t.data());
+    });
+    Run("transposed()" + shape, [&] {
+      Matrix t = a.transposed();
+      bench::DoNotOptimize(t.data());
+    });
+
+    Run("trace checked get" + shape, [&] {
+      bench::DoNotOptimize(Trace<bounds::Checked>(a));
+    });
+    Run("trace unchecked get" + shape, [&] {
+      bench::DoNotOptimize(Trace<bounds::Unchecked>(a));
+    });
+    Run("trace()" + shape, [&] {
+      bench::DoNotOptimize(a.trace());
+    });
+
+    Run("write checked get" + shape, [&] {
+      std::ostringstream out;
+      Write<bounds::Checked>(out, a);
+      bench::DoNotOptimize(out.tellp());
+    });
+    Run("write unchecked get" + shape, [&] {
+      std::ostringstream out;
+      Write<bounds::Unchecked>(out, a);
+      bench::DoNotOptimize(out.tellp());
+    });
+    Run("operator<<" + shape, [&] {
+      std::ostringstream out;
+      out << a;
+      bench::DoNotOptimize(out.tellp());
+    });
+
+    std::ostringstream text;
+    text << n << " " << n << "\n" << a;
+    const std::string input = text.str();
+    Run("read checked get" + shape, [&] {
+      std::istringstream in(input);
+      Matrix m;
+      Read<bounds::Checked>(in, m);
+      bench::DoNotOptimize(m.data());
+    });
+    Run("read unchecked get" + shape, [&] {
+      std::istringstream in(input);
+      Matrix m;
+      Read<bounds::Unchecked>(in, m);
+      bench::DoNotOptimize(m.data());
+    });
+    Run("operator>>" + shape, [&] {
+      std::istringstream in(input);
+      Matrix m;
+      in >> m;
+      bench::DoNotOptimize(m.data());
+    });
+  }
+}
@@ -0,0 +1,102 @@
+"""Compares two matrix_bench --json results and flags regressions.
+
+    ./bench.sh --json=current.json suite
+    python3 bench/compare.py bench/baseline.json current.json
+
+A result regresses when its time per operation grows by more than the
+threshold or when it allocates more than before. Exits with status 1 if
+anything regressed, so it can gate a CI job.
+
+Several runs may be given instead of one; each result then takes its
+fastest time across them, which filters out most scheduling noise on
+shared machines. --merge writes such a combination to a file, the way
+bench/baseline.json is made:
+
+    for i in 1 2 3; do ./bench.sh --json=run$i.json suite; done
+    python3 bench/compare.py --merge bench/baseline.json run1.json run2.json run3.json
+
+Timings only compare on the same machine: regenerate the baseline there
+before relying on it.
+"""
+
+import argparse
+import json
+import sys
+
+
+def load(path):
+    with open(path) as f:
+        results = json.load(f)['results']
+    return {(r['benchmark'], r['name']): r for r in results}
+
+
+def load_fastest(paths):
+    """Merges runs, keeping the fastest measurement of every result."""
+    merged = {}
+    for path in paths:
+        for key, result in load(path).items():
+            if key not in merged or result['ns_per_op'] < merged[key]['ns_per_op']:
+                merged[key] = result
+    return merged
+
+
+def save(path, results):
+    with open(path, 'w') as f:
+        f.write('{\n  "results": [\n')
+        f.write(',\n'.join('    ' + json.dumps(r) for r in results.values()))
+        f.write('\n  ]\n}\n')
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split('\n')[0])
+    parser.add_argument('baseline', nargs='?')
+    parser.add_argument('current', nargs='+')
+    parser.add_argument('--merge', metavar='OUT',
+                        help='write the fastest of the given runs to OUT and exit')
+    parser.add_argument('--threshold', type=float, default=0.15,
+                        help='allowed relative slowdown (default 0.15)')
+    parser.add_argument('--all', action='store_true',
+                        help='print unchanged results too')
+    args = parser.parse_args()
+
+    if args.merge:
+        runs = ([args.baseline] if args.baseline else []) + args.current
+        save(args.merge, load_fastest(runs))
+        return 0
+    baseline = load(args.baseline)
+    current = load_fastest(args.current)
+    regressions = 0
+    for key in sorted(baseline.keys() & current.keys()):
+        old, new = baseline[key], current[key]
+        ratio = new['ns_per_op'] / old['ns_per_op'] if old['ns_per_op'] > 0 else 1.
+        notes = []
+        if ratio > 1 + args.threshold:
+            notes.append('slower')
+        elif ratio < 1 - args.threshold:
+            notes.append('faster')
+        old_allocations = old.get('allocations')
+        new_allocations = new.get('allocations')
+        if old_allocations is not None and new_allocations is not None:
+            if new_allocations > old_allocations:
+                notes.append('allocations %d -> %d' % (old_allocations, new_allocations))
+            elif new_allocations < old_allocations:
+                notes.append('allocations %d -> %d (fewer)' % (old_allocations, new_allocations))
+        regressed = 'slower' in notes or any(
+            note.startswith('allocations') and not note.endswith('(fewer)') for note in notes)
+        regressions += regressed
+        if notes or args.all:
+            print('%-4s %-12s %-36s %14.1f -> %14.1f ns  %+7.1f%%  %s' % (
+                'FAIL' if regressed else '', key[0], key[1], old['ns_per_op'],
+                new['ns_per_op'], (ratio - 1) * 100, ', '.join(notes)))
+    for key in sorted(baseline.keys() - current.keys()):
+        print('     %-12s %-36s missing from current run' % key)
+    for key in sorted(current.keys() - baseline.keys()):
+        print('     %-12s %-36s new, no baseline' % key)
+
+    print('%d of %d results regressed (threshold %.0f%%)' % (
+        regressions, len(baseline.keys() & current.keys()), args.threshold * 100))
+    return 1 if regressions else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,65 @@
+#include <string>
+#include <vector>
+#include "bench/bench.h"
+
+using task::Matrix;
+
+namespace {
+
+// Times fn once with the kept results dropped before every call and once
+// with them in place.
+template <class F>
+void Run(const std::string &name, Matrix &a, F &&fn) {
+  bench::Report(name + ", recomputed", bench::Measure([&] {
+    a.invalidate();
+    fn();
+  }));
+  fn();
+  fn();
+  bench::Report(name + ", kept", bench::Measure(fn));
+}
+
+} // namespace
+
+BENCHMARK(derived_values) {
+  for (size_t n : {16, 256, 1024}) {
+    std::string shape = " " + std::to_string(n);
+    Matrix a = bench::RandomMatrix(n, n);
+    const Matrix &c = a;
+    std::vector<double> b = bench::RandomMatrix(1, n).getRow(0);
+
+    Run("det()" + shape, a, [&] {
+      bench::DoNotOptimize(c.det());
+    });
+    Run("trace()" + shape, a, [&] {
+      bench::DoNotOptimize(c.trace());
+    });
+    Run("transposed()" + shape, a, [&] {
+      Matrix t = c.transposed();
+      bench::DoNotOptimize(t.data());
+    });
+    Run("solve(vector)" + shape, a, [&] {
+      std::vector<double> x = c.solve(b);
+      bench::DoNotOptimize(x.data());
+    });
+
+    // What the tracking costs element writes.
+    bench::Report("fill through operator[] per element" + shape, bench::Measure([&] {
+      for (size_t i = 0; i < n; ++i) {
+        for (size_t j = 0; j < n; ++j) {
+          a[i][j] = static_cast<double>(i + j);
+        }
+      }
+      bench::DoNotOptimize(a.data());
+    }));
+    bench::Report("fill through operator[] per row" + shape, bench::Measure([&] {
+      for (size_t i = 0; i < n; ++i) {
+        double *row = a[i];
+        for (size_t j = 0; j < n; ++j) {
+          row[j] = static_cast<double>(i + j);
+        }
+      }
+      bench::DoNotOptimize(a.data());
+    }));
+  }
+}
@@ -0,0 +1,62 @@
+#include <string>
+#include "bench/bench.h"
+#include "src/basic_matrix.h"
+
+using task::BasicMatrix;
+using task::Matrix;
+
+namespace {
+
+template <class T>
+void Add(const std::string &type, size_t n) {
+  BasicMatrix<T> a(bench::RandomMatrix(n, n)), b(bench::RandomMatrix(n, n));
+  double bytes = 3. * n * n * sizeof(T);
+  double seconds = bench::Measure([&] {
+    a += b;
+    bench::DoNotOptimize(a.data());
+  });
+  bench::Report(type + " += " + std::to_string(n), seconds, "GB/s", bytes / seconds * 1e-9);
+}
+
+template <class T>
+void Multiply(const std::string &type, size_t n) {
+  BasicMatrix<T> a(bench::RandomMatrix(n, n)), b(bench::RandomMatrix(n, n));
+  double seconds = bench::Measure([&] {
+    BasicMatrix<T> c = a * b;
+    bench::DoNotOptimize(c.data());
+  });
+  bench::Report(type + " * " + std::to_string(n), seconds, "GFLOP/s", 2. * n * n * n / seconds * 1e-9);
+}
+
+} // namespace
+
+// BasicMatrix<T> for each element type; "Matrix" is the double matrix
+// with the packed GEMM kernel, for reference.
+BENCHMARK(element_types) {
+  for (size_t n : {256, 1024, 2048}) {
+    Matrix a = bench::RandomMatrix(n, n), b = bench::RandomMatrix(n, n);
+    double seconds = bench::Measure([&] {
+      a += b;
+      bench::DoNotOptimize(a.data());
+    });
+    bench::Report("Matrix += " + std::to_string(n), seconds, "GB/s", 3. * n * n * sizeof(double) / seconds * 1e-9);
+    Add<double>("double", n);
+    Add<float>("float", n);
+    Add<int64_t>("int64_t", n);
+    Add<int32_t>("int32_t", n);
+    Add<task::FixedPoint<16>>("FixedPoint<16>", n);
+  }
+  for (size_t n : {256, 1024}) {
+    Matrix a = bench::RandomMatrix(n, n), b = bench::RandomMatrix(n, n);
+    double seconds = bench::Measure([&] {
+      Matrix c = a * b;
+      bench::DoNotOptimize(c.data());
+    });
+    bench::Report("Matrix * " + std::to_string(n), seconds, "GFLOP/s", 2. * n * n * n / seconds * 1e-9);
+    Multiply<double>("double", n);
+    Multiply<float>("float", n);
+    Multiply<int64_t>("int64_t", n);
+    Multiply<int32_t>("int32_t", n);
+    Multiply<task::FixedPoint<16>>("FixedPoint<16>", n);
+  }
+}
@@ -0,0 +1,30 @@
+#include <string>
+#include "bench/bench.h"
+
+using task::Matrix;
+
+BENCHMARK(expression) {
+  for (size_t n = 16; n <= 1024; n *= 4) {
+    Matrix a = bench::RandomMatrix(n, n), b = bench::RandomMatrix(n, n), c = bench::RandomMatrix(n, n);
+    Matrix res(n, n);
+
+    // What a + b - 2. * c cost when every operator returned a new Matrix.
+    double eager = bench::Measure([&] {
+      Matrix sum = a;
+      sum += b;
+      Matrix scaled = c;
+      scaled *= 2.;
+      Matrix diff = sum;
+      diff -= scaled;
+      res = diff;
+      bench::DoNotOptimize(res[0][0]);
+    });
+    bench::Report("eager a + b - 2c " + std::to_string(n), eager);
+
+    double fused = bench::Measure([&] {
+      res = a + b - 2. * c;
+      bench::DoNotOptimize(res[0][0]);
+    });
+    bench::Report("fused a + b - 2c " + std::to_string(n), fused);
+  }
+}
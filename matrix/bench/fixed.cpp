@@ -0,0 +1,79 @@
+#include <string>
+#include "bench/bench.h"
+#include "src/fixed_matrix.h"
+
+using task::FixedMatrix;
+using task::Matrix;
+
+namespace {
+
+// DoNotOptimize on the inputs keeps the compiler from hoisting the
+// operation out of the timing loop.
+template<size_t N>
+void Run() {
+  std::string shape = " " + std::to_string(N) + "x" + std::to_string(N);
+  Matrix a = bench::RandomMatrix(N, N), b = bench::RandomMatrix(N, N);
+  FixedMatrix<N, N> fa(a), fb(b);
+
+  auto compare = [&](const std::string &name, auto &&dynamic_op, auto &&fixed_op) {
+    double dynamic = bench::Measure(dynamic_op);
+    double fixed = bench::Measure(fixed_op);
+    bench::Report("Matrix " + name + shape, dynamic);
+    bench::Report("FixedMatrix " + name + shape, fixed, "x faster", dynamic / fixed);
+  };
+
+  compare("*", [&] {
+    bench::DoNotOptimize(a);
+    Matrix c = a * b;
+    bench::DoNotOptimize(c.data());
+  }, [&] {
+    bench::DoNotOptimize(fa);
+    auto c = fa * fb;
+    bench::DoNotOptimize(c);
+  });
+
+  compare("+", [&] {
+    bench::DoNotOptimize(a);
+    Matrix c = a + b;
+    bench::DoNotOptimize(c.data());
+  }, [&] {
+    bench::DoNotOptimize(fa);
+    auto c = fa + fb;
+    bench::DoNotOptimize(c);
+  });
+
+  compare("det()", [&] {
+    bench::DoNotOptimize(a);
+    bench::DoNotOptimize(a.det());
+  }, [&] {
+    bench::DoNotOptimize(fa);
+    bench::DoNotOptimize(fa.det());
+  });
+
+  compare("transposed()", [&] {
+    bench::DoNotOptimize(a);
+    Matrix t = a.transposed();
+    bench::DoNotOptimize(t.data());
+  }, [&] {
+    bench::DoNotOptimize(fa);
+    auto t = fa.transposed();
+    bench::DoNotOptimize(t);
+  });
+
+  compare("trace()", [&] {
+    bench::DoNotOptimize(a);
+    bench::DoNotOptimize(a.trace());
+  }, [&] {
+    bench::DoNotOptimize(fa);
+    bench::DoNotOptimize(fa.trace());
+  });
+}
+
+} // namespace
+
+BENCHMARK(fixed_size) {
+  Run<2>();
+  Run<3>();
+  Run<4>();
+  Run<8>();
+}
@@ -0,0 +1,41 @@
+#include <string>
+#include "bench/bench.h"
+
+using task::Matrix;
+
+namespace {
+
+// The i-j-k loop Matrix::operator* used before the blocked kernel.
+void NaiveMultiply(const Matrix &a, const Matrix &b, Matrix &c) {
+  size_t n = a.rows(), m = b.cols(), k = a.cols();
+  for (size_t i = 0; i < n; ++i) {
+    for (size_t j = 0; j < m; ++j) {
+      double sum = 0.;
+      for (size_t p = 0; p < k; ++p) {
+        sum += a[i][p] * b[p][j];
+      }
+      c[i][j] = sum;
+    }
+  }
+}
+
+} // namespace
+
+BENCHMARK(gemm) {
+  for (size_t n = 8; n <= 2048; n *= 2) {
+    Matrix a = bench::RandomMatrix(n, n), b = bench::RandomMatrix(n, n), c(n, n);
+    double flops = 2. * n * n * n;
+
+    double naive = bench::Measure([&] {
+      NaiveMultiply(a, b, c);
+      bench::DoNotOptimize(c[0][0]);
+    });
+    bench::Report("naive " + std::to_string(n), naive, "GFLOP/s", flops / naive * 1e-9);
+
+    double blocked = bench::Measure([&] {
+      c = a * b;
+      bench::DoNotOptimize(c[0][0]);
+    });
+    bench::Report("blocked " + std::to_string(n), blocked, "GFLOP/s", flops / blocked * 1e-9);
+  }
+}
@@ -0,0 +1,87 @@
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include "bench/bench.h"
+#include "src/binary_io.h"
+
+using task::Matrix;
+namespace binary = task::binary;
+
+namespace {
+
+// Side of the square matrix; MATRIX_BENCH_IO_SIZE overrides the default
+// 10000 (800 MB of doubles, about 1 GB as text).
+size_t Size() {
+  const char *size = std::getenv("MATRIX_BENCH_IO_SIZE");
+  return size ? std::stoul(size) : 10000;
+}
+
+// Sums every element so that mapped pages are actually read.
+double Sum(const task::ConstMatrixView &a) {
+  double sum = 0;
+  for (size_t i = 0; i < a.rowCount(); ++i) {
+    for (size_t j = 0; j < a.colCount(); ++j) {
+      sum += a.at(i, j);
+    }
+  }
+  return sum;
+}
+
+void Report(const std::string &name, double seconds, double bytes) {
+  bench::Report(name, seconds, "MB/s", bytes / seconds * 1e-6);
+}
+
+} // namespace
+
+BENCHMARK(binary_io) {
+  size_t n = Size();
+  std::string shape = " " + std::to_string(n) + "x" + std::to_string(n);
+  const std::string text_path = "matrix_bench_io.txt", binary_path = "matrix_bench_io.bin";
+  double bytes = 1. * n * n * sizeof(double);
+  Matrix a = bench::RandomMatrix(n, n);
+
+  double text_write = bench::Measure([&] {
+    std::ofstream output(text_path);
+    output << n << " " << n << "\n" << a;
+  });
+  Report("text operator<<" + shape, text_write, bytes);
+
+  double text_read = bench::Measure([&] {
+    std::ifstream input(text_path);
+    Matrix b;
+    input >> b;
+    bench::DoNotOptimize(b.data());
+  });
+  Report("text operator>>" + shape, text_read, bytes);
+  std::remove(text_path.c_str());
+
+  double binary_write = bench::Measure([&] {
+    binary::save(binary_path, a);
+  });
+  Report("binary::save" + shape, binary_write, bytes);
+
+  double binary_read = bench::Measure([&] {
+    Matrix b = binary::load(binary_path);
+    bench::DoNotOptimize(b.data());
+  });
+  Report("binary::load" + shape, binary_read, bytes);
+
+  double map_open = bench::Measure([&] {
+    binary::MappedMatrix b(binary_path);
+    bench::DoNotOptimize(b.data());
+  });
+  Report("MappedMatrix open" + shape, map_open, bytes);
+
+  double map_scan = bench::Measure([&] {
+    binary::MappedMatrix b(binary_path);
+    bench::DoNotOptimize(Sum(b.view()));
+  });
+  Report("MappedMatrix open + full scan" + shape, map_scan, bytes);
+
+  double memory_scan = bench::Measure([&] {
+    bench::DoNotOptimize(Sum(a.view()));
+  });
+  Report("in-memory full scan" + shape, memory_scan, bytes);
+  std::remove(binary_path.c_str());
+}
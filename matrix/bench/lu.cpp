@@ -0,0 +1,44 @@
+#include <string>
+#include "bench/bench.h"
+
+using task::Matrix;
+
+namespace {
+
+// Unpivoted elimination Matrix::det used before LU.
+double EliminationDet(const Matrix &a) {
+  Matrix m = a;
+  size_t n = a.rows();
+  for (size_t k = 0; k + 1 < n; ++k) {
+    for (size_t i = k + 1; i < n; ++i) {
+      double tmp = -m[i][k] / m[k][k];
+      for (size_t j = 0; j < n; ++j) {
+        m[i][j] += m[k][j] * tmp;
+      }
+    }
+  }
+  double res = 1.;
+  for (size_t i = 0; i < n; ++i) {
+    res *= m[i][i];
+  }
+  return res;
+}
+
+} // namespace
+
+BENCHMARK(det) {
+  for (size_t n = 16; n <= 2048; n *= 2) {
+    Matrix a = bench::RandomMatrix(n, n);
+    double flops = 2. / 3. * n * n * n;
+
+    double elimination = bench::Measure([&] {
+      bench::DoNotOptimize(EliminationDet(a));
+    });
+    bench::Report("elimination det " + std::to_string(n), elimination, "GFLOP/s", flops / elimination * 1e-9);
+
+    double lu = bench::Measure([&] {
+      bench::DoNotOptimize(a.det());
+    });
+    bench::Report("lu det " + std::to_string(n), lu, "GFLOP/s", flops / lu * 1e-9);
+  }
+}
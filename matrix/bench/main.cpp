@@ -0,0 +1,105 @@
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include "bench/bench.h"
+
+namespace {
+
+std::atomic<size_t> heap_allocations{0};
+
+void WriteString(std::FILE *out, const std::string &value) {
+  std::fputc('"', out);
+  for (char c : value) {
+    if (c == '"' || c == '\\') {
+      std::fputc('\\', out);
+    }
+    std::fputc(c, out);
+  }
+  std::fputc('"', out);
+}
+
+// {"results": [{"benchmark": ..., "name": ..., "ns_per_op": ..., ...}]};
+// the optional fields are left out when a result does not have them.
+void WriteJson(std::FILE *out) {
+  const auto &results = bench::Results();
+  std::fprintf(out, "{\n  \"results\": [");
+  for (size_t i = 0; i < results.size(); ++i) {
+    const auto &result = results[i];
+    std::fprintf(out, "%s\n    {\"benchmark\": ", i ? "," : "");
+    WriteString(out, result.benchmark);
+    std::fprintf(out, ", \"name\": ");
+    WriteString(out, result.name);
+    std::fprintf(out, ", \"ns_per_op\": %.6g", result.ns_per_op);
+    if (!result.unit.empty()) {
+      std::fprintf(out, ", \"unit\": ");
+      WriteString(out, result.unit);
+      std::fprintf(out, ", \"value\": %.6g", result.value);
+    }
+    if (result.gflops >= 0) {
+      std::fprintf(out, ", \"gflops\": %.6g", result.gflops);
+    }
+    if (result.allocations >= 0) {
+      std::fprintf(out, ", \"allocations\": %.0f", result.allocations);
+    }
+    std::fprintf(out, "}");
+  }
+  std::fprintf(out, "\n  ]\n}\n");
+}
+
+} // namespace
+
+// Counts every allocation of the benchmark binary; see bench::CountAllocations.
+void *operator new(size_t size) {
+  ++heap_allocations;
+  if (void *data = std::malloc(size ? size : 1)) {
+    return data;
+  }
+  throw std::bad_alloc();
+}
+
+void operator delete(void *data) noexcept {
+  std::free(data);
+}
+
+void operator delete(void *data, size_t) noexcept {
+  std::free(data);
+}
+
+size_t bench::HeapAllocations() {
+  return heap_allocations;
+}
+
+// Usage: matrix_bench [--json=FILE] [filter]
+// Runs every benchmark whose name contains filter and, with --json, also
+// writes every reported result to FILE (see bench/compare.py).
+int main(int argc, char **argv) {
+  const char *filter = "";
+  const char *json_path = nullptr;
+  for (int i = 1; i < argc; ++i) {
+    if (std::strncmp(argv[i], "--json=", 7) == 0) {
+      json_path = argv[i] + 7;
+    } else {
+      filter = argv[i];
+    }
+  }
+  for (const auto &benchmark : bench::Registry()) {
+    if (std::strstr(benchmark.name, filter)) {
+      std::printf("== %s\n", benchmark.name);
+      size_t first = bench::Results().size();
+      benchmark.run();
+      for (size_t i = first; i < bench::Results().size(); ++i) {
+        bench::Results()[i].benchmark = benchmark.name;
+      }
+    }
+  }
+  if (json_path) {
+    std::FILE *out = std::fopen(json_path, "w");
+    if (!out) {
+      std::perror(json_path);
+      return 1;
+    }
+    WriteJson(out);
+    std::fclose(out);
+  }
+}
@@ -0,0 +1,83 @@
+#include <string>
+#include <vector>
+#include "bench/bench.h"
+#include "src/blas2.h"
+
+using task::Matrix;
+
+namespace {
+
+std::vector<double> RandomVector(size_t size) {
+  return bench::RandomMatrix(1, size).getRow(0);
+}
+
+Matrix ColumnOf(const std::vector<double> &x) {
+  Matrix column(x.size(), 1);
+  for (size_t i = 0; i < x.size(); ++i) {
+    column[i][0] = x[i];
+  }
+  return column;
+}
+
+// Each kernel reads A once, so memory bandwidth is the measure; the
+// workarounds through n x 1 matrices are reported with the same byte
+// count for comparison.
+template <class F>
+void Run(const std::string &name, double bytes, F &&fn) {
+  double seconds = bench::Measure(fn);
+  bench::Report(name, seconds, "GB/s", bytes / seconds * 1e-9);
+}
+
+} // namespace
+
+BENCHMARK(matrix_vector) {
+  for (size_t n : {256, 1024, 4096}) {
+    std::string shape = " " + std::to_string(n);
+    Matrix a = bench::RandomMatrix(n, n);
+    std::vector<double> x = RandomVector(n), y(n);
+    Matrix column = ColumnOf(x), row = column.transposed();
+    double bytes = 8. * n * n;
+
+    Run("A * column Matrix" + shape, bytes, [&] {
+      Matrix c = a * column;
+      bench::DoNotOptimize(c.data());
+    });
+    Run("A * x" + shape, bytes, [&] {
+      std::vector<double> c = a * x;
+      bench::DoNotOptimize(c.data());
+    });
+    Run("gemv into y" + shape, bytes, [&] {
+      task::gemv(1., a, x, 0., y);
+      bench::DoNotOptimize(y.data());
+    });
+    Run("row Matrix * A" + shape, bytes, [&] {
+      Matrix c = row * a;
+      bench::DoNotOptimize(c.data());
+    });
+    Run("x * A" + shape, bytes, [&] {
+      std::vector<double> c = x * a;
+      bench::DoNotOptimize(c.data());
+    });
+
+    // A is read and written.
+    Run("A += column * row Matrix" + shape, 2 * bytes, [&] {
+      a += column * row;
+      bench::DoNotOptimize(a.data());
+    });
+    Run("ger" + shape, 2 * bytes, [&] {
+      task::ger(1., x, x, a);
+      bench::DoNotOptimize(a.data());
+    });
+
+    // Both triangles of the factors are read.
+    task::LUDecomposition lu(a + Matrix(n, n) * (20. * n));
+    Run("LU solve, column Matrix" + shape, bytes, [&] {
+      Matrix c = lu.solve(column);
+      bench::DoNotOptimize(c.data());
+    });
+    Run("LU solve, vector (trsv)" + shape, bytes, [&] {
+      std::vector<double> c = lu.solve(x);
+      bench::DoNotOptimize(c.data());
+    });
+  }
+}
@@ -0,0 +1,44 @@
+#include <string>
+#include <thread>
+#include "bench/bench.h"
+#include "src/thread_pool.h"
+
+using task::Matrix;
+
+BENCHMARK(parallel_scaling) {
+  size_t max_threads = std::max<size_t>(1, std::thread::hardware_concurrency());
+  for (size_t n = 512; n <= 4096; n *= 2) {
+    Matrix a = bench::RandomMatrix(n, n), b = bench::RandomMatrix(n, n), c(n, n);
+    std::string size = " " + std::to_string(n);
+    for (size_t threads = 1; threads <= max_threads; threads *= 2) {
+      task::parallel::setThreadCount(threads);
+      std::string suffix = size + " threads=" + std::to_string(threads);
+
+      double multiply = bench::Measure([&] {
+        c = a * b;
+        bench::DoNotOptimize(c[0][0]);
+      });
+      bench::Report("multiply" + suffix, multiply, "GFLOP/s", 2. * n * n * n / multiply * 1e-9);
+
+      double add = bench::Measure([&] {
+        c += a;
+        bench::DoNotOptimize(c[0][0]);
+      });
+      bench::Report("add" + suffix, add, "GB/s", 3. * n * n * sizeof(double) / add * 1e-9);
+
+      double transpose = bench::Measure([&] {
+        c.transpose();
+        bench::DoNotOptimize(c[0][0]);
+      });
+      bench::Report("transpose" + suffix, transpose, "GB/s", 2. * n * n * sizeof(double) / transpose * 1e-9);
+
+      if (n <= 2048) {
+        double det = bench::Measure([&] {
+          bench::DoNotOptimize(a.det());
+        });
+        bench::Report("det" + suffix, det);
+      }
+    }
+  }
+  task::parallel::setThreadCount(0);
+}
@@ -0,0 +1,90 @@
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+#include "bench/bench.h"
+#include "src/sparse_matrix.h"
+
+using task::Matrix;
+using task::SparseMatrix;
+
+namespace {
+
+Matrix RandomSparse(size_t rows, size_t cols, double density) {
+  static std::mt19937 rand(7);
+  std::uniform_real_distribution<double> dist{0., 1.};
+  Matrix result = bench::RandomMatrix(rows, cols);
+  for (size_t i = 0; i < rows; ++i) {
+    for (size_t j = 0; j < cols; ++j) {
+      if (dist(rand) >= density) {
+        result[i][j] = 0;
+      }
+    }
+  }
+  return result;
+}
+
+void Compare(const std::string &name, double dense, double sparse) {
+  bench::Report("dense " + name, dense);
+  bench::Report("sparse " + name, sparse, "x faster", dense / sparse);
+}
+
+void Run(size_t n, double density) {
+  Matrix a = RandomSparse(n, n, density), b = RandomSparse(n, n, density);
+  SparseMatrix sa(a), sb(b);
+  std::string suffix = " " + std::to_string(n) + " density " + std::to_string(density).substr(0, 5);
+  std::printf("  memory: dense %.1f MB, CSR %.1f MB (%zu nonzeros)\n",
+              n * n * sizeof(double) * 1e-6, sa.memoryBytes() * 1e-6, sa.nonZeros());
+
+  std::vector<double> x(n, 1.);
+  Matrix x_column(n, 1), panel = bench::RandomMatrix(n, 64);
+  double flops = 2. * sa.nonZeros();
+  double dense_mv = bench::Measure([&] {
+    Matrix y = a * x_column;
+    bench::DoNotOptimize(y.data());
+  });
+  double sparse_mv = bench::Measure([&] {
+    auto y = sa * x;
+    bench::DoNotOptimize(y.data());
+  });
+  Compare("A * x" + suffix, dense_mv, sparse_mv);
+  std::printf("  SpMV: %.3f GFLOP/s on nonzeros\n", flops / sparse_mv * 1e-9);
+
+  double dense_mm = bench::Measure([&] {
+    Matrix c = a * panel;
+    bench::DoNotOptimize(c.data());
+  });
+  double sparse_mm = bench::Measure([&] {
+    Matrix c = sa * panel;
+    bench::DoNotOptimize(c.data());
+  });
+  Compare("A * B(" + std::to_string(n) + "x64)" + suffix, dense_mm, sparse_mm);
+
+  double dense_add = bench::Measure([&] {
+    Matrix c = a + b;
+    bench::DoNotOptimize(c.data());
+  });
+  double sparse_add = bench::Measure([&] {
+    SparseMatrix c = sa + sb;
+    bench::DoNotOptimize(c.values().data());
+  });
+  Compare("A + B" + suffix, dense_add, sparse_add);
+
+  double dense_transpose = bench::Measure([&] {
+    Matrix t = a.transposed();
+    bench::DoNotOptimize(t.data());
+  });
+  double sparse_transpose = bench::Measure([&] {
+    SparseMatrix t = sa.transposed().toLayout(SparseMatrix::Layout::kCsr);
+    bench::DoNotOptimize(t.values().data());
+  });
+  Compare("transposed() to CSR" + suffix, dense_transpose, sparse_transpose);
+}
+
+} // namespace
+
+BENCHMARK(sparse) {
+  for (double density : {0.001, 0.01, 0.05}) {
+    Run(2000, density);
+  }
+}
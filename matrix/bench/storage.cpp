@@ -0,0 +1,45 @@
+#include <cstdio>
+#include <string>
+#include "bench/bench.h"
+#include "src/storage.h"
+
+using task::Matrix;
+using task::storage::Policy;
+
+namespace {
+
+void Run(const char *policy_name, const Policy &policy, size_t n) {
+  task::storage::setPolicy(policy);
+  task::storage::resetPoolStats();
+  std::string shape = " " + std::to_string(n) + "x" + std::to_string(n);
+  Matrix a = bench::RandomMatrix(n, n), b = bench::RandomMatrix(n, n);
+
+  // A temporary per iteration, the pattern of chained arithmetic.
+  double construct = bench::Measure([&] {
+    Matrix m(n, n);
+    bench::DoNotOptimize(m.data());
+  });
+  bench::Report(std::string(policy_name) + " construct" + shape, construct);
+
+  double sum = bench::Measure([&] {
+    Matrix m = a + b;
+    bench::DoNotOptimize(m.data());
+  });
+  bench::Report(std::string(policy_name) + " a + b" + shape, sum);
+
+  if (&policy == &task::storage::POOLED) {
+    auto stats = task::storage::poolStats();
+    std::printf("  pool: %zu requests, %.4f hit rate, %zu misses\n",
+                stats.requests, stats.hitRate(), stats.misses);
+  }
+}
+
+} // namespace
+
+BENCHMARK(allocation) {
+  for (size_t n : {2, 8, 32, 128, 512}) {
+    Run("heap", task::storage::HEAP, n);
+    Run("pooled", task::storage::POOLED, n);
+  }
+  task::storage::setPolicy(task::storage::POOLED);
+}
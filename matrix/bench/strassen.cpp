@@ -0,0 +1,63 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <string>
+#include "bench/bench.h"
+#include "src/strassen.h"
+
+using task::Matrix;
+
+namespace {
+
+// Largest error over sampled entries, relative to sum_l |a_il| |b_lj|, the
+// scale of the classical componentwise error bound. The reference dot
+// products are accumulated in long double.
+double SampledError(const Matrix &a, const Matrix &b, const Matrix &c) {
+  std::mt19937 rand(1);
+  std::uniform_int_distribution<size_t> row(0, c.rowCount() - 1), col(0, c.colCount() - 1);
+  double worst = 0;
+  for (int sample = 0; sample < 200; ++sample) {
+    size_t i = row(rand), j = col(rand);
+    long double exact = 0, scale = 0;
+    for (size_t l = 0; l < a.colCount(); ++l) {
+      exact += static_cast<long double>(a[i][l]) * b[l][j];
+      scale += std::fabs(a[i][l] * b[l][j]);
+    }
+    worst = std::max(worst, static_cast<double>(std::fabs(c[i][j] - exact) / scale));
+  }
+  return worst;
+}
+
+void Run(size_t n) {
+  Matrix a = bench::RandomMatrix(n, n), b = bench::RandomMatrix(n, n), c;
+  double flops = 2. * n * n * n;
+  double classical = 0;
+  std::printf("  %-12s %12s %12s %10s %14s\n", "crossover", "ms", "GFLOP/s", "speedup", "rel. error");
+  for (size_t crossover : {0, 512, 256, 128, 64}) {
+    if (crossover >= n) {
+      continue;
+    }
+    task::strassen::setCrossover(crossover);
+    double seconds = bench::Measure([&] {
+      c = a * b;
+      bench::DoNotOptimize(c.data());
+    });
+    if (crossover == 0) {
+      classical = seconds;
+    }
+    std::string name = crossover == 0 ? "classical" : std::to_string(crossover);
+    std::printf("  %-12s %12.1f %12.2f %10.2f %14.2e\n", name.c_str(), seconds * 1e3,
+                flops / seconds * 1e-9, classical / seconds, SampledError(a, b, c));
+  }
+  task::strassen::setCrossover(0);
+}
+
+} // namespace
+
+BENCHMARK(strassen) {
+  for (size_t n : {511, 1024, 1537, 2048}) {
+    std::printf("%zu x %zu\n", n, n);
+    Run(n);
+  }
+}
@@ -0,0 +1,103 @@
+#include <cstdlib>
+#include <sstream>
+#include <string>
+#include "bench/bench.h"
+#include "src/binary_io.h"
+
+using task::Matrix;
+
+namespace {
+
+// Measurements are repeated and the fastest kept: the suite feeds
+// bench/compare.py, so run-to-run noise matters more than total time.
+const int REPEATS = 3;
+
+template <class F>
+void Run(const std::string &name, double flops, F &&fn) {
+  double allocations = bench::CountAllocations(fn);
+  double best = bench::Measure(fn, 0.1);
+  for (int i = 1; i < REPEATS; ++i) {
+    best = std::min(best, bench::Measure(fn, 0.1));
+  }
+  bench::Record(name, best, flops, allocations);
+}
+
+void Sweep(size_t rows, size_t cols) {
+  std::string shape = " " + std::to_string(rows) + "x" + std::to_string(cols);
+  Matrix a = bench::RandomMatrix(rows, cols), b = bench::RandomMatrix(rows, cols);
+  Matrix c = bench::RandomMatrix(cols, rows);
+  double size = static_cast<double>(rows) * cols;
+
+  Run("construct" + shape, 0., [&] {
+    Matrix m(rows, cols);
+    bench::DoNotOptimize(m.data());
+  });
+  Run("copy" + shape, 0., [&] {
+    Matrix m = a;
+    bench::DoNotOptimize(m.data());
+  });
+  Run("a + b" + shape, size, [&] {
+    Matrix m = a + b;
+    bench::DoNotOptimize(m.data());
+  });
+  Run("a * c" + shape, 2. * size * rows, [&] {
+    Matrix m = a * c;
+    bench::DoNotOptimize(m.data());
+  });
+  Run("transposed" + shape, 0., [&] {
+    Matrix m = a.transposed();
+    bench::DoNotOptimize(m.data());
+  });
+  if (rows == cols) {
+    Run("det" + shape, 2. / 3. * size * rows, [&] {
+      double det = a.det();
+      bench::DoNotOptimize(det);
+    });
+    Run("trace" + shape, static_cast<double>(rows), [&] {
+      double trace = a.trace();
+      bench::DoNotOptimize(trace);
+    });
+  }
+
+  // operator>> takes the shape first, operator<< writes only the values.
+  std::ostringstream text_out, binary_out;
+  text_out << rows << " " << cols << "\n" << a;
+  task::binary::write(binary_out, a);
+  const std::string text = text_out.str(), binary = binary_out.str();
+  Run("text write" + shape, 0., [&] {
+    std::ostringstream out;
+    out << a;
+    bench::DoNotOptimize(out.tellp());
+  });
+  Run("text read" + shape, 0., [&] {
+    std::istringstream in(text);
+    Matrix m;
+    in >> m;
+    bench::DoNotOptimize(m.data());
+    if (!in) {
+      std::abort();
+    }
+  });
+  Run("binary write" + shape, 0., [&] {
+    std::ostringstream out;
+    task::binary::write(out, a);
+    bench::DoNotOptimize(out.tellp());
+  });
+  Run("binary read" + shape, 0., [&] {
+    std::istringstream in(binary);
+    Matrix m = task::binary::read(in);
+    bench::DoNotOptimize(m.data());
+  });
+}
+
+} // namespace
+
+// The regression suite: every Matrix operation over a sweep of shapes.
+// Compare runs with bench/compare.py.
+BENCHMARK(suite) {
+  for (size_t n : {4, 16, 64, 256, 1024}) {
+    Sweep(n, n);
+  }
+  Sweep(16, 1024);
+  Sweep(1024, 16);
+}
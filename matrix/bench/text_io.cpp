@@ -0,0 +1,135 @@
+#include <cstdio>
+#include <sstream>
+#include <string>
+#include "bench/bench.h"
+
+using task::Matrix;
+
+namespace {
+
+// operator>> before the from_chars parser.
+std::istream &LegacyRead(std::istream &input, Matrix &matrix) {
+  size_t n, m;
+  input >> n >> m;
+  matrix.resize(n, m);
+  for (size_t i = 0; i < n; ++i) {
+    for (size_t j = 0; j < m; ++j) {
+      double tmp;
+      input >> tmp;
+      matrix.set(i, j, tmp);
+    }
+  }
+  return input;
+}
+
+// operator<< before the to_chars formatter.
+std::ostream &LegacyWrite(std::ostream &output, const Matrix &matrix) {
+  for (size_t i = 0; i < matrix.rows(); ++i) {
+    for (size_t j = 0; j < matrix.cols(); ++j) {
+      output << matrix[i][j] << " ";
+    }
+    output << std::endl;
+  }
+  return output;
+}
+
+// Output of test/generate.py, or an empty string if it cannot be run.
+std::string Generate(size_t tests) {
+  std::string command = "python3 test/generate.py " + std::to_string(tests) + " 2>/dev/null";
+  std::string result;
+  if (FILE *pipe = popen(command.c_str(), "r")) {
+    char buffer[1 << 16];
+    size_t read;
+    while ((read = std::fread(buffer, 1, sizeof(buffer), pipe)) > 0) {
+      result.append(buffer, read);
+    }
+    if (pclose(pipe) != 0) {
+      result.clear();
+    }
+  }
+  return result;
+}
+
+// Reads one test case of generate.py in the order test/test.cpp does.
+template<class ReadMatrix>
+void ReadTestCase(std::istream &input, ReadMatrix read) {
+  Matrix a;
+  double scalar;
+  for (int i = 0; i < 6; ++i) {
+    read(input, a);  // mat1, mat2, sum, difference, mat3, product
+  }
+  input >> scalar;
+  read(input, a);  // scalar * mat1
+  read(input, a);  // -mat1
+  read(input, a);  // mat1.T
+  read(input, a);  // square
+  input >> scalar;
+  read(input, a);  // small square
+  input >> scalar;
+  bench::DoNotOptimize(scalar);
+}
+
+void RunGenerated() {
+  const size_t tests = 2000;
+  std::string data = Generate(tests);
+  if (data.empty()) {
+    std::printf("test/generate.py is not available, run from the matrix directory\n");
+    return;
+  }
+  double megabytes = data.size() * 1e-6;
+  auto run = [&](auto read) {
+    return bench::Measure([&] {
+      std::istringstream input(data);
+      for (size_t i = 0; i < tests; ++i) {
+        ReadTestCase(input, read);
+      }
+    });
+  };
+  double legacy = run(LegacyRead);
+  bench::Report("generate.py " + std::to_string(tests) + " legacy >>", legacy, "MB/s", megabytes / legacy);
+  double fast = run([](std::istream &input, Matrix &a) -> std::istream & { return input >> a; });
+  bench::Report("generate.py " + std::to_string(tests) + " operator>>", fast, "MB/s", megabytes / fast);
+}
+
+void RunLarge(size_t n, int precision) {
+  Matrix a = bench::RandomMatrix(n, n);
+  std::string shape = " " + std::to_string(n) + "x" + std::to_string(n) + " precision " + std::to_string(precision);
+  std::ostringstream text;
+  text.precision(precision);
+  text << n << " " << n << "\n" << a;
+  double megabytes = text.str().size() * 1e-6;
+
+  auto write = [&](auto writer) {
+    return bench::Measure([&] {
+      std::ostringstream output;
+      output.precision(precision);
+      writer(output, a);
+      bench::DoNotOptimize(output.tellp());
+    });
+  };
+  double legacy_write = write(LegacyWrite);
+  bench::Report("legacy <<" + shape, legacy_write, "MB/s", megabytes / legacy_write);
+  double fast_write = write([](std::ostream &output, const Matrix &m) -> std::ostream & { return output << m; });
+  bench::Report("operator<<" + shape, fast_write, "MB/s", megabytes / fast_write);
+
+  auto read = [&](auto reader) {
+    return bench::Measure([&] {
+      std::istringstream input(text.str());
+      Matrix b;
+      reader(input, b);
+      bench::DoNotOptimize(b.data());
+    });
+  };
+  double legacy_read = read(LegacyRead);
+  bench::Report("legacy >>" + shape, legacy_read, "MB/s", megabytes / legacy_read);
+  double fast_read = read([](std::istream &input, Matrix &m) -> std::istream & { return input >> m; });
+  bench::Report("operator>>" + shape, fast_read, "MB/s", megabytes / fast_read);
+}
+
+} // namespace
+
+BENCHMARK(text_io) {
+  RunGenerated();
+  RunLarge(1000, 6);
+  RunLarge(1000, 17);
+}
@@ -0,0 +1,64 @@
+#include <string>
+#include "bench/bench.h"
+
+using task::Matrix;
+
+namespace {
+
+// Scatter into a fresh buffer, as Matrix::transpose did before tiling.
+void ScatterTranspose(const Matrix &a, Matrix &result) {
+  size_t rows = a.rows(), cols = a.cols();
+  for (size_t i = 0; i < rows; ++i) {
+    for (size_t j = 0; j < cols; ++j) {
+      result[j][i] = a[i][j];
+    }
+  }
+}
+
+// Bounds-checked get/set, as Matrix::transposed did before tiling.
+void CheckedTranspose(const Matrix &a, Matrix &result) {
+  for (size_t i = 0; i < a.rows(); ++i) {
+    for (size_t j = 0; j < a.cols(); ++j) {
+      result.set(j, i, a.get(i, j));
+    }
+  }
+}
+
+void Run(size_t rows, size_t cols) {
+  Matrix a = bench::RandomMatrix(rows, cols), result(cols, rows);
+  std::string shape = " " + std::to_string(rows) + "x" + std::to_string(cols);
+  double bytes = 2. * rows * cols * sizeof(double);
+
+  double scatter = bench::Measure([&] {
+    ScatterTranspose(a, result);
+    bench::DoNotOptimize(result[0][0]);
+  });
+  bench::Report("scatter" + shape, scatter, "GB/s", bytes / scatter * 1e-9);
+
+  double checked = bench::Measure([&] {
+    CheckedTranspose(a, result);
+    bench::DoNotOptimize(result[0][0]);
+  });
+  bench::Report("checked get/set" + shape, checked, "GB/s", bytes / checked * 1e-9);
+
+  double tiled = bench::Measure([&] {
+    result = a.transposed();
+    bench::DoNotOptimize(result[0][0]);
+  });
+  bench::Report("transposed()" + shape, tiled, "GB/s", bytes / tiled * 1e-9);
+
+  double in_place = bench::Measure([&] {
+    a.transpose();
+    bench::DoNotOptimize(a[0][0]);
+  });
+  bench::Report("transpose() in place" + shape, in_place, "GB/s", bytes / in_place * 1e-9);
+}
+
+} // namespace
+
+BENCHMARK(transpose) {
+  for (size_t n = 64; n <= 4096; n *= 4) {
+    Run(n, n);
+    Run(n, n / 2 + 3);
+  }
+}
@@ -4,7 +4,7 @@ set -e
 
 STRESS_TEST_COUNT=500
 
-g++ -std=c++17 -I./ test/test.cpp src/matrix.cpp -o matrix_test
+g++ -std=c++17 -I./ test/test.cpp src/matrix.cpp src/gemm.cpp src/blas2.cpp src/simd.cpp src/thread_pool.cpp src/lu.cpp src/transpose.cpp src/storage.cpp src/binary_io.cpp src/text_io.cpp src/sparse_matrix.cpp src/strassen.cpp src/matrix_batch.cpp -o matrix_test -pthread
 python3 test/generate.py $STRESS_TEST_COUNT > test_data
 ./matrix_test $STRESS_TEST_COUNT < test_data
 
@@ -0,0 +1,556 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <limits>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "common.h"
+#include "fixed_point.h"
+#include "matrix.h"
+#include "simd.h"
+#include "storage.h"
+#include "thread_pool.h"
+#include "transpose.h"
+
+namespace task {
+
+// Largest difference operator== lets pass between equal elements.
+template<class T>
+struct Tolerance {
+  static constexpr T value = T(0);  // integers compare exactly
+};
+
+template<>
+struct Tolerance<double> {
+  static constexpr double value = EPS;
+};
+
+// float carries about 7 significant digits, so results that differ only
+// in rounding are often further apart than EPS.
+template<>
+struct Tolerance<float> {
+  static constexpr float value = 1e-3f;
+};
+
+// A few rounding steps of the fixed-point products.
+template<int FRAC_BITS, class Rep>
+struct Tolerance<FixedPoint<FRAC_BITS, Rep>> {
+  static constexpr FixedPoint<FRAC_BITS, Rep> value = FixedPoint<FRAC_BITS, Rep>::fromRaw(16);
+};
+
+// Matrix over element type T: float, double, int32_t, int64_t or a
+// FixedPoint. Matrix stays the double matrix with the tuned machinery
+// (packed GEMM, blocked LU, Strassen, expression templates, sparse and
+// binary formats); BasicMatrix offers the same basic interface for other
+// types, e.g. to run a memory-bound pipeline in float at half the
+// bandwidth. Element-wise operations and the product use the SIMD kernels
+// of simd::kernelsFor<T>, or plain loops for types without them.
+//
+// Buffers come from the storage policy like Matrix buffers do.
+template<class T>
+class BasicMatrix {
+  static_assert(std::is_trivially_copyable<T>::value && alignof(T) <= storage::ALIGNMENT,
+                "BasicMatrix elements must be trivially copyable");
+
+public:
+  using value_type = T;
+
+  BasicMatrix() : BasicMatrix(1, 1) {}
+  // Ones on the main diagonal, like Matrix(rows, cols).
+  BasicMatrix(size_t rows, size_t cols) : BasicMatrix(rows, cols, Uninitialized()) {
+    std::fill(vals, vals + n_rows * n_cols, T(0));
+    for (size_t i = 0; i < rows && i < cols; ++i) {
+      vals[i * n_cols + i] = T(1);
+    }
+  }
+  BasicMatrix(const BasicMatrix &copy) : BasicMatrix(copy.n_rows, copy.n_cols, Uninitialized()) {
+    std::copy(copy.vals, copy.vals + n_rows * n_cols, vals);
+  }
+  BasicMatrix(BasicMatrix &&other) noexcept
+      : vals(other.vals), n_rows(other.n_rows), n_cols(other.n_cols) {
+    other.vals = nullptr;
+    other.n_rows = other.n_cols = 0;
+  }
+  // Element-wise conversions, each element converted as T(value) does.
+  template<class U>
+  explicit BasicMatrix(const BasicMatrix<U> &other)
+      : BasicMatrix(other.rowCount(), other.colCount(), Uninitialized()) {
+    const U *src = other.data();
+    for (size_t i = 0; i < n_rows * n_cols; ++i) {
+      vals[i] = T(src[i]);
+    }
+  }
+  explicit BasicMatrix(const Matrix &other)
+      : BasicMatrix(other.rowCount(), other.colCount(), Uninitialized()) {
+    const double *src = other.data();
+    for (size_t i = 0; i < n_rows * n_cols; ++i) {
+      vals[i] = T(src[i]);
+    }
+  }
+  BasicMatrix &operator=(const BasicMatrix &a) {
+    if (this != &a) {
+      if (n_rows * n_cols != a.n_rows * a.n_cols) {
+        T *new_vals = allocate(a.n_rows * a.n_cols);
+        deallocate(vals, n_rows * n_cols);
+        vals = new_vals;
+      }
+      n_rows = a.n_rows;
+      n_cols = a.n_cols;
+      std::copy(a.vals, a.vals + n_rows * n_cols, vals);
+    }
+    return *this;
+  }
+  BasicMatrix &operator=(BasicMatrix &&a) noexcept {
+    std::swap(vals, a.vals);
+    std::swap(n_rows, a.n_rows);
+    std::swap(n_cols, a.n_cols);
+    return *this;
+  }
+  ~BasicMatrix() {
+    deallocate(vals, n_rows * n_cols);
+  }
+
+  Matrix toMatrix() const {
+    Matrix result(n_rows, n_cols);
+    for (size_t i = 0; i < n_rows; ++i) {
+      for (size_t j = 0; j < n_cols; ++j) {
+        result(i, j) = static_cast<double>((*this)(i, j));
+      }
+    }
+    return result;
+  }
+
+  // Checked as bounds::Default says, like Matrix::get.
+  template<class Bounds = bounds::Default>
+  T &get(size_t row, size_t col) {
+    Bounds::check(row, n_rows);
+    Bounds::check(col, n_cols);
+    return vals[n_cols * row + col];
+  }
+  template<class Bounds = bounds::Default>
+  const T &get(size_t row, size_t col) const {
+    Bounds::check(row, n_rows);
+    Bounds::check(col, n_cols);
+    return vals[n_cols * row + col];
+  }
+  template<class Bounds = bounds::Default>
+  void set(size_t row, size_t col, const T &value) {
+    get<Bounds>(row, col) = value;
+  }
+
+  T *operator[](size_t row) {
+    bounds::Default::check(row, n_rows);
+    return vals + row * n_cols;
+  }
+  const T *operator[](size_t row) const {
+    bounds::Default::check(row, n_rows);
+    return vals + row * n_cols;
+  }
+
+  // Unchecked element access.
+  T &operator()(size_t row, size_t col) {
+    return vals[n_cols * row + col];
+  }
+  const T &operator()(size_t row, size_t col) const {
+    return vals[n_cols * row + col];
+  }
+
+  size_t rowCount() const {
+    return n_rows;
+  }
+  size_t colCount() const {
+    return n_cols;
+  }
+  T *data() {
+    return vals;
+  }
+  const T *data() const {
+    return vals;
+  }
+
+  void resize(size_t new_rows, size_t new_cols) {
+    if (new_rows == n_rows && new_cols == n_cols) {
+      return;
+    }
+    T *new_vals = allocate(checkedSize(new_rows, new_cols));
+    for (size_t i = 0; i < new_rows; ++i) {
+      for (size_t j = 0; j < new_cols; ++j) {
+        new_vals[new_cols * i + j] = i < n_rows && j < n_cols ? vals[n_cols * i + j] : T(0);
+      }
+    }
+    deallocate(vals, n_rows * n_cols);
+    vals = new_vals;
+    n_rows = new_rows;
+    n_cols = new_cols;
+  }
+
+  BasicMatrix &operator+=(const BasicMatrix &a) {
+    checkSameShape(a);
+    auto add = kernels().add;
+    size_t size = n_rows * n_cols;
+    parallel::forRange(0, size, size, [&](size_t from, size_t to) {
+      add(vals + from, a.vals + from, to - from);
+    });
+    return *this;
+  }
+  BasicMatrix &operator-=(const BasicMatrix &a) {
+    checkSameShape(a);
+    auto sub = kernels().sub;
+    size_t size = n_rows * n_cols;
+    parallel::forRange(0, size, size, [&](size_t from, size_t to) {
+      sub(vals + from, a.vals + from, to - from);
+    });
+    return *this;
+  }
+  BasicMatrix &operator*=(const BasicMatrix &a) {
+    *this = *this * a;
+    return *this;
+  }
+  BasicMatrix &operator*=(const T &number) {
+    auto scale = kernels().scale;
+    size_t size = n_rows * n_cols;
+    parallel::forRange(0, size, size, [&](size_t from, size_t to) {
+      scale(vals + from, number, to - from);
+    });
+    return *this;
+  }
+
+  // Integers use fraction-free (Bareiss) elimination, which is exact; it
+  // throws OverflowException if the determinant is outside the range of T
+  // or a product of two of its intermediate minors leaves 128 bits. For
+  // int32_t elements the latter takes matrices larger than 3 x 3 with
+  // entries near the ends of the range. The other types use Gaussian
+  // elimination with partial pivoting in T.
+  T det() const {
+    if (n_rows != n_cols) {
+      throw SizeMismatchException();
+    }
+    return detOf(std::is_integral<T>());
+  }
+
+  void transpose() {
+    *this = transposed();
+  }
+
+  BasicMatrix transposed() const {
+    BasicMatrix result(n_cols, n_rows, Uninitialized());
+    const size_t tile = transposition::TILE;
+    parallel::forRange(0, (n_rows + tile - 1) / tile, n_rows * n_cols, [&](size_t from, size_t to) {
+      for (size_t i0 = from * tile; i0 < std::min(to * tile, n_rows); i0 += tile) {
+        for (size_t j0 = 0; j0 < n_cols; j0 += tile) {
+          for (size_t i = i0; i < std::min(i0 + tile, n_rows); ++i) {
+            for (size_t j = j0; j < std::min(j0 + tile, n_cols); ++j) {
+              result.vals[j * n_rows + i] = vals[i * n_cols + j];
+            }
+          }
+        }
+      }
+    });
+    return result;
+  }
+
+  T trace() const {
+    if (n_rows != n_cols) {
+      throw SizeMismatchException();
+    }
+    T result = T(0);
+    for (size_t i = 0; i < n_rows; ++i) {
+      result += vals[i * n_cols + i];
+    }
+    return result;
+  }
+
+  std::vector<T> getRow(size_t row) const {
+    if (row >= n_rows) {
+      throw OutOfBoundsException();
+    }
+    return std::vector<T>(vals + n_cols * row, vals + n_cols * (row + 1));
+  }
+  std::vector<T> getColumn(size_t column) const {
+    if (column >= n_cols) {
+      throw OutOfBoundsException();
+    }
+    std::vector<T> result(n_rows);
+    for (size_t i = 0; i < n_rows; ++i) {
+      result[i] = vals[n_cols * i + column];
+    }
+    return result;
+  }
+
+  // Rows of a against panels of b: every row of the result accumulates
+  // a(i, l) * (row l of b) with the axpy kernel, over blocks of b small
+  // enough to stay in cache while all the rows of a thread pass over them.
+  friend BasicMatrix operator*(const BasicMatrix &a, const BasicMatrix &b) {
+    if (a.n_cols != b.n_rows) {
+      throw SizeMismatchException();
+    }
+    size_t m = a.n_rows, k = a.n_cols, n = b.n_cols;
+    BasicMatrix result(m, n, Uninitialized());
+    std::fill(result.vals, result.vals + m * n, T(0));
+    const size_t kb = 128, nb = std::max<size_t>((256 << 10) / (kb * sizeof(T)), 64);
+    auto axpy = kernels().axpy;
+    parallel::forRange(0, m, m * n * k, [&](size_t from, size_t to) {
+      for (size_t j0 = 0; j0 < n; j0 += nb) {
+        size_t cols = std::min(nb, n - j0);
+        for (size_t l0 = 0; l0 < k; l0 += kb) {
+          size_t l1 = std::min(l0 + kb, k);
+          for (size_t i = from; i < to; ++i) {
+            const T *a_row = a.vals + i * k;
+            T *c_row = result.vals + i * n + j0;
+            for (size_t l = l0; l < l1; ++l) {
+              axpy(c_row, a_row[l], b.vals + l * n + j0, cols);
+            }
+          }
+        }
+      }
+    });
+    return result;
+  }
+
+private:
+  // Tag for constructing a matrix whose values are about to be overwritten.
+  struct Uninitialized {};
+  BasicMatrix(size_t rows, size_t cols, Uninitialized)
+      : vals(allocate(checkedSize(rows, cols))), n_rows(rows), n_cols(cols) {}
+
+  // rows * cols; throws OverflowException beyond MAX_ELEMENTS, where the
+  // product would wrap.
+  static size_t checkedSize(size_t rows, size_t cols) {
+    if (!fitsElements(rows, cols)) {
+      throw OverflowException();
+    }
+    return rows * cols;
+  }
+
+  // The storage policy hands out doubles; elements are packed into them.
+  static size_t doubles(size_t size) {
+    return (size * sizeof(T) + sizeof(double) - 1) / sizeof(double);
+  }
+  static T *allocate(size_t size) {
+    return reinterpret_cast<T *>(storage::policy().allocate(doubles(size)));
+  }
+  static void deallocate(T *data, size_t size) {
+    storage::policy().deallocate(reinterpret_cast<double *>(data), doubles(size));
+  }
+
+  static const simd::TypedKernels<T> &kernels() {
+    return kernelsOf(simd::HasKernels<T>());
+  }
+  static const simd::TypedKernels<T> &kernelsOf(std::true_type) {
+    return simd::activeFor<T>();
+  }
+  static const simd::TypedKernels<T> &kernelsOf(std::false_type) {
+    return simd::genericKernels<T>();
+  }
+
+  void checkSameShape(const BasicMatrix &a) const {
+    if (n_rows != a.n_rows || n_cols != a.n_cols) {
+      throw SizeMismatchException();
+    }
+  }
+
+  // Bareiss: after step k, m(i, j) for i, j > k is the minor of rows and
+  // columns 0..k plus i and j, so every division is exact. Returns false
+  // if a step leaves Wide.
+  template<class Wide>
+  bool bareiss(Wide &det) const {
+    size_t n = n_rows;
+    std::vector<Wide> m(vals, vals + n * n);
+    Wide previous = 1;
+    bool negate = false;
+    for (size_t k = 0; k < n; ++k) {
+      size_t pivot = k;
+      while (pivot < n && m[pivot * n + k] == 0) {
+        ++pivot;
+      }
+      if (pivot == n) {
+        det = 0;
+        return true;
+      }
+      if (pivot != k) {
+        std::swap_ranges(m.begin() + k * n, m.begin() + (k + 1) * n, m.begin() + pivot * n);
+        negate = !negate;
+      }
+      for (size_t i = k + 1; i < n; ++i) {
+        for (size_t j = k + 1; j < n; ++j) {
+          Wide left, right, value;
+          if (__builtin_mul_overflow(m[i * n + j], m[k * n + k], &left) ||
+              __builtin_mul_overflow(m[i * n + k], m[k * n + j], &right) ||
+              __builtin_sub_overflow(left, right, &value)) {
+            return false;
+          }
+          // Only -1 can take a quotient out of range.
+          if (previous == -1) {
+            if (__builtin_sub_overflow(Wide(0), value, &m[i * n + j])) {
+              return false;
+            }
+          } else {
+            m[i * n + j] = value / previous;
+          }
+        }
+      }
+      previous = m[k * n + k];
+    }
+    det = n == 0 ? 1 : m[n * n - 1];
+    return !negate || !__builtin_sub_overflow(Wide(0), det, &det);
+  }
+
+  // In 64 bits for 32-bit elements, which is enough for most matrices
+  // and faster, then in 128 bits.
+  T detOf(std::true_type) const {
+    __int128 det = 0;
+    bool exact = false;
+    if constexpr (sizeof(T) <= 4) {
+      int64_t narrow;
+      if (bareiss(narrow)) {
+        det = narrow;
+        exact = true;
+      }
+    }
+    if (!exact && !bareiss(det)) {
+      throw OverflowException();
+    }
+    if (det < std::numeric_limits<T>::min() || det > std::numeric_limits<T>::max()) {
+      throw OverflowException();
+    }
+    return static_cast<T>(det);
+  }
+
+  T detOf(std::false_type) const {
+    size_t n = n_rows;
+    std::vector<T> m(vals, vals + n * n);
+    auto magnitude = [](T value) {
+      return value < T(0) ? -value : value;
+    };
+    T result = T(1);
+    for (size_t k = 0; k < n; ++k) {
+      size_t pivot = k;
+      for (size_t i = k + 1; i < n; ++i) {
+        if (magnitude(m[i * n + k]) > magnitude(m[pivot * n + k])) {
+          pivot = i;
+        }
+      }
+      if (m[pivot * n + k] == T(0)) {
+        return T(0);
+      }
+      if (pivot != k) {
+        std::swap_ranges(m.begin() + k * n, m.begin() + (k + 1) * n, m.begin() + pivot * n);
+        result = -result;
+      }
+      T diagonal = m[k * n + k];
+      result *= diagonal;
+      for (size_t i = k + 1; i < n; ++i) {
+        T factor = m[i * n + k] / diagonal;
+        for (size_t j = k + 1; j < n; ++j) {
+          m[i * n + j] -= factor * m[k * n + j];
+        }
+      }
+    }
+    return result;
+  }
+
+  T *vals;
+  size_t n_rows;
+  size_t n_cols;
+};
+
+template<class T>
+BasicMatrix<T> operator+(const BasicMatrix<T> &a, const BasicMatrix<T> &b) {
+  BasicMatrix<T> result = a;
+  result += b;
+  return result;
+}
+
+template<class T>
+BasicMatrix<T> operator-(const BasicMatrix<T> &a, const BasicMatrix<T> &b) {
+  BasicMatrix<T> result = a;
+  result -= b;
+  return result;
+}
+
+template<class T>
+BasicMatrix<T> operator-(const BasicMatrix<T> &a) {
+  BasicMatrix<T> result = a;
+  result *= T(-1);
+  return result;
+}
+
+template<class T>
+const BasicMatrix<T> &operator+(const BasicMatrix<T> &a) {
+  return a;
+}
+
+template<class T>
+BasicMatrix<T> operator*(const BasicMatrix<T> &a, const T &number) {
+  BasicMatrix<T> result = a;
+  result *= number;
+  return result;
+}
+
+template<class T>
+BasicMatrix<T> operator*(const T &number, const BasicMatrix<T> &a) {
+  return a * number;
+}
+
+// Elements differ by at most Tolerance<T>::value; like Matrix, different
+// shapes throw SizeMismatchException.
+template<class T>
+bool operator==(const BasicMatrix<T> &a, const BasicMatrix<T> &b) {
+  if (a.rowCount() != b.rowCount() || a.colCount() != b.colCount()) {
+    throw SizeMismatchException();
+  }
+  for (size_t i = 0; i < a.rowCount(); ++i) {
+    for (size_t j = 0; j < a.colCount(); ++j) {
+      T difference = a(i, j) < b(i, j) ? b(i, j) - a(i, j) : a(i, j) - b(i, j);
+      if (difference > Tolerance<T>::value) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+template<class T>
+bool operator!=(const BasicMatrix<T> &a, const BasicMatrix<T> &b) {
+  return !(a == b);
+}
+
+// Same text layout as Matrix: values separated by spaces, one row per
+// line; input starts with the number of rows and columns.
+template<class T>
+std::ostream &operator<<(std::ostream &output, const BasicMatrix<T> &matrix) {
+  for (size_t i = 0; i < matrix.rowCount(); ++i) {
+    for (size_t j = 0; j < matrix.colCount(); ++j) {
+      output << matrix(i, j) << " ";
+    }
+    output << "\n";
+  }
+  return output.flush();
+}
+
+template<class T>
+std::istream &operator>>(std::istream &input, BasicMatrix<T> &matrix) {
+  size_t rows, cols;
+  if (!(input >> rows >> cols)) {
+    return input;
+  }
+  if (!fitsElements(rows, cols)) {
+    input.setstate(std::ios_base::failbit);
+    return input;
+  }
+  matrix = BasicMatrix<T>(rows, cols);
+  T *value = matrix.data();
+  for (size_t i = 0; i < rows * cols; ++i) {
+    if (!(input >> value[i])) {
+      std::fill(value + i, value + rows * cols, T(0));
+      break;
+    }
+  }
+  return input;
+}
+
+} // namespace task
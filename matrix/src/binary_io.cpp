@@ -0,0 +1,226 @@
+#include "binary_io.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <system_error>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace task;
+using namespace task::binary;
+
+namespace {
+
+bool isPowerOfTwo(uint32_t value) {
+  return value != 0 && (value & (value - 1)) == 0;
+}
+
+// Checks everything but the payload and returns its size in bytes.
+size_t payloadBytes(const Header &header) {
+  if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION ||
+      header.dtype != static_cast<uint32_t>(DType::kFloat64) || header.byte_order != BYTE_ORDER_MARK ||
+      header.alignment < sizeof(Header) || !isPowerOfTwo(header.alignment)) {
+    throw FormatException();
+  }
+  if (header.rows != 0 && header.cols > MAX_ELEMENTS / header.rows) {
+    throw FormatException();
+  }
+  return header.rows * header.cols * sizeof(double);
+}
+
+Header makeHeader(size_t rows, size_t cols) {
+  Header header{};
+  std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+  header.version = VERSION;
+  header.dtype = static_cast<uint32_t>(DType::kFloat64);
+  header.byte_order = BYTE_ORDER_MARK;
+  header.alignment = PAYLOAD_ALIGNMENT;
+  header.rows = rows;
+  header.cols = cols;
+  return header;
+}
+
+void checkStream(const std::ios &stream, const char *what) {
+  if (!stream) {
+    throw std::ios_base::failure(what);
+  }
+}
+
+// Bytes from the read position to the end of input, or -1 if it cannot
+// seek, like a pipe.
+std::streamoff remainingBytes(std::istream &input) {
+  std::streampos position = input.tellg();
+  if (position == std::streampos(-1)) {
+    return -1;
+  }
+  input.seekg(0, std::ios::end);
+  std::streampos end = input.tellg();
+  input.clear();
+  input.seekg(position);
+  if (!input || end == std::streampos(-1)) {
+    input.clear();
+    return -1;
+  }
+  return end - position;
+}
+
+} // namespace
+
+void binary::write(std::ostream &output, const ConstMatrixView &matrix) {
+  size_t rows = matrix.rowCount(), cols = matrix.colCount();
+  char prefix[PAYLOAD_ALIGNMENT] = {};
+  Header header = makeHeader(rows, cols);
+  std::memcpy(prefix, &header, sizeof(header));
+  output.write(prefix, sizeof(prefix));
+
+  if (matrix.colStride() == 1 && matrix.rowStride() == cols) {
+    output.write(reinterpret_cast<const char *>(matrix.data()), rows * cols * sizeof(double));
+  } else {
+    std::vector<double> row(cols);
+    for (size_t i = 0; i < rows && output; ++i) {
+      for (size_t j = 0; j < cols; ++j) {
+        row[j] = matrix.at(i, j);
+      }
+      output.write(reinterpret_cast<const char *>(row.data()), cols * sizeof(double));
+    }
+  }
+  checkStream(output, "binary::write failed");
+}
+
+void binary::save(const std::string &path, const ConstMatrixView &matrix) {
+  std::ofstream output(path, std::ios::binary | std::ios::trunc);
+  checkStream(output, "binary::save cannot open the file");
+  write(output, matrix);
+  output.close();
+  checkStream(output, "binary::save failed");
+}
+
+Matrix binary::read(std::istream &input) {
+  Header header;
+  if (!input.read(reinterpret_cast<char *>(&header), sizeof(header))) {
+    throw FormatException();
+  }
+  size_t bytes = payloadBytes(header);
+  if (!input.ignore(header.alignment - sizeof(header))) {
+    throw FormatException();
+  }
+  std::streamoff remaining = remainingBytes(input);
+  if (remaining >= 0) {
+    // A corrupt or truncated header fails here rather than allocating.
+    if (static_cast<uint64_t>(remaining) < bytes) {
+      throw FormatException();
+    }
+    Matrix result(header.rows, header.cols, Matrix::Uninitialized());
+    if (!input.read(reinterpret_cast<char *>(result.vals), bytes)) {
+      throw FormatException();
+    }
+    return result;
+  }
+  // Without the length up front, grow a buffer as the data arrives, so
+  // that a header claiming more than the stream holds fails at its end.
+  const size_t chunk = 1 << 17;
+  size_t count = bytes / sizeof(double);
+  std::vector<double> buffer;
+  while (buffer.size() < count) {
+    size_t done = buffer.size(), step = std::min(chunk, count - done);
+    buffer.resize(done + step);
+    if (!input.read(reinterpret_cast<char *>(buffer.data() + done), step * sizeof(double))) {
+      throw FormatException();
+    }
+  }
+  Matrix result(header.rows, header.cols, Matrix::Uninitialized());
+  std::copy(buffer.begin(), buffer.end(), result.vals);
+  return result;
+}
+
+Matrix binary::load(const std::string &path) {
+  std::ifstream input(path, std::ios::binary);
+  if (!input) {
+    throw std::system_error(errno, std::generic_category(), path);
+  }
+  return read(input);
+}
+
+MappedMatrix::MappedMatrix(const std::string &path)
+    : mapping(nullptr), mapping_size(0), vals(nullptr), n_rows(0), n_cols(0) {
+  int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    throw std::system_error(errno, std::generic_category(), path);
+  }
+  struct stat info;
+  if (::fstat(fd, &info) != 0) {
+    int error = errno;
+    ::close(fd);
+    throw std::system_error(error, std::generic_category(), path);
+  }
+  size_t file_size = info.st_size;
+  if (file_size < sizeof(Header)) {
+    ::close(fd);
+    throw FormatException();
+  }
+  void *address = ::mmap(nullptr, file_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  int error = errno;
+  ::close(fd);
+  if (address == MAP_FAILED) {
+    throw std::system_error(error, std::generic_category(), path);
+  }
+  mapping = address;
+  mapping_size = file_size;
+
+  Header header;
+  std::memcpy(&header, mapping, sizeof(header));
+  size_t bytes;
+  try {
+    bytes = payloadBytes(header);
+  } catch (...) {
+    unmap();
+    throw;
+  }
+  if (header.alignment > file_size || bytes > file_size - header.alignment) {
+    unmap();
+    throw FormatException();
+  }
+  vals = reinterpret_cast<const double *>(static_cast<const char *>(mapping) + header.alignment);
+  n_rows = header.rows;
+  n_cols = header.cols;
+}
+
+MappedMatrix::MappedMatrix(MappedMatrix &&other) noexcept
+    : mapping(other.mapping), mapping_size(other.mapping_size), vals(other.vals),
+      n_rows(other.n_rows), n_cols(other.n_cols) {
+  other.mapping = nullptr;
+  other.mapping_size = 0;
+  other.vals = nullptr;
+  other.n_rows = other.n_cols = 0;
+}
+
+MappedMatrix &MappedMatrix::operator=(MappedMatrix &&other) noexcept {
+  if (this != &other) {
+    unmap();
+    std::swap(mapping, other.mapping);
+    std::swap(mapping_size, other.mapping_size);
+    std::swap(vals, other.vals);
+    std::swap(n_rows, other.n_rows);
+    std::swap(n_cols, other.n_cols);
+  }
+  return *this;
+}
+
+MappedMatrix::~MappedMatrix() {
+  unmap();
+}
+
+void MappedMatrix::unmap() {
+  if (mapping) {
+    ::munmap(mapping, mapping_size);
+  }
+  mapping = nullptr;
+  mapping_size = 0;
+  vals = nullptr;
+  n_rows = n_cols = 0;
+}
+
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include "common.h"
+#include "matrix.h"
+
+namespace task {
+namespace binary {
+
+// On-disk layout: a Header, zero padding up to header.alignment bytes,
+// then rows * cols doubles in row-major order. The payload offset is a
+// multiple of 64, so a mapped payload is as aligned as a Matrix buffer.
+const char MAGIC[8] = {'T', 'A', 'S', 'K', 'M', 'A', 'T', '\0'};
+const uint32_t VERSION = 1;
+const uint32_t BYTE_ORDER_MARK = 0x01020304;
+const uint32_t PAYLOAD_ALIGNMENT = 64;
+
+enum class DType : uint32_t {
+  kFloat64 = 1,
+};
+
+struct Header {
+  char magic[8];
+  uint32_t version;
+  uint32_t dtype;
+  uint32_t byte_order;  // BYTE_ORDER_MARK as stored by the writer
+  uint32_t alignment;   // offset of the payload from the start of the file
+  uint64_t rows;
+  uint64_t cols;
+};
+
+static_assert(sizeof(Header) <= PAYLOAD_ALIGNMENT, "Header must fit before the payload");
+
+// Writers throw std::ios_base::failure if the stream or file fails.
+void write(std::ostream &output, const ConstMatrixView &matrix);
+void save(const std::string &path, const ConstMatrixView &matrix);
+
+// Matrices and views are written from their storage, other expressions
+// are evaluated first.
+template<class E>
+void write(std::ostream &output, const MatrixExpr<E> &matrix) {
+  write(output, materialize(matrix.self()).view());
+}
+template<class E>
+void save(const std::string &path, const MatrixExpr<E> &matrix) {
+  save(path, materialize(matrix.self()).view());
+}
+
+// Readers throw FormatException if the data is not a matrix in this format
+// (wrong magic, version, dtype or byte order, or a truncated payload).
+// The payload size is checked against the rest of a seekable stream before
+// anything is allocated; other streams are read in chunks.
+Matrix read(std::istream &input);
+Matrix load(const std::string &path);
+
+// Read-only matrix backed by a memory-mapped file: opening it reads only
+// the header, pages of the payload are loaded by the OS on first access.
+// Throws std::system_error if the file cannot be opened or mapped and
+// FormatException as read() does.
+class MappedMatrix : public MatrixExpr<MappedMatrix> {
+public:
+  static constexpr bool held_by_reference = true;
+
+  explicit MappedMatrix(const std::string &path);
+  MappedMatrix(MappedMatrix &&other) noexcept;
+  MappedMatrix &operator=(MappedMatrix &&other) noexcept;
+  MappedMatrix(const MappedMatrix &) = delete;
+  MappedMatrix &operator=(const MappedMatrix &) = delete;
+  ~MappedMatrix();
+
+  // Views share the mapping and must not outlive the MappedMatrix.
+  ConstMatrixView view() const {
+    return ConstMatrixView(vals, n_rows, n_cols, n_cols);
+  }
+
+  // Checked as bounds::Default says, like Matrix::get.
+  const double &get(size_t row, size_t col) const {
+    bounds::Default::check(row, n_rows);
+    bounds::Default::check(col, n_cols);
+    return vals[n_cols * row + col];
+  }
+
+  // Expression interface; at() is not bounds checked.
+  size_t rowCount() const {
+    return n_rows;
+  }
+  size_t colCount() const {
+    return n_cols;
+  }
+  double at(size_t row, size_t col) const {
+    return vals[n_cols * row + col];
+  }
+  const double *data() const {
+    return vals;
+  }
+  size_t rowStride() const {
+    return n_cols;
+  }
+  size_t colStride() const {
+    return 1;
+  }
+
+private:
+  void unmap();
+
+  void *mapping;
+  size_t mapping_size;
+  const double *vals;
+  size_t n_rows;
+  size_t n_cols;
+};
+
+} // namespace binary
+
+// Products with a mapped matrix read the mapping in place.
+inline ConstMatrixView materialize(const binary::MappedMatrix &a) {
+  return a.view();
+}
+
+} // namespace task
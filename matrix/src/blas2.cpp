@@ -0,0 +1,329 @@
+#include "blas2.h"
+#include "simd.h"
+#include "thread_pool.h"
+#include <algorithm>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define TASK_BLAS2_X86
+#include <immintrin.h>
+#endif
+
+using namespace task;
+
+namespace {
+
+// Column-major A is walked in blocks of this many rows, so that the
+// slice of y being accumulated stays in L1.
+const size_t ROW_BLOCK = 1024;
+
+// out[r] = dot(row r of A, x) for R consecutive rows of row-major A.
+using DotKernel = void (*)(const double *a, size_t lda, const double *x, size_t n, double *out);
+
+template<size_t R>
+void dotRows(const double *a, size_t lda, const double *x, size_t n, double *out) {
+  for (size_t r = 0; r < R; ++r) {
+    const double *row = a + r * lda;
+    // Independent partial sums, so the additions do not wait on each other.
+    double sum[4] = {};
+    size_t j = 0;
+    for (; j + 4 <= n; j += 4) {
+      for (size_t t = 0; t < 4; ++t) {
+        sum[t] += row[j + t] * x[j + t];
+      }
+    }
+    for (; j < n; ++j) {
+      sum[0] += row[j] * x[j];
+    }
+    out[r] = (sum[0] + sum[1]) + (sum[2] + sum[3]);
+  }
+}
+
+#ifdef TASK_BLAS2_X86
+
+// R rows share every load of x; a single row gets four accumulators
+// instead, to hide the latency of the fused multiply-add.
+
+template<size_t R>
+__attribute__((target("avx2,fma"))) void dotRowsAvx2(const double *a, size_t lda, const double *x,
+                                                     size_t n, double *out) {
+  const size_t U = R >= 4 ? 1 : 4 / R;
+  __m256d acc[R][U];
+#pragma GCC unroll 4
+  for (size_t r = 0; r < R; ++r) {
+#pragma GCC unroll 4
+    for (size_t u = 0; u < U; ++u) {
+      acc[r][u] = _mm256_setzero_pd();
+    }
+  }
+  size_t j = 0;
+  for (; j + 4 * U <= n; j += 4 * U) {
+#pragma GCC unroll 4
+    for (size_t u = 0; u < U; ++u) {
+      __m256d xv = _mm256_loadu_pd(x + j + 4 * u);
+#pragma GCC unroll 4
+      for (size_t r = 0; r < R; ++r) {
+        acc[r][u] = _mm256_fmadd_pd(_mm256_loadu_pd(a + r * lda + j + 4 * u), xv, acc[r][u]);
+      }
+    }
+  }
+  for (size_t r = 0; r < R; ++r) {
+    for (size_t u = 1; u < U; ++u) {
+      acc[r][0] = _mm256_add_pd(acc[r][0], acc[r][u]);
+    }
+    double lanes[4];
+    _mm256_storeu_pd(lanes, acc[r][0]);
+    double sum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+    for (size_t t = j; t < n; ++t) {
+      sum += a[r * lda + t] * x[t];
+    }
+    out[r] = sum;
+  }
+}
+
+template<size_t R>
+__attribute__((target("avx512f"))) void dotRowsAvx512(const double *a, size_t lda, const double *x,
+                                                      size_t n, double *out) {
+  const size_t U = R >= 4 ? 1 : 4 / R;
+  __m512d acc[R][U];
+#pragma GCC unroll 4
+  for (size_t r = 0; r < R; ++r) {
+#pragma GCC unroll 4
+    for (size_t u = 0; u < U; ++u) {
+      acc[r][u] = _mm512_setzero_pd();
+    }
+  }
+  size_t j = 0;
+  for (; j + 8 * U <= n; j += 8 * U) {
+#pragma GCC unroll 4
+    for (size_t u = 0; u < U; ++u) {
+      __m512d xv = _mm512_loadu_pd(x + j + 8 * u);
+#pragma GCC unroll 4
+      for (size_t r = 0; r < R; ++r) {
+        acc[r][u] = _mm512_fmadd_pd(_mm512_loadu_pd(a + r * lda + j + 8 * u), xv, acc[r][u]);
+      }
+    }
+  }
+  for (size_t r = 0; r < R; ++r) {
+    for (size_t u = 1; u < U; ++u) {
+      acc[r][0] = _mm512_add_pd(acc[r][0], acc[r][u]);
+    }
+    // Through memory as in the AVX2 kernel: _mm512_reduce_add_pd extracts
+    // halves into undefined registers, which GCC warns about.
+    double lanes[8];
+    _mm512_storeu_pd(lanes, acc[r][0]);
+    double sum = ((lanes[0] + lanes[1]) + (lanes[2] + lanes[3])) + ((lanes[4] + lanes[5]) + (lanes[6] + lanes[7]));
+    for (size_t t = j; t < n; ++t) {
+      sum += a[r * lda + t] * x[t];
+    }
+    out[r] = sum;
+  }
+}
+
+#endif // TASK_BLAS2_X86
+
+struct DotKernels {
+  DotKernel four;
+  DotKernel one;
+};
+
+// Follows the instruction set picked for the element-wise kernels.
+DotKernels dotKernelsFor(simd::Isa isa) {
+#ifdef TASK_BLAS2_X86
+  if (isa == simd::Isa::kAvx512) {
+    return {dotRowsAvx512<4>, dotRowsAvx512<1>};
+  }
+  if (isa == simd::Isa::kAvx2 && __builtin_cpu_supports("fma")) {
+    return {dotRowsAvx2<4>, dotRowsAvx2<1>};
+  }
+#endif
+  return {dotRows<4>, dotRows<1>};
+}
+
+// y = alpha * t + beta * y without reading y when beta == 0.
+inline void update(double &y, double alpha, double t, double beta) {
+  y = beta == 0. ? alpha * t : beta * y + alpha * t;
+}
+
+void scale(double *y, double beta, size_t n) {
+  if (beta == 0.) {
+    std::fill(y, y + n, 0.);
+  } else if (beta != 1.) {
+    simd::active().scale(y, beta, n);
+  }
+}
+
+// Solves the diagonal block of unknowns [from, to) after everything
+// outside it has been eliminated.
+void solveBlock(blas2::Triangle triangle, blas2::Diagonal diagonal, size_t from, size_t to,
+                const double *a, size_t rsa, size_t csa, double *x, DotKernel dot) {
+  bool lower = triangle == blas2::Triangle::kLower;
+  for (size_t step = from; step < to; ++step) {
+    size_t i = lower ? step : from + to - 1 - step;
+    // Already solved unknowns of the block: [from, i) below, (i, to) above.
+    size_t first = lower ? from : i + 1, last = lower ? i : to;
+    const double *row = a + i * rsa;
+    double sum = 0.;
+    if (csa == 1) {
+      dot(row + first, 0, x + first, last - first, &sum);
+    } else {
+      for (size_t p = first; p < last; ++p) {
+        sum += row[p * csa] * x[p];
+      }
+    }
+    x[i] -= sum;
+    if (diagonal == blas2::Diagonal::kNonUnit) {
+      x[i] /= row[i * csa];
+    }
+  }
+}
+
+} // namespace
+
+void blas2::gemv(size_t m, size_t n, double alpha,
+                 const double *a, size_t rsa, size_t csa,
+                 const double *x, double beta, double *y) {
+  if (m == 0) {
+    return;
+  }
+  if (n == 0 || alpha == 0.) {
+    scale(y, beta, m);
+    return;
+  }
+  if (csa == 1) {
+    // Row-major: one dot product per element of y, four rows at a time.
+    // Threads get whole groups of four, so results do not depend on
+    // the thread count.
+    DotKernels dot = dotKernelsFor(simd::activeIsa());
+    parallel::forRange(0, (m + 3) / 4, m * n, [&](size_t from, size_t to) {
+      double t[4];
+      size_t i = from * 4;
+      to = std::min(m, to * 4);
+      for (; i + 4 <= to; i += 4) {
+        dot.four(a + i * rsa, rsa, x, n, t);
+        for (size_t r = 0; r < 4; ++r) {
+          update(y[i + r], alpha, t[r], beta);
+        }
+      }
+      for (; i < to; ++i) {
+        dot.one(a + i * rsa, rsa, x, n, t);
+        update(y[i], alpha, t[0], beta);
+      }
+    });
+  } else if (rsa == 1) {
+    // Column-major: y is a sum of columns scaled by x, accumulated one
+    // block of rows at a time.
+    const simd::TypedKernels<double> &kernels = simd::activeFor<double>();
+    size_t blocks = (m + ROW_BLOCK - 1) / ROW_BLOCK;
+    parallel::forRange(0, blocks, m * n, [&](size_t from, size_t to) {
+      for (size_t ib = from * ROW_BLOCK; ib < std::min(m, to * ROW_BLOCK); ib += ROW_BLOCK) {
+        size_t mb = std::min(ROW_BLOCK, m - ib);
+        scale(y + ib, beta, mb);
+        for (size_t j = 0; j < n; ++j) {
+          kernels.axpy(y + ib, alpha * x[j], a + j * csa + ib, mb);
+        }
+      }
+    });
+  } else {
+    parallel::forRange(0, m, m * n, [&](size_t from, size_t to) {
+      for (size_t i = from; i < to; ++i) {
+        double sum = 0.;
+        for (size_t j = 0; j < n; ++j) {
+          sum += a[i * rsa + j * csa] * x[j];
+        }
+        update(y[i], alpha, sum, beta);
+      }
+    });
+  }
+}
+
+void blas2::ger(size_t m, size_t n, double alpha, const double *x, const double *y,
+                double *a, size_t rsa, size_t csa) {
+  if (m == 0 || n == 0 || alpha == 0.) {
+    return;
+  }
+  const simd::TypedKernels<double> &kernels = simd::activeFor<double>();
+  if (csa == 1) {
+    parallel::forRange(0, m, m * n, [&](size_t from, size_t to) {
+      for (size_t i = from; i < to; ++i) {
+        kernels.axpy(a + i * rsa, alpha * x[i], y, n);
+      }
+    });
+  } else if (rsa == 1) {
+    parallel::forRange(0, n, m * n, [&](size_t from, size_t to) {
+      for (size_t j = from; j < to; ++j) {
+        kernels.axpy(a + j * csa, alpha * y[j], x, m);
+      }
+    });
+  } else {
+    parallel::forRange(0, m, m * n, [&](size_t from, size_t to) {
+      for (size_t i = from; i < to; ++i) {
+        for (size_t j = 0; j < n; ++j) {
+          a[i * rsa + j * csa] += alpha * x[i] * y[j];
+        }
+      }
+    });
+  }
+}
+
+void blas2::trsv(Triangle triangle, Diagonal diagonal, size_t n,
+                 const double *a, size_t rsa, size_t csa, double *x) {
+  DotKernel dot = dotKernelsFor(simd::activeIsa()).one;
+  if (triangle == Triangle::kLower) {
+    for (size_t k = 0; k < n; k += NB) {
+      size_t nb = std::min(NB, n - k);
+      solveBlock(triangle, diagonal, k, k + nb, a, rsa, csa, x, dot);
+      // Eliminates the solved block from the unknowns below it.
+      gemv(n - k - nb, nb, -1., a + (k + nb) * rsa + k * csa, rsa, csa, x + k, 1., x + k + nb);
+    }
+  } else {
+    for (size_t end = n; end > 0;) {
+      size_t k = end > NB ? end - NB : 0;
+      solveBlock(triangle, diagonal, k, end, a, rsa, csa, x, dot);
+      // And from the unknowns above it.
+      gemv(k, end - k, -1., a + k * csa, rsa, csa, x + k, 1., x);
+      end = k;
+    }
+  }
+}
+
+void task::gemv(double alpha, const ConstMatrixView &a, const std::vector<double> &x,
+                double beta, std::vector<double> &y) {
+  if (a.colCount() != x.size() || a.rowCount() != y.size()) {
+    throw SizeMismatchException();
+  }
+  blas2::gemv(a.rowCount(), a.colCount(), alpha, a.data(), a.rowStride(), a.colStride(),
+              x.data(), beta, y.data());
+}
+
+void task::ger(double alpha, const std::vector<double> &x, const std::vector<double> &y, const MatrixView &a) {
+  if (a.rowCount() != x.size() || a.colCount() != y.size()) {
+    throw SizeMismatchException();
+  }
+  blas2::ger(a.rowCount(), a.colCount(), alpha, x.data(), y.data(), a.data(), a.rowStride(), a.colStride());
+}
+
+void task::trsv(blas2::Triangle triangle, blas2::Diagonal diagonal, const ConstMatrixView &a,
+                std::vector<double> &x) {
+  size_t n = a.rowCount();
+  if (a.colCount() != n || x.size() != n) {
+    throw SizeMismatchException();
+  }
+  if (diagonal == blas2::Diagonal::kNonUnit) {
+    for (size_t i = 0; i < n; ++i) {
+      if (a(i, i) == 0.) {
+        throw SingularMatrixException();
+      }
+    }
+  }
+  blas2::trsv(triangle, diagonal, n, a.data(), a.rowStride(), a.colStride(), x.data());
+}
+
+std::vector<double> task::operator*(const ConstMatrixView &a, const std::vector<double> &x) {
+  std::vector<double> y(a.rowCount());
+  gemv(1., a, x, 0., y);
+  return y;
+}
+
+std::vector<double> task::operator*(const std::vector<double> &x, const ConstMatrixView &a) {
+  return a.transposed() * x;
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include "matrix.h"
+
+namespace task {
+namespace blas2 {
+
+enum class Triangle { kLower, kUpper };
+enum class Diagonal { kNonUnit, kUnit };
+
+// Matrix-vector kernels. Element (i, j) of A is
+// a[i * a_row_stride + j * a_col_stride], as in gemm::multiply, so
+// transposed operands need no copy. Vectors are contiguous. Rows (for
+// row-major A) or blocks of rows (for column-major A) are split between
+// threads once A reaches parallel::threshold() elements.
+
+// y = alpha * A * x + beta * y for A (m x n). When beta == 0, y is not read.
+void gemv(size_t m, size_t n, double alpha,
+          const double *a, size_t a_row_stride, size_t a_col_stride,
+          const double *x, double beta, double *y);
+
+// A += alpha * x * y^T for A (m x n), x of m and y of n elements.
+void ger(size_t m, size_t n, double alpha, const double *x, const double *y,
+         double *a, size_t a_row_stride, size_t a_col_stride);
+
+// Solves T * x = b in place for the triangle of A (n x n) that triangle
+// names; the other one is not read. With Diagonal::kUnit the diagonal is
+// taken to be ones and not read either. Blocks of NB unknowns are solved
+// in turn and eliminated from the rest with gemv.
+void trsv(Triangle triangle, Diagonal diagonal, size_t n,
+          const double *a, size_t a_row_stride, size_t a_col_stride, double *x);
+
+const size_t NB = 128;
+
+} // namespace blas2
+
+// The same for matrices and views, with sizes checked: these throw
+// SizeMismatchException if the operands do not fit together, and trsv
+// throws SingularMatrixException for a zero on a diagonal it reads.
+// y and x must be different vectors.
+void gemv(double alpha, const ConstMatrixView &a, const std::vector<double> &x,
+          double beta, std::vector<double> &y);
+void ger(double alpha, const std::vector<double> &x, const std::vector<double> &y, const MatrixView &a);
+void trsv(blas2::Triangle triangle, blas2::Diagonal diagonal, const ConstMatrixView &a, std::vector<double> &x);
+
+inline void ger(double alpha, const std::vector<double> &x, const std::vector<double> &y, Matrix &a) {
+  ger(alpha, x, y, a.view());
+}
+
+// A * x; x^T * A as A^T * x.
+std::vector<double> operator*(const ConstMatrixView &a, const std::vector<double> &x);
+std::vector<double> operator*(const std::vector<double> &x, const ConstMatrixView &a);
+
+// Matrices, mutable views and expressions, the latter evaluated first.
+template<class E>
+void gemv(double alpha, const MatrixExpr<E> &a, const std::vector<double> &x,
+          double beta, std::vector<double> &y) {
+  gemv(alpha, materialize(a.self()).view(), x, beta, y);
+}
+template<class E>
+void trsv(blas2::Triangle triangle, blas2::Diagonal diagonal, const MatrixExpr<E> &a, std::vector<double> &x) {
+  trsv(triangle, diagonal, materialize(a.self()).view(), x);
+}
+template<class E>
+std::vector<double> operator*(const MatrixExpr<E> &a, const std::vector<double> &x) {
+  return materialize(a.self()).view() * x;
+}
+template<class E>
+std::vector<double> operator*(const std::vector<double> &x, const MatrixExpr<E> &a) {
+  return x * materialize(a.self()).view();
+}
+
+} // namespace task
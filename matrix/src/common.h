@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+
+// Whether element accessors (get, set and operator[] of the matrix
+// classes) check their indices. On unless NDEBUG is defined, so debug
+// builds and the tests throw OutOfBoundsException while release builds
+// trust the caller; -DTASK_BOUNDS_CHECK=0 or 1 overrides either way. The
+// accessors are inline, so every translation unit must see the same value.
+// Checks made once per call, such as the ones in getRow() or block(), are
+// kept regardless.
+#ifndef TASK_BOUNDS_CHECK
+#ifdef NDEBUG
+#define TASK_BOUNDS_CHECK 0
+#else
+#define TASK_BOUNDS_CHECK 1
+#endif
+#endif
+
+namespace task {
+
+constexpr double EPS = 1e-6;
+
+// Most elements a matrix can have, so that its size in bytes fits size_t.
+constexpr size_t MAX_ELEMENTS = SIZE_MAX / sizeof(double);
+
+// Whether rows x cols stays within MAX_ELEMENTS; readers check sizes they
+// are given with it before allocating.
+constexpr bool fitsElements(size_t rows, size_t cols) {
+  return cols == 0 || rows <= MAX_ELEMENTS / cols;
+}
+
+class OutOfBoundsException : public std::exception {};
+class SizeMismatchException : public std::exception {};
+class SingularMatrixException : public std::exception {};
+class FormatException : public std::exception {};
+class OverflowException : public std::exception {};
+
+// Index checking policies, picked at compile time by the accessors.
+namespace bounds {
+
+struct Checked {
+  static constexpr void check(size_t index, size_t size) {
+    if (index >= size) {
+      throw OutOfBoundsException();
+    }
+  }
+};
+
+struct Unchecked {
+  static constexpr void check(size_t, size_t) {}
+};
+
+#if TASK_BOUNDS_CHECK
+using Default = Checked;
+#else
+using Default = Unchecked;
+#endif
+
+} // namespace bounds
+
+} // namespace task
@@ -0,0 +1,358 @@
+#pragma once
+
+#include <cstddef>
+#include <initializer_list>
+#include <iostream>
+#include "common.h"
+#include "matrix.h"
+
+namespace task {
+
+// Matrix with extents fixed at compile time, stored inline without a heap
+// allocation. Meant for small transforms (3x3, 4x4) in hot loops: every
+// operation is constexpr, the loops have constant trip counts the compiler
+// unrolls, and det() of up to 4x4 uses closed forms.
+//
+// Like Matrix, the default constructor makes an identity-like matrix and
+// get/set and the row of operator[] are bounds checked. A FixedMatrix is an
+// expression operand, so it mixes with Matrix and views in arithmetic and
+// converts to a Matrix implicitly; the opposite conversion is explicit and
+// checks the shape.
+template<size_t R, size_t C>
+class FixedMatrix : public MatrixExpr<FixedMatrix<R, C>> {
+  static_assert(R > 0 && C > 0, "FixedMatrix extents must be positive");
+
+public:
+  static constexpr bool held_by_reference = true;
+
+  constexpr FixedMatrix() {
+    for (size_t i = 0; i < R && i < C; ++i) {
+      vals[i * C + i] = 1;
+    }
+  }
+
+  // Row-major values; throws SizeMismatchException unless exactly R * C
+  // are given.
+  constexpr FixedMatrix(std::initializer_list<double> values) {
+    if (values.size() != R * C) {
+      throw SizeMismatchException();
+    }
+    size_t index = 0;
+    for (double value : values) {
+      vals[index++] = value;
+    }
+  }
+
+  // Throws SizeMismatchException if expr is not R x C.
+  template<class E>
+  explicit FixedMatrix(const MatrixExpr<E> &expr) {
+    assign(expr.self());
+  }
+
+  template<class E>
+  FixedMatrix &operator=(const MatrixExpr<E> &expr) {
+    return assign(expr.self());
+  }
+
+  static constexpr FixedMatrix zero() {
+    FixedMatrix result;
+    for (size_t i = 0; i < R && i < C; ++i) {
+      result.vals[i * C + i] = 0;
+    }
+    return result;
+  }
+
+  // Checked as bounds::Default says, like Matrix::get.
+  constexpr double &get(size_t row, size_t col) {
+    bounds::Default::check(row, R);
+    bounds::Default::check(col, C);
+    return vals[row * C + col];
+  }
+  constexpr const double &get(size_t row, size_t col) const {
+    bounds::Default::check(row, R);
+    bounds::Default::check(col, C);
+    return vals[row * C + col];
+  }
+  constexpr void set(size_t row, size_t col, const double &value) {
+    get(row, col) = value;
+  }
+
+  constexpr double *operator[](size_t row) {
+    bounds::Default::check(row, R);
+    return vals + row * C;
+  }
+  constexpr const double *operator[](size_t row) const {
+    bounds::Default::check(row, R);
+    return vals + row * C;
+  }
+
+  // Unchecked element access.
+  constexpr double &operator()(size_t row, size_t col) {
+    return vals[row * C + col];
+  }
+  constexpr const double &operator()(size_t row, size_t col) const {
+    return vals[row * C + col];
+  }
+
+  constexpr FixedMatrix &operator+=(const FixedMatrix &a) {
+    for (size_t i = 0; i < R * C; ++i) {
+      vals[i] += a.vals[i];
+    }
+    return *this;
+  }
+
+  constexpr FixedMatrix &operator-=(const FixedMatrix &a) {
+    for (size_t i = 0; i < R * C; ++i) {
+      vals[i] -= a.vals[i];
+    }
+    return *this;
+  }
+
+  constexpr FixedMatrix &operator*=(const FixedMatrix<C, C> &a);
+
+  constexpr FixedMatrix &operator*=(const double &number) {
+    for (size_t i = 0; i < R * C; ++i) {
+      vals[i] *= number;
+    }
+    return *this;
+  }
+
+  constexpr double det() const;
+
+  constexpr void transpose() {
+    static_assert(R == C, "Only a square FixedMatrix can be transposed in place");
+    for (size_t i = 0; i < R; ++i) {
+      for (size_t j = i + 1; j < C; ++j) {
+        double tmp = vals[i * C + j];
+        vals[i * C + j] = vals[j * C + i];
+        vals[j * C + i] = tmp;
+      }
+    }
+  }
+
+  constexpr FixedMatrix<C, R> transposed() const {
+    FixedMatrix<C, R> result;
+    for (size_t i = 0; i < R; ++i) {
+      for (size_t j = 0; j < C; ++j) {
+        result(j, i) = vals[i * C + j];
+      }
+    }
+    return result;
+  }
+
+  constexpr double trace() const {
+    static_assert(R == C, "trace of a non-square FixedMatrix");
+    double sum = 0;
+    for (size_t i = 0; i < R; ++i) {
+      sum += vals[i * C + i];
+    }
+    return sum;
+  }
+
+  MatrixView view() {
+    return MatrixView(vals, R, C, C);
+  }
+  ConstMatrixView view() const {
+    return ConstMatrixView(vals, R, C, C);
+  }
+
+  // Expression interface; at() is not bounds checked.
+  static constexpr size_t rowCount() {
+    return R;
+  }
+  static constexpr size_t colCount() {
+    return C;
+  }
+  constexpr double at(size_t row, size_t col) const {
+    return vals[row * C + col];
+  }
+  constexpr double *data() {
+    return vals;
+  }
+  constexpr const double *data() const {
+    return vals;
+  }
+  static constexpr size_t rowStride() {
+    return C;
+  }
+  static constexpr size_t colStride() {
+    return 1;
+  }
+
+private:
+  template<class E>
+  FixedMatrix &assign(const E &expr) {
+    if (expr.rowCount() != R || expr.colCount() != C) {
+      throw SizeMismatchException();
+    }
+    // Read everything first, expr may refer to *this.
+    double result[R * C] = {};
+    for (size_t i = 0; i < R; ++i) {
+      for (size_t j = 0; j < C; ++j) {
+        result[i * C + j] = expr.at(i, j);
+      }
+    }
+    for (size_t i = 0; i < R * C; ++i) {
+      vals[i] = result[i];
+    }
+    return *this;
+  }
+
+  double vals[R * C] = {};
+};
+
+template<size_t R, size_t C>
+constexpr FixedMatrix<R, C> operator+(const FixedMatrix<R, C> &a, const FixedMatrix<R, C> &b) {
+  FixedMatrix<R, C> result = a;
+  result += b;
+  return result;
+}
+
+template<size_t R, size_t C>
+constexpr FixedMatrix<R, C> operator-(const FixedMatrix<R, C> &a, const FixedMatrix<R, C> &b) {
+  FixedMatrix<R, C> result = a;
+  result -= b;
+  return result;
+}
+
+template<size_t R, size_t C>
+constexpr FixedMatrix<R, C> operator*(const FixedMatrix<R, C> &a, const double &number) {
+  FixedMatrix<R, C> result = a;
+  result *= number;
+  return result;
+}
+
+template<size_t R, size_t C>
+constexpr FixedMatrix<R, C> operator*(const double &number, const FixedMatrix<R, C> &a) {
+  return a * number;
+}
+
+template<size_t R, size_t K, size_t C>
+constexpr FixedMatrix<R, C> operator*(const FixedMatrix<R, K> &a, const FixedMatrix<K, C> &b) {
+  FixedMatrix<R, C> result = FixedMatrix<R, C>::zero();
+  for (size_t i = 0; i < R; ++i) {
+    for (size_t k = 0; k < K; ++k) {
+      double a_ik = a(i, k);
+      for (size_t j = 0; j < C; ++j) {
+        result(i, j) += a_ik * b(k, j);
+      }
+    }
+  }
+  return result;
+}
+
+template<size_t R, size_t C>
+constexpr FixedMatrix<R, C> &FixedMatrix<R, C>::operator*=(const FixedMatrix<C, C> &a) {
+  *this = *this * a;
+  return *this;
+}
+
+template<size_t R, size_t C>
+constexpr FixedMatrix<R, C> operator-(const FixedMatrix<R, C> &a) {
+  return a * -1.;
+}
+
+template<size_t R, size_t C>
+constexpr FixedMatrix<R, C> operator+(const FixedMatrix<R, C> &a) {
+  return a;
+}
+
+template<size_t R, size_t C>
+constexpr bool operator==(const FixedMatrix<R, C> &a, const FixedMatrix<R, C> &b) {
+  for (size_t i = 0; i < R; ++i) {
+    for (size_t j = 0; j < C; ++j) {
+      double diff = a(i, j) - b(i, j);
+      if (diff > EPS || diff < -EPS) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+template<size_t R, size_t C>
+constexpr bool operator!=(const FixedMatrix<R, C> &a, const FixedMatrix<R, C> &b) {
+  return !(a == b);
+}
+
+template<size_t R, size_t C>
+constexpr double FixedMatrix<R, C>::det() const {
+  static_assert(R == C, "det of a non-square FixedMatrix");
+  const FixedMatrix &a = *this;
+  if constexpr (R == 1) {
+    return a(0, 0);
+  } else if constexpr (R == 2) {
+    return a(0, 0) * a(1, 1) - a(0, 1) * a(1, 0);
+  } else if constexpr (R == 3) {
+    return a(0, 0) * (a(1, 1) * a(2, 2) - a(1, 2) * a(2, 1))
+         - a(0, 1) * (a(1, 0) * a(2, 2) - a(1, 2) * a(2, 0))
+         + a(0, 2) * (a(1, 0) * a(2, 1) - a(1, 1) * a(2, 0));
+  } else if constexpr (R == 4) {
+    // Laplace expansion along the first two rows.
+    double s0 = a(0, 0) * a(1, 1) - a(1, 0) * a(0, 1);
+    double s1 = a(0, 0) * a(1, 2) - a(1, 0) * a(0, 2);
+    double s2 = a(0, 0) * a(1, 3) - a(1, 0) * a(0, 3);
+    double s3 = a(0, 1) * a(1, 2) - a(1, 1) * a(0, 2);
+    double s4 = a(0, 1) * a(1, 3) - a(1, 1) * a(0, 3);
+    double s5 = a(0, 2) * a(1, 3) - a(1, 2) * a(0, 3);
+    double c0 = a(2, 0) * a(3, 1) - a(3, 0) * a(2, 1);
+    double c1 = a(2, 0) * a(3, 2) - a(3, 0) * a(2, 2);
+    double c2 = a(2, 0) * a(3, 3) - a(3, 0) * a(2, 3);
+    double c3 = a(2, 1) * a(3, 2) - a(3, 1) * a(2, 2);
+    double c4 = a(2, 1) * a(3, 3) - a(3, 1) * a(2, 3);
+    double c5 = a(2, 2) * a(3, 3) - a(3, 2) * a(2, 3);
+    return s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0;
+  } else {
+    // Gaussian elimination with partial pivoting on a copy.
+    FixedMatrix lu = a;
+    double result = 1;
+    for (size_t k = 0; k < R; ++k) {
+      size_t pivot = k;
+      for (size_t i = k + 1; i < R; ++i) {
+        double candidate = lu(i, k) < 0 ? -lu(i, k) : lu(i, k);
+        double best = lu(pivot, k) < 0 ? -lu(pivot, k) : lu(pivot, k);
+        if (candidate > best) {
+          pivot = i;
+        }
+      }
+      if (lu(pivot, k) == 0) {
+        return 0;
+      }
+      if (pivot != k) {
+        for (size_t j = 0; j < C; ++j) {
+          double tmp = lu(k, j);
+          lu(k, j) = lu(pivot, j);
+          lu(pivot, j) = tmp;
+        }
+        result = -result;
+      }
+      result *= lu(k, k);
+      for (size_t i = k + 1; i < R; ++i) {
+        double factor = lu(i, k) / lu(k, k);
+        for (size_t j = k + 1; j < C; ++j) {
+          lu(i, j) -= factor * lu(k, j);
+        }
+      }
+    }
+    return result;
+  }
+}
+
+// Products with a Matrix or a view multiply the inline storage in place.
+template<size_t R, size_t C>
+ConstMatrixView materialize(const FixedMatrix<R, C> &a) {
+  return a.view();
+}
+
+template<size_t R, size_t C>
+std::ostream &operator<<(std::ostream &output, const FixedMatrix<R, C> &matrix) {
+  for (size_t i = 0; i < R; ++i) {
+    for (size_t j = 0; j < C; ++j) {
+      output << matrix(i, j) << " ";
+    }
+    output << std::endl;
+  }
+  return output;
+}
+
+} // namespace task
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <cstdint>
+#include <iostream>
+#include <limits>
+#include <type_traits>
+
+namespace task {
+
+// Signed fixed-point number with FRAC_BITS fractional bits stored in Rep,
+// e.g. FixedPoint<16> is Q15.16 in an int32_t: range about +-32768 in
+// steps of 2^-16. Products and quotients go through a type twice as wide
+// and round to nearest; overflow wraps like the integer it is stored in.
+template<int FRAC_BITS, class Rep = int32_t>
+class FixedPoint {
+  static_assert(std::is_integral<Rep>::value && std::is_signed<Rep>::value,
+                "FixedPoint needs a signed integer representation");
+  static_assert(FRAC_BITS > 0 && FRAC_BITS < std::numeric_limits<Rep>::digits,
+                "FixedPoint needs at least one fractional and one integer bit");
+
+  using Wide = typename std::conditional<sizeof(Rep) <= 4, int64_t, __int128>::type;
+  // Sums and negation go through the unsigned type, where overflow wraps
+  // instead of being undefined.
+  using Bits = typename std::make_unsigned<Rep>::type;
+
+public:
+  static constexpr Rep ONE = Rep(1) << FRAC_BITS;
+
+  constexpr FixedPoint() : raw_value(0) {}
+  // Rounds to the nearest step.
+  constexpr FixedPoint(double value)
+      : raw_value(static_cast<Rep>(value * ONE + (value < 0 ? -0.5 : 0.5))) {}
+
+  static constexpr FixedPoint fromRaw(Rep raw) {
+    FixedPoint result;
+    result.raw_value = raw;
+    return result;
+  }
+  constexpr Rep raw() const {
+    return raw_value;
+  }
+  explicit constexpr operator double() const {
+    return static_cast<double>(raw_value) / ONE;
+  }
+
+  constexpr FixedPoint &operator+=(FixedPoint a) {
+    raw_value = static_cast<Rep>(static_cast<Bits>(raw_value) + static_cast<Bits>(a.raw_value));
+    return *this;
+  }
+  constexpr FixedPoint &operator-=(FixedPoint a) {
+    raw_value = static_cast<Rep>(static_cast<Bits>(raw_value) - static_cast<Bits>(a.raw_value));
+    return *this;
+  }
+  constexpr FixedPoint &operator*=(FixedPoint a) {
+    Wide product = static_cast<Wide>(raw_value) * a.raw_value;
+    raw_value = static_cast<Rep>((product + (Wide(1) << (FRAC_BITS - 1))) >> FRAC_BITS);
+    return *this;
+  }
+  constexpr FixedPoint &operator/=(FixedPoint a) {
+    Wide dividend = static_cast<Wide>(raw_value) * ONE;
+    Wide divisor = a.raw_value;
+    Wide half = (divisor < 0 ? -divisor : divisor) / 2;
+    dividend += (dividend < 0) == (a.raw_value < 0) ? half : -half;
+    raw_value = static_cast<Rep>(dividend / a.raw_value);
+    return *this;
+  }
+  constexpr FixedPoint operator-() const {
+    return fromRaw(static_cast<Rep>(Bits(0) - static_cast<Bits>(raw_value)));
+  }
+
+  friend constexpr FixedPoint operator+(FixedPoint a, FixedPoint b) {
+    return a += b;
+  }
+  friend constexpr FixedPoint operator-(FixedPoint a, FixedPoint b) {
+    return a -= b;
+  }
+  friend constexpr FixedPoint operator*(FixedPoint a, FixedPoint b) {
+    return a *= b;
+  }
+  friend constexpr FixedPoint operator/(FixedPoint a, FixedPoint b) {
+    return a /= b;
+  }
+  friend constexpr bool operator==(FixedPoint a, FixedPoint b) {
+    return a.raw_value == b.raw_value;
+  }
+  friend constexpr bool operator!=(FixedPoint a, FixedPoint b) {
+    return a.raw_value != b.raw_value;
+  }
+  friend constexpr bool operator<(FixedPoint a, FixedPoint b) {
+    return a.raw_value < b.raw_value;
+  }
+  friend constexpr bool operator>(FixedPoint a, FixedPoint b) {
+    return a.raw_value > b.raw_value;
+  }
+  friend constexpr bool operator<=(FixedPoint a, FixedPoint b) {
+    return a.raw_value <= b.raw_value;
+  }
+  friend constexpr bool operator>=(FixedPoint a, FixedPoint b) {
+    return a.raw_value >= b.raw_value;
+  }
+
+  // Text goes through double, so it reads and writes like plain numbers.
+  friend std::ostream &operator<<(std::ostream &output, FixedPoint a) {
+    return output << static_cast<double>(a);
+  }
+  friend std::istream &operator>>(std::istream &input, FixedPoint &a) {
+    double value;
+    if (input >> value) {
+      a = FixedPoint(value);
+    }
+    return input;
+  }
+
+private:
+  Rep raw_value;
+};
+
+} // namespace task
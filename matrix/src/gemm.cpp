@@ -0,0 +1,267 @@
+#include "gemm.h"
+#include "simd.h"
+#include "thread_pool.h"
+#include <algorithm>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define TASK_GEMM_X86
+#include <immintrin.h>
+#endif
+
+using namespace task;
+
+namespace {
+
+// Products with fewer multiply-adds than this skip packing entirely.
+const size_t SMALL_PRODUCT = 32 * 32 * 32;
+
+// Scratch memory for packed panels, kept between calls.
+class PackBuffer {
+public:
+  ~PackBuffer() {
+    delete[] data;
+  }
+
+  double *reserve(size_t size) {
+    if (size > capacity) {
+      delete[] data;
+      data = new double[size];
+      capacity = size;
+    }
+    return data;
+  }
+
+private:
+  double *data = nullptr;
+  size_t capacity = 0;
+};
+
+void scale(size_t m, size_t n, double beta, double *c, size_t ldc) {
+  for (size_t i = 0; i < m; ++i) {
+    for (size_t j = 0; j < n; ++j) {
+      c[i * ldc + j] = beta == 0. ? 0. : beta * c[i * ldc + j];
+    }
+  }
+}
+
+// i-k-j loop for products too small to amortize packing.
+void multiplySmall(size_t m, size_t n, size_t k, double alpha,
+                   const double *a, size_t rsa, size_t csa,
+                   const double *b, size_t rsb, size_t csb,
+                   double beta, double *c, size_t ldc) {
+  scale(m, n, beta, c, ldc);
+  for (size_t i = 0; i < m; ++i) {
+    double *c_row = c + i * ldc;
+    for (size_t p = 0; p < k; ++p) {
+      double tmp = alpha * a[i * rsa + p * csa];
+      const double *b_row = b + p * rsb;
+      for (size_t j = 0; j < n; ++j) {
+        c_row[j] += tmp * b_row[j * csb];
+      }
+    }
+  }
+}
+
+// Copies an mc x kc block of A into MR-row slivers, each stored column by
+// column, padding the last sliver with zeros.
+void packA(size_t mc, size_t kc, const double *a, size_t rsa, size_t csa, double *packed) {
+  for (size_t ir = 0; ir < mc; ir += gemm::MR) {
+    size_t mr = std::min(gemm::MR, mc - ir);
+    for (size_t p = 0; p < kc; ++p) {
+      for (size_t i = 0; i < gemm::MR; ++i) {
+        *packed++ = i < mr ? a[(ir + i) * rsa + p * csa] : 0.;
+      }
+    }
+  }
+}
+
+// Copies a kc x nc block of B into NR-column slivers, each stored row by
+// row, padding the last sliver with zeros.
+void packB(size_t kc, size_t nc, const double *b, size_t rsb, size_t csb, double *packed) {
+  for (size_t jr = 0; jr < nc; jr += gemm::NR) {
+    size_t nr = std::min(gemm::NR, nc - jr);
+    for (size_t p = 0; p < kc; ++p) {
+      const double *b_row = b + p * rsb + jr * csb;
+      for (size_t j = 0; j < gemm::NR; ++j) {
+        *packed++ = j < nr ? b_row[j * csb] : 0.;
+      }
+    }
+  }
+}
+
+// Writes the top-left mr x nr corner of an MR x NR accumulator block.
+void writeBack(const double (&acc)[gemm::MR][gemm::NR], double alpha, double beta,
+               double *c, size_t ldc, size_t mr, size_t nr) {
+  for (size_t i = 0; i < mr; ++i) {
+    for (size_t j = 0; j < nr; ++j) {
+      if (beta == 0.) {
+        c[i * ldc + j] = alpha * acc[i][j];
+      } else {
+        c[i * ldc + j] = beta * c[i * ldc + j] + alpha * acc[i][j];
+      }
+    }
+  }
+}
+
+using MicroKernel = void (*)(size_t kc, double alpha, const double *a, const double *b,
+                             double beta, double *c, size_t ldc, size_t mr, size_t nr);
+
+// Computes an MR x NR block of C from packed slivers; only the top-left
+// mr x nr corner is written back.
+void microKernel(size_t kc, double alpha, const double *a, const double *b,
+                 double beta, double *c, size_t ldc, size_t mr, size_t nr) {
+  double acc[gemm::MR][gemm::NR] = {};
+  for (size_t p = 0; p < kc; ++p) {
+    for (size_t i = 0; i < gemm::MR; ++i) {
+      double a_ip = a[p * gemm::MR + i];
+      for (size_t j = 0; j < gemm::NR; ++j) {
+        acc[i][j] += a_ip * b[p * gemm::NR + j];
+      }
+    }
+  }
+  writeBack(acc, alpha, beta, c, ldc, mr, nr);
+}
+
+#ifdef TASK_GEMM_X86
+
+// The same with the MR x NR block held in vector registers: each step
+// broadcasts one element of the A sliver against a row of the B sliver.
+// Both need NR to be a whole number of vectors.
+
+__attribute__((target("avx2,fma"))) void microKernelAvx2(size_t kc, double alpha, const double *a,
+                                                         const double *b, double beta, double *c,
+                                                         size_t ldc, size_t mr, size_t nr) {
+  const size_t vectors = gemm::NR / 4;
+  __m256d acc[gemm::MR][vectors];
+#pragma GCC unroll 16
+  for (size_t i = 0; i < gemm::MR; ++i) {
+#pragma GCC unroll 4
+    for (size_t v = 0; v < vectors; ++v) {
+      acc[i][v] = _mm256_setzero_pd();
+    }
+  }
+  for (size_t p = 0; p < kc; ++p) {
+    __m256d b_row[vectors];
+#pragma GCC unroll 4
+    for (size_t v = 0; v < vectors; ++v) {
+      b_row[v] = _mm256_loadu_pd(b + p * gemm::NR + v * 4);
+    }
+#pragma GCC unroll 16
+    for (size_t i = 0; i < gemm::MR; ++i) {
+      __m256d a_ip = _mm256_broadcast_sd(a + p * gemm::MR + i);
+#pragma GCC unroll 4
+      for (size_t v = 0; v < vectors; ++v) {
+        acc[i][v] = _mm256_fmadd_pd(a_ip, b_row[v], acc[i][v]);
+      }
+    }
+  }
+  double out[gemm::MR][gemm::NR];
+  for (size_t i = 0; i < gemm::MR; ++i) {
+    for (size_t v = 0; v < vectors; ++v) {
+      _mm256_storeu_pd(out[i] + v * 4, acc[i][v]);
+    }
+  }
+  writeBack(out, alpha, beta, c, ldc, mr, nr);
+}
+
+__attribute__((target("avx512f"))) void microKernelAvx512(size_t kc, double alpha, const double *a,
+                                                          const double *b, double beta, double *c,
+                                                          size_t ldc, size_t mr, size_t nr) {
+  const size_t vectors = gemm::NR / 8;
+  __m512d acc[gemm::MR][vectors];
+#pragma GCC unroll 16
+  for (size_t i = 0; i < gemm::MR; ++i) {
+#pragma GCC unroll 4
+    for (size_t v = 0; v < vectors; ++v) {
+      acc[i][v] = _mm512_setzero_pd();
+    }
+  }
+  for (size_t p = 0; p < kc; ++p) {
+    __m512d b_row[vectors];
+#pragma GCC unroll 4
+    for (size_t v = 0; v < vectors; ++v) {
+      b_row[v] = _mm512_loadu_pd(b + p * gemm::NR + v * 8);
+    }
+#pragma GCC unroll 16
+    for (size_t i = 0; i < gemm::MR; ++i) {
+      __m512d a_ip = _mm512_set1_pd(a[p * gemm::MR + i]);
+#pragma GCC unroll 4
+      for (size_t v = 0; v < vectors; ++v) {
+        acc[i][v] = _mm512_fmadd_pd(a_ip, b_row[v], acc[i][v]);
+      }
+    }
+  }
+  double out[gemm::MR][gemm::NR];
+  for (size_t i = 0; i < gemm::MR; ++i) {
+    for (size_t v = 0; v < vectors; ++v) {
+      _mm512_storeu_pd(out[i] + v * 8, acc[i][v]);
+    }
+  }
+  writeBack(out, alpha, beta, c, ldc, mr, nr);
+}
+
+#endif // TASK_GEMM_X86
+
+// Follows the instruction set picked for the element-wise kernels; tile
+// shapes the vector kernels cannot cover get the portable one.
+MicroKernel microKernelFor(simd::Isa isa) {
+#ifdef TASK_GEMM_X86
+  if (isa == simd::Isa::kAvx512 && gemm::NR % 8 == 0) {
+    return microKernelAvx512;
+  }
+  if ((isa == simd::Isa::kAvx512 || isa == simd::Isa::kAvx2) && gemm::NR % 4 == 0 &&
+      __builtin_cpu_supports("fma")) {
+    return microKernelAvx2;
+  }
+#endif
+  return microKernel;
+}
+
+} // namespace
+
+void gemm::multiply(size_t m, size_t n, size_t k, double alpha,
+                    const double *a, size_t rsa, size_t csa,
+                    const double *b, size_t rsb, size_t csb,
+                    double beta, double *c, size_t ldc) {
+  if (m == 0 || n == 0) {
+    return;
+  }
+  if (k == 0 || alpha == 0.) {
+    scale(m, n, beta, c, ldc);
+    return;
+  }
+  if (m * n * k <= SMALL_PRODUCT) {
+    multiplySmall(m, n, k, alpha, a, rsa, csa, b, rsb, csb, beta, c, ldc);
+    return;
+  }
+
+  static thread_local PackBuffer a_buffer, b_buffer;
+  MicroKernel kernel = microKernelFor(simd::activeIsa());
+  double *packed_b = b_buffer.reserve(KC * NC);
+  size_t row_blocks = (m + MC - 1) / MC;
+
+  for (size_t jc = 0; jc < n; jc += NC) {
+    size_t nc = std::min(NC, n - jc);
+    for (size_t pc = 0; pc < k; pc += KC) {
+      size_t kc = std::min(KC, k - pc);
+      packB(kc, nc, b + pc * rsb + jc * csb, rsb, csb, packed_b);
+      double beta_block = pc == 0 ? beta : 1.;
+      // Row blocks of C are independent; each thread packs its own A panel.
+      parallel::forRange(0, row_blocks, m * n, [&](size_t from, size_t to) {
+        double *packed_a = a_buffer.reserve(MC * KC);
+        for (size_t ic = from * MC; ic < std::min(m, to * MC); ic += MC) {
+          size_t mc = std::min(MC, m - ic);
+          packA(mc, kc, a + ic * rsa + pc * csa, rsa, csa, packed_a);
+          for (size_t jr = 0; jr < nc; jr += NR) {
+            size_t nr = std::min(NR, nc - jr);
+            for (size_t ir = 0; ir < mc; ir += MR) {
+              size_t mr = std::min(MR, mc - ir);
+              kernel(kc, alpha, packed_a + ir * kc, packed_b + jr * kc,
+                     beta_block, c + (ic + ir) * ldc + jc + jr, ldc, mr, nr);
+            }
+          }
+        }
+      });
+    }
+  }
+}
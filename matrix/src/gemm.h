@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstddef>
+
+// Tile sizes of the blocked multiplication. They can be overridden at build
+// time, e.g. `-DTASK_GEMM_KC=384`, to match the caches of the target machine.
+// MC x KC panel of A is sized for L2, KC x NC panel of B for L3,
+// MR x NR block of C is kept in registers by the micro-kernel: 6 x 8 is
+// 6 zmm or 12 ymm accumulators, enough to keep the FMA units busy.
+#ifndef TASK_GEMM_MR
+#define TASK_GEMM_MR 6
+#endif
+#ifndef TASK_GEMM_NR
+#define TASK_GEMM_NR 8
+#endif
+#ifndef TASK_GEMM_MC
+#define TASK_GEMM_MC 96
+#endif
+#ifndef TASK_GEMM_KC
+#define TASK_GEMM_KC 256
+#endif
+#ifndef TASK_GEMM_NC
+#define TASK_GEMM_NC 2048
+#endif
+
+namespace task {
+namespace gemm {
+
+const size_t MR = TASK_GEMM_MR;
+const size_t NR = TASK_GEMM_NR;
+const size_t MC = TASK_GEMM_MC;
+const size_t KC = TASK_GEMM_KC;
+const size_t NC = TASK_GEMM_NC;
+
+static_assert(MC % MR == 0, "TASK_GEMM_MC must be a multiple of TASK_GEMM_MR");
+static_assert(NC % NR == 0, "TASK_GEMM_NC must be a multiple of TASK_GEMM_NR");
+
+// C = alpha * A * B + beta * C for A (m x k), B (k x n) and row-major
+// C (m x n) with leading dimension ldc. Element (i, j) of A is
+// a[i * a_row_stride + j * a_col_stride], and likewise for B, so
+// transposed operands need no copy. When beta == 0, C is not read.
+void multiply(size_t m, size_t n, size_t k, double alpha,
+              const double *a, size_t a_row_stride, size_t a_col_stride,
+              const double *b, size_t b_row_stride, size_t b_col_stride,
+              double beta, double *c, size_t ldc);
+
+// The same for row-major A and B with leading dimensions lda and ldb.
+inline void multiply(size_t m, size_t n, size_t k,
+                     double alpha, const double *a, size_t lda,
+                     const double *b, size_t ldb,
+                     double beta, double *c, size_t ldc) {
+  multiply(m, n, k, alpha, a, lda, 1, b, ldb, 1, beta, c, ldc);
+}
+
+} // namespace gemm
+} // namespace task
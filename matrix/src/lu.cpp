@@ -0,0 +1,212 @@
+#include "matrix.h"
+#include "blas2.h"
+#include "gemm.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+using namespace task;
+
+namespace {
+
+// Number of columns factorized at a time before the trailing update.
+const size_t PANEL = 64;
+
+} // namespace
+
+LUDecomposition::LUDecomposition(const Matrix &a) : factors(a), perm(a.n_rows), parity(1) {
+  if (a.n_rows != a.n_cols) {
+    throw SizeMismatchException();
+  }
+  size_t n = a.n_rows;
+  double *m = factors.vals;
+  std::iota(perm.begin(), perm.end(), 0);
+
+  for (size_t k0 = 0; k0 < n; k0 += PANEL) {
+    size_t k1 = std::min(n, k0 + PANEL);
+
+    // Unblocked elimination restricted to the panel columns [k0, k1).
+    for (size_t k = k0; k < k1; ++k) {
+      size_t pivot = k;
+      for (size_t i = k + 1; i < n; ++i) {
+        if (std::fabs(m[i * n + k]) > std::fabs(m[pivot * n + k])) {
+          pivot = i;
+        }
+      }
+      if (pivot != k) {
+        std::swap_ranges(m + k * n, m + (k + 1) * n, m + pivot * n);
+        std::swap(perm[k], perm[pivot]);
+        parity = -parity;
+      }
+      double diag = m[k * n + k];
+      if (diag == 0.) {
+        continue;
+      }
+      parallel::forRange(k + 1, n, (n - k) * (k1 - k), [&](size_t from, size_t to) {
+        for (size_t i = from; i < to; ++i) {
+          double l = m[i * n + k] /= diag;
+          for (size_t j = k + 1; j < k1; ++j) {
+            m[i * n + j] -= l * m[k * n + j];
+          }
+        }
+      });
+    }
+    if (k1 == n) {
+      break;
+    }
+
+    // U12 = L11^-1 * A12, independent for every column.
+    parallel::forRange(k1, n, (k1 - k0) * (n - k1), [&](size_t from, size_t to) {
+      for (size_t i = k0 + 1; i < k1; ++i) {
+        for (size_t p = k0; p < i; ++p) {
+          double l = m[i * n + p];
+          for (size_t j = from; j < to; ++j) {
+            m[i * n + j] -= l * m[p * n + j];
+          }
+        }
+      }
+    });
+
+    // A22 -= L21 * U12.
+    gemm::multiply(n - k1, n - k1, k1 - k0, -1., m + k1 * n + k0, n, m + k0 * n + k1, n,
+                   1., m + k1 * n + k1, n);
+  }
+}
+
+Matrix LUDecomposition::lower() const {
+  size_t n = factors.n_rows;
+  Matrix result(n, n);
+  for (size_t i = 0; i < n; ++i) {
+    for (size_t j = 0; j < i; ++j) {
+      result(i, j) = factors(i, j);
+    }
+  }
+  return result;
+}
+
+Matrix LUDecomposition::upper() const {
+  size_t n = factors.n_rows;
+  Matrix result(n, n);
+  for (size_t i = 0; i < n; ++i) {
+    for (size_t j = i; j < n; ++j) {
+      result(i, j) = factors(i, j);
+    }
+  }
+  return result;
+}
+
+Matrix LUDecomposition::permutationMatrix() const {
+  size_t n = factors.n_rows;
+  Matrix result(n, n);
+  for (size_t i = 0; i < n; ++i) {
+    result(i, i) = 0.;
+  }
+  for (size_t i = 0; i < n; ++i) {
+    result(i, perm[i]) = 1.;
+  }
+  return result;
+}
+
+const std::vector<size_t> &LUDecomposition::permutation() const {
+  return perm;
+}
+
+double LUDecomposition::det() const {
+  double res = parity;
+  for (size_t i = 0; i < factors.n_rows; ++i) {
+    res *= factors(i, i);
+  }
+  return res;
+}
+
+bool LUDecomposition::singular() const {
+  for (size_t i = 0; i < factors.n_rows; ++i) {
+    if (factors(i, i) == 0.) {
+      return true;
+    }
+  }
+  return false;
+}
+
+Matrix LUDecomposition::solve(const Matrix &b) const {
+  size_t n = factors.n_rows, m = b.n_cols;
+  if (b.n_rows != n) {
+    throw SizeMismatchException();
+  }
+  if (singular()) {
+    throw SingularMatrixException();
+  }
+  Matrix x(n, m, Matrix::Uninitialized());
+  for (size_t i = 0; i < n; ++i) {
+    std::copy(b[perm[i]], b[perm[i]] + m, x[i]);
+  }
+
+  // Forward substitution with L, then back substitution with U, both
+  // row-oriented and independent for every column of b.
+  parallel::forRange(0, m, n * m, [&](size_t from, size_t to) {
+    for (size_t i = 0; i < n; ++i) {
+      double *x_i = x[i];
+      for (size_t p = 0; p < i; ++p) {
+        double l = factors.at(i, p);
+        const double *x_p = x[p];
+        for (size_t j = from; j < to; ++j) {
+          x_i[j] -= l * x_p[j];
+        }
+      }
+    }
+    for (size_t i = n; i-- > 0;) {
+      double *x_i = x[i];
+      for (size_t p = i + 1; p < n; ++p) {
+        double u = factors.at(i, p);
+        const double *x_p = x[p];
+        for (size_t j = from; j < to; ++j) {
+          x_i[j] -= u * x_p[j];
+        }
+      }
+      double diag = factors.at(i, i);
+      for (size_t j = from; j < to; ++j) {
+        x_i[j] /= diag;
+      }
+    }
+  });
+  return x;
+}
+
+std::vector<double> LUDecomposition::solve(const std::vector<double> &b) const {
+  size_t n = factors.n_rows;
+  if (b.size() != n) {
+    throw SizeMismatchException();
+  }
+  if (singular()) {
+    throw SingularMatrixException();
+  }
+  std::vector<double> x(n);
+  for (size_t i = 0; i < n; ++i) {
+    x[i] = b[perm[i]];
+  }
+  blas2::trsv(blas2::Triangle::kLower, blas2::Diagonal::kUnit, n, factors.vals, n, 1, x.data());
+  blas2::trsv(blas2::Triangle::kUpper, blas2::Diagonal::kNonUnit, n, factors.vals, n, 1, x.data());
+  return x;
+}
+
+Matrix LUDecomposition::inverse() const {
+  size_t n = factors.n_rows;
+  return solve(Matrix(n, n));
+}
+
+LUDecomposition Matrix::lu() const {
+  return factorization();
+}
+
+Matrix Matrix::solve(const Matrix &b) const {
+  return factorization().solve(b);
+}
+
+std::vector<double> Matrix::solve(const std::vector<double> &b) const {
+  return factorization().solve(b);
+}
+
+Matrix Matrix::inverse() const {
+  return factorization().inverse();
+}
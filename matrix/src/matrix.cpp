@@ -1,15 +1,82 @@
 #include "matrix.h"
+#include "gemm.h"
+#include "simd.h"
+#include "storage.h"
+#include "strassen.h"
+#include "thread_pool.h"
+#include "transpose.h"
+#include <algorithm>
+#include <atomic>
 #include <cmath>
+#include <cstdint>
+#include <memory>
+#include <mutex>
 #include <stdexcept>
 
 using namespace task;
 
-Matrix::Matrix() : n_rows(1), n_cols(1), vals(new double[1]) {
+namespace {
+
+std::atomic<size_t> allocations(0);
+std::atomic<size_t> derived_hits(0);
+std::atomic<size_t> derived_computations(0);
+
+// Bits of Matrix::cached.
+const unsigned LU = 1;
+const unsigned DET = 2;
+const unsigned TRACE = 4;
+const unsigned TRANSPOSED = 8;
+// transposed() was called once; the next call keeps its result.
+const unsigned TRANSPOSED_ONCE = 16;
+
+void count(std::atomic<size_t> &counter) {
+  counter.fetch_add(1, std::memory_order_relaxed);
+}
+
+// Matrices are spread over a few locks by address. Results are computed
+// outside the lock and only stored under it.
+std::mutex &derivedLock(const Matrix *matrix) {
+  static std::mutex locks[16];
+  return locks[(reinterpret_cast<uintptr_t>(matrix) >> 5) % 16];
+}
+
+} // namespace
+
+struct Matrix::Derived {
+  std::unique_ptr<LUDecomposition> lu;
+  std::unique_ptr<Matrix> transposed;
+  double det = 0.;
+  double trace = 0.;
+};
+
+size_t task::allocationCount() {
+  return allocations.load(std::memory_order_relaxed);
+}
+
+DerivedStats task::derivedStats() {
+  return {derived_hits.load(), derived_computations.load()};
+}
+
+void task::resetDerivedStats() {
+  derived_hits = 0;
+  derived_computations = 0;
+}
+
+double *Matrix::allocate(size_t size) {
+  allocations.fetch_add(1, std::memory_order_relaxed);
+  return storage::policy().allocate(size);
+}
+
+void Matrix::deallocate(double *data, size_t size) {
+  storage::policy().deallocate(data, size);
+}
+
+Matrix::Matrix() : vals(allocate(1)), n_rows(1), n_cols(1) {
   *vals = 1;
 }
 
 Matrix::Matrix(size_t row, size_t col) : n_rows(row), n_cols(col) {
-  vals = new double[row * col];
+  vals = allocate(row * col);
   for (size_t i = 0; i < row; ++i) {
     for (size_t j = 0; j < col; ++j) {
       if (i == j) {
@@ -21,52 +88,62 @@ Matrix::Matrix(size_t row, size_t col) : n_rows(row), n_cols(col) {
   }
 }
 
+Matrix::Matrix(size_t row, size_t col, Uninitialized) : n_rows(row), n_cols(col) {
+  vals = allocate(row * col);
+}
+
 Matrix::~Matrix() {
-  delete[] vals;
+  deallocate(vals, n_rows * n_cols);
+  delete cache;
 }
 
 Matrix::Matrix(const Matrix &copy) : n_rows(copy.n_rows), n_cols(copy.n_cols) {
-  vals = new double[n_rows * n_cols];
-  for (size_t i = 0; i < n_rows * n_cols; ++i) {
-    vals[i] = copy.vals[i];
-  }
+  vals = allocate(n_rows * n_cols);
+  std::copy(copy.vals, copy.vals + n_rows * n_cols, vals);
+}
+
+Matrix::Matrix(Matrix &&other) noexcept
+    : vals(other.vals), n_rows(other.n_rows), n_cols(other.n_cols), cache(other.cache),
+      cached(other.cached.load(std::memory_order_relaxed)) {
+  other.vals = nullptr;
+  other.n_rows = 0;
+  other.n_cols = 0;
+  other.cache = nullptr;
+  other.cached.store(0, std::memory_order_relaxed);
 }
 
 Matrix &Matrix::operator=(const Matrix &a) {
   if (this != &a) {
-    (*this).resize(a.n_rows,a.n_cols);
-    for (size_t i = 0; i < n_rows * n_cols; ++i) {
-      vals[i] = a.vals[i];
+    invalidate();
+    if (n_rows * n_cols != a.n_rows * a.n_cols) {
+      double *new_vals = allocate(a.n_rows * a.n_cols);
+      deallocate(vals, n_rows * n_cols);
+      vals = new_vals;
     }
+    n_rows = a.n_rows;
+    n_cols = a.n_cols;
+    std::copy(a.vals, a.vals + n_rows * n_cols, vals);
   }
   return *this;
 }
 
-
-double &Matrix::get(size_t row, size_t col) {
-  if (row < 0 || col < 0 || row >= n_rows || col >= n_cols) {
-    throw OutOfBoundsException();
-  }
-  return vals[n_cols * row + col];
-}
-
-const double &Matrix::get(size_t row, size_t col) const {
-  if (row < 0 || col < 0 || row >= n_rows || col >= n_cols) {
-    throw OutOfBoundsException();
-  }
-  return vals[n_cols * row + col];
+Matrix &Matrix::operator=(Matrix &&a) noexcept {
+  std::swap(vals, a.vals);
+  std::swap(n_rows, a.n_rows);
+  std::swap(n_cols, a.n_cols);
+  std::swap(cache, a.cache);
+  unsigned a_cached = a.cached.load(std::memory_order_relaxed);
+  a.cached.store(cached.load(std::memory_order_relaxed), std::memory_order_relaxed);
+  cached.store(a_cached, std::memory_order_relaxed);
+  return *this;
 }
 
-void Matrix::set(size_t row, size_t col, const double &value) {
-  if (row < 0 || col < 0 || row >= n_rows || col >= n_cols) {
-    throw OutOfBoundsException();
+void Matrix::resize(size_t new_rows, size_t new_cols) {
+  if (new_rows == n_rows && new_cols == n_cols) {
+    return;
   }
-  vals[n_cols * row + col] = value;
-}
-
-void Matrix::resize(size_t new_rows, size_t new_cols) {//проверить, работает неправильно
-  double *new_vals;
-  new_vals = new double[new_rows * new_cols];
+  invalidate();
+  double *new_vals = allocate(new_rows * new_cols);
   for (size_t i = 0; i < new_rows; ++i) {
     for (size_t j = 0; j < new_cols; ++j) {
       if (i < n_rows && j < n_cols) {
@@ -76,26 +153,21 @@ void Matrix::resize(size_t new_rows, size_t new_cols) {//проверить, р
       }
     }
   }
-  std::swap(vals, new_vals);
+  deallocate(vals, n_rows * n_cols);
+  vals = new_vals;
   n_rows = new_rows;
   n_cols = new_cols;
-  delete[] new_vals;
-}
-
-double *Matrix::operator[](size_t row) {
-  return &vals[row * n_cols];
-}
-const double *Matrix::operator[](size_t row) const {
-  return &vals[row * n_cols];
 }
 
 Matrix &Matrix::operator+=(const Matrix &a) {
   if (n_rows != a.n_rows || n_cols != a.n_cols) {
     throw SizeMismatchException();
   }
-  for (size_t i = 0; i < n_rows * n_cols; ++i) {
-    vals[i] += a.vals[i];
-  }
+  invalidate();
+  size_t size = n_rows * n_cols;
+  parallel::forRange(0, size, size, [&](size_t from, size_t to) {
+    simd::active().add(vals + from, a.vals + from, to - from);
+  });
   return *this;
 }
 
@@ -103,150 +175,180 @@ Matrix &Matrix::operator-=(const Matrix &a) {
   if (n_rows != a.n_rows || n_cols != a.n_cols) {
     throw SizeMismatchException();
   }
-  for (size_t i = 0; i < n_rows * n_cols; ++i) {
-    vals[i] -= a.vals[i];
-  }
+  invalidate();
+  size_t size = n_rows * n_cols;
+  parallel::forRange(0, size, size, [&](size_t from, size_t to) {
+    simd::active().sub(vals + from, a.vals + from, to - from);
+  });
   return *this;
 }
 
-Matrix Matrix::operator*(const Matrix &a) const {
-  if (n_cols != a.n_rows) {
+Matrix task::product(const ConstMatrixView &a, const ConstMatrixView &b) {
+  if (a.colCount() != b.rowCount()) {
     throw SizeMismatchException();
   }
-  Matrix result(n_rows, a.n_cols);
-  for (size_t i = 0; i < n_rows; ++i) {
-    for (size_t j = 0; j < a.n_cols; ++j) {
-      result.vals[a.n_cols * i + j] = 0.;
-      for (size_t k = 0; k < n_cols; ++k) {
-        result.vals[a.n_cols * i + j] += vals[n_cols * i + k] * a.vals[a.n_cols * k + j];
-      }
-    }
+  Matrix result(a.rowCount(), b.colCount(), Matrix::Uninitialized());
+  if (strassen::crossover() != 0) {
+    strassen::multiply(a.rowCount(), b.colCount(), a.colCount(),
+                       a.data(), a.rowStride(), a.colStride(), b.data(), b.rowStride(), b.colStride(),
+                       result.vals, result.n_cols);
+    return result;
   }
+  gemm::multiply(a.rowCount(), b.colCount(), a.colCount(), 1.,
+                 a.data(), a.rowStride(), a.colStride(), b.data(), b.rowStride(), b.colStride(),
+                 0., result.vals, result.n_cols);
   return result;
 }
+
 Matrix &Matrix::operator*=(const Matrix &a) {
   if (n_cols != a.n_rows) {
     throw SizeMismatchException();
   }
-  *this = *this * a;
+  *this = product(view(), a.view());
   return *this;
 }
 
 Matrix &Matrix::operator*=(const double &number) {
-  for (size_t i = 0; i < n_rows * n_cols; ++i) {
-    vals[i] *= number;
-  }
+  invalidate();
+  size_t size = n_rows * n_cols;
+  parallel::forRange(0, size, size, [&](size_t from, size_t to) {
+    simd::active().scale(vals + from, number, to - from);
+  });
   return *this;
 }
 
-Matrix Matrix::operator+(const Matrix &a) const {
-  Matrix result = Matrix(*this);
-  result += a;
-  return result;
+void Matrix::evaluate(const MatrixNegatedExpr<Matrix> &expr, double *dst) {
+  const Matrix &a = expr.operand();
+  size_t size = a.n_rows * a.n_cols;
+  parallel::forRange(0, size, size, [&](size_t from, size_t to) {
+    simd::active().negate(dst + from, a.vals + from, to - from);
+  });
 }
 
-Matrix Matrix::operator-(const Matrix &a) const {
-  Matrix result = Matrix(*this);
-  result -= a;
-  return result;
+std::vector<double> Matrix::getRow(size_t row) {
+  if (row >= n_rows) {
+    throw OutOfBoundsException();
+  }
+  return std::vector<double>(vals + n_cols * row, vals + n_cols * (row + 1));
 }
 
-Matrix Matrix::operator*(const double &number) const {
-  Matrix result = Matrix(*this);
-  result *= number;
+std::vector<double> Matrix::getColumn(size_t column) {
+  if (column >= n_cols) {
+    throw OutOfBoundsException();
+  }
+  std::vector<double> result(n_rows);
+  for (size_t i = 0; i < n_rows; ++i) {
+    result[i] = vals[n_cols * i + column];
+  }
   return result;
 }
 
-Matrix Matrix::operator+() const {
-  Matrix result = Matrix(*this);
-  return result;
+MatrixView Matrix::view() {
+  invalidate();
+  return MatrixView(vals, n_rows, n_cols, n_cols);
 }
 
-Matrix Matrix::operator-() const {
-  Matrix result = Matrix(*this);
-  for (size_t i = 0; i < n_rows * n_cols; ++i) {
-    result.vals[i] *= -1;
-  }
-  return result;
+ConstMatrixView Matrix::view() const {
+  return ConstMatrixView(vals, n_rows, n_cols, n_cols);
 }
 
-bool Matrix::operator==(const Matrix &a) const {
-  if (n_rows != a.n_rows || n_cols != a.n_cols) {
-    throw SizeMismatchException();
-  }
-  for (size_t i = 0; i < n_rows * n_cols; ++i) {
-    if (fabs(vals[i] - a.vals[i]) > EPS) {
-      return false;
-    }
-  }
-  return true;
+MatrixView Matrix::row(size_t index) {
+  return view().row(index);
 }
-bool Matrix::operator!=(const Matrix &a) const {
-  if (n_rows != a.n_rows || n_cols != a.n_cols) {
-    throw SizeMismatchException();
-  }
-  for (size_t i = 0; i < n_rows * n_cols; ++i) {
-    if (fabs(vals[i] - a.vals[i]) > EPS) {
-      return true;
-    }
-  }
-  return false;
+
+ConstMatrixView Matrix::row(size_t index) const {
+  return view().row(index);
 }
 
-std::vector<double> Matrix::getRow(size_t row) {
-  std::vector<double> result(n_rows);
-  for (size_t i = 0; i < n_cols; ++i) {
-    result.push_back(vals[n_cols * row + i]);
-  }
-  return result;
+MatrixView Matrix::column(size_t index) {
+  return view().column(index);
 }
 
-std::vector<double> Matrix::getColumn(size_t column) {
-  std::vector<double> result(n_rows);
-  for (size_t i = 0; i < n_rows; ++i) {
-    result.push_back(vals[n_cols * i + column]);
-  }
-  return result;
+ConstMatrixView Matrix::column(size_t index) const {
+  return view().column(index);
 }
 
-double Matrix::det() const {
-  if (n_rows != n_cols) {
-    throw SizeMismatchException();
-  }
-  Matrix m = Matrix(*this);
-  for (size_t k = 0; k < n_rows - 1; ++k) {
-    for (size_t i = k + 1; i < n_rows; ++i) {
-      double tmp = -m[i][k] / m[k][k];
-      for (int j = 0; j < n_rows; ++j) {
-        m[i][j] += m[k][j] * tmp;
-      }
+MatrixView Matrix::block(size_t row, size_t col, size_t rows, size_t cols) {
+  return view().block(row, col, rows, cols);
+}
+
+ConstMatrixView Matrix::block(size_t row, size_t col, size_t rows, size_t cols) const {
+  return view().block(row, col, rows, cols);
+}
+
+const LUDecomposition &Matrix::factorization() const {
+  {
+    std::lock_guard<std::mutex> lock(derivedLock(this));
+    if (cached & LU) {
+      count(derived_hits);
+      return *cache->lu;
     }
   }
-  double res = 1.;
-  for (size_t i = 0; i < n_rows; ++i) {
-    res *= m[i][i];
+  std::unique_ptr<LUDecomposition> lu(new LUDecomposition(*this));
+  count(derived_computations);
+  std::lock_guard<std::mutex> lock(derivedLock(this));
+  // Another thread may have stored one meanwhile and be using it.
+  if (!(cached & LU)) {
+    if (!cache) {
+      cache = new Derived;
+    }
+    cache->lu = std::move(lu);
+    cached |= LU;
   }
-  return res;
+  return *cache->lu;
 }
 
-void Matrix::transpose() {
-  double *new_vals = new double[n_rows * n_cols];
-  for (size_t i = 0; i < n_rows; ++i) {
-    for (size_t j = 0; j < n_cols; ++j) {
-      new_vals[j * n_rows + i] = vals[i * n_cols + j];//set(j,i,tmp);
+double Matrix::det() const {
+  {
+    std::lock_guard<std::mutex> lock(derivedLock(this));
+    if (cached & DET) {
+      count(derived_hits);
+      return cache->det;
     }
   }
-  std::swap(new_vals, vals);
+  double result = factorization().det();
+  std::lock_guard<std::mutex> lock(derivedLock(this));
+  cache->det = result;
+  cached |= DET;
+  return result;
+}
+
+void Matrix::transpose() {
+  invalidate();
+  transposition::inPlace(n_rows, n_cols, vals);
   std::swap(n_rows, n_cols);
-  delete[] new_vals;
 }
 
 Matrix Matrix::transposed() const {
-  Matrix result = Matrix(n_cols, n_rows);
-  for (size_t i = 0; i < n_rows; ++i) {
-    for (size_t j = 0; j < n_cols; ++j) {
-      double tmp = (*this).get(i, j);
-      result.set(j, i, tmp);
+  const Matrix *kept = nullptr;
+  bool keep = false;
+  {
+    std::lock_guard<std::mutex> lock(derivedLock(this));
+    if (cached & TRANSPOSED) {
+      kept = cache->transposed.get();
+    } else {
+      keep = cached & TRANSPOSED_ONCE;
+      cached |= TRANSPOSED_ONCE;
+    }
+  }
+  // Kept results do not change until the matrix does, so the copy can be
+  // made outside the lock.
+  if (kept) {
+    count(derived_hits);
+    return *kept;
+  }
+  Matrix result(n_cols, n_rows, Uninitialized());
+  transposition::outOfPlace(n_rows, n_cols, vals, n_cols, result.vals, result.n_cols);
+  count(derived_computations);
+  if (keep) {
+    std::unique_ptr<Matrix> copy(new Matrix(result));
+    std::lock_guard<std::mutex> lock(derivedLock(this));
+    if (!(cached & TRANSPOSED)) {
+      if (!cache) {
+        cache = new Derived;
+      }
+      cache->transposed = std::move(copy);
+      cached |= TRANSPOSED;
     }
   }
   return result;
@@ -256,10 +358,24 @@ double Matrix::trace() const {
   if (n_rows != n_cols) {
     throw SizeMismatchException();
   }
+  {
+    std::lock_guard<std::mutex> lock(derivedLock(this));
+    if (cached & TRACE) {
+      count(derived_hits);
+      return cache->trace;
+    }
+  }
   double result = 0.;
   for (size_t i = 0; i < n_rows; ++i) {
-    result += (*this).get(i, i);
+    result += vals[i * n_cols + i];
   }
+  count(derived_computations);
+  std::lock_guard<std::mutex> lock(derivedLock(this));
+  if (!cache) {
+    cache = new Derived;
+  }
+  cache->trace = result;
+  cached |= TRACE;
   return result;
 }
 double Matrix::rows() const {
@@ -269,33 +385,4 @@ double Matrix::cols() const {
   return n_cols;
 }
 
-std::ostream &task::operator<<(std::ostream &output, const Matrix &matrix) {
-  for (size_t i = 0; i < matrix.rows(); ++i) {
-    for (size_t j = 0; j < matrix.cols(); ++j) {
-      output << matrix[i][j] << " ";
-    }
-    output << std::endl;
-  }
-  return output;
-}
-
-std::istream &task::operator>>(std::istream &input, Matrix &matrix) {
-  int n, m;
-  input >> n >> m;
-  matrix.resize(n, m);
-  for (size_t i = 0; i < n; ++i) {
-    for (size_t j = 0; j < m; ++j) {
-      double tmp;
-      input >> tmp;
-      matrix.set(i, j, tmp);
-    }
-  }
-  return input;
-}
-
-Matrix task::operator*(const double &a, const Matrix &b) {
-  return b.operator*(a);
-}
-
-
 // Your code goes here...
@@ -1,65 +1,367 @@
 #pragma once
 
+#include <atomic>
+#include <cmath>
 #include <iostream>
 #include <vector>
+#include "common.h"
+#include "matrix_expr.h"
+#include "matrix_view.h"
+#include "thread_pool.h"
 
 namespace task {
 
-const double EPS = 1e-6;
+class LUDecomposition;
+class SparseMatrix;
+class Matrix;
 
-class OutOfBoundsException : public std::exception {};
-class SizeMismatchException : public std::exception {};
+namespace binary {
+Matrix read(std::istream &input);
+}
 
-class Matrix {
+class Matrix : public MatrixExpr<Matrix> {
 
 public:
+  static constexpr bool held_by_reference = true;
+
   Matrix();
   Matrix(size_t rows, size_t cols);
   Matrix(const Matrix &copy);
+  Matrix(Matrix &&other) noexcept;
+  template<class E>
+  Matrix(const MatrixExpr<E> &expr);
   Matrix &operator=(const Matrix &a);
+  Matrix &operator=(Matrix &&a) noexcept;
+  template<class E>
+  Matrix &operator=(const MatrixExpr<E> &expr);
   ~Matrix();
-  double &get(size_t row, size_t col);
-  const double &get(size_t row, size_t col) const;
-  void set(size_t row, size_t col, const double &value);
+
+  // Element access checked as bounds::Default says (see TASK_BOUNDS_CHECK);
+  // get<bounds::Checked> or get<bounds::Unchecked> picks explicitly.
+  template<class Bounds = bounds::Default>
+  double &get(size_t row, size_t col) {
+    Bounds::check(row, n_rows);
+    Bounds::check(col, n_cols);
+    invalidate();
+    return vals[n_cols * row + col];
+  }
+  template<class Bounds = bounds::Default>
+  const double &get(size_t row, size_t col) const {
+    Bounds::check(row, n_rows);
+    Bounds::check(col, n_cols);
+    return vals[n_cols * row + col];
+  }
+  template<class Bounds = bounds::Default>
+  void set(size_t row, size_t col, const double &value) {
+    get<Bounds>(row, col) = value;
+  }
   void resize(size_t new_rows, size_t new_cols);
 
-  double *operator[](size_t row);
-  const double *operator[](size_t row) const;
+  // The row index is checked as in get(); columns cannot be.
+  double *operator[](size_t row) {
+    bounds::Default::check(row, n_rows);
+    invalidate();
+    return vals + row * n_cols;
+  }
+  const double *operator[](size_t row) const {
+    bounds::Default::check(row, n_rows);
+    return vals + row * n_cols;
+  }
+
+  // Unchecked element access, for the algorithms.
+  double &operator()(size_t row, size_t col) {
+    invalidate();
+    return vals[n_cols * row + col];
+  }
+  const double &operator()(size_t row, size_t col) const {
+    return vals[n_cols * row + col];
+  }
 
   Matrix &operator+=(const Matrix &a);
   Matrix &operator-=(const Matrix &a);
+  template<class E>
+  Matrix &operator+=(const MatrixExpr<E> &expr);
+  template<class E>
+  Matrix &operator-=(const MatrixExpr<E> &expr);
   Matrix &operator*=(const Matrix &a);
   Matrix &operator*=(const double &number);
 
-  Matrix operator+(const Matrix &a) const;
-  Matrix operator-(const Matrix &a) const;
-  Matrix operator*(const Matrix &a) const;
-  Matrix operator*(const double &a) const;
-
-  Matrix operator-() const;
-  Matrix operator+() const;
-
+  // det(), lu(), trace() and transposed() keep their results and return
+  // them again until the matrix changes; solve() and inverse() reuse the
+  // kept factorization. transposed() keeps a copy only once it has been
+  // asked for twice, so one-off transposes cost no extra memory.
   double det() const;
+  LUDecomposition lu() const;
+  Matrix solve(const Matrix &b) const;
+  std::vector<double> solve(const std::vector<double> &b) const;
+  Matrix inverse() const;
   void transpose();
   Matrix transposed() const;
   double trace() const;
 
+  // Drops the kept results. Mutable accessors, assignments, compound
+  // operators, resize(), transpose() and the mutable views call it;
+  // writes through a row pointer or view obtained before a result was
+  // computed need an explicit call.
+  void invalidate() {
+    // Checked first so that threads filling different rows do not all
+    // write to the matrix object.
+    if (cached.load(std::memory_order_relaxed) != 0) {
+      cached.store(0, std::memory_order_relaxed);
+    }
+  }
+
   std::vector<double> getRow(size_t row);
   std::vector<double> getColumn(size_t column);
 
-  bool operator==(const Matrix &a) const;
-  bool operator!=(const Matrix &a) const;
+  // Zero-copy views; they are invalidated by resize() and transpose().
+  MatrixView view();
+  ConstMatrixView view() const;
+  MatrixView row(size_t index);
+  ConstMatrixView row(size_t index) const;
+  MatrixView column(size_t index);
+  ConstMatrixView column(size_t index) const;
+  MatrixView block(size_t row, size_t col, size_t rows, size_t cols);
+  ConstMatrixView block(size_t row, size_t col, size_t rows, size_t cols) const;
 
   double rows() const;
   double cols() const;
 
+  // Expression interface; at() is not bounds checked.
+  size_t rowCount() const {
+    return n_rows;
+  }
+  size_t colCount() const {
+    return n_cols;
+  }
+  double at(size_t row, size_t col) const {
+    return vals[n_cols * row + col];
+  }
+  const double *data() const {
+    return vals;
+  }
+  size_t rowStride() const {
+    return n_cols;
+  }
+  size_t colStride() const {
+    return 1;
+  }
+
+  friend Matrix product(const ConstMatrixView &a, const ConstMatrixView &b);
+  friend class LUDecomposition;
+  friend Matrix operator*(const SparseMatrix &a, const Matrix &b);
+  friend Matrix operator*(const Matrix &a, const SparseMatrix &b);
+  friend class SparseMatrix;
+  friend Matrix binary::read(std::istream &input);
+  friend std::ostream &operator<<(std::ostream &output, const Matrix &matrix);
+  friend std::istream &operator>>(std::istream &input, Matrix &matrix);
+
 private:
+  // Tag for constructing a matrix whose values are about to be overwritten.
+  struct Uninitialized {};
+  Matrix(size_t rows, size_t cols, Uninitialized);
+
+  static double *allocate(size_t size);
+  static void deallocate(double *data, size_t size);
+
+  template<class E>
+  static void evaluate(const E &expr, double *dst);
+  static void evaluate(const MatrixNegatedExpr<Matrix> &expr, double *dst);
+
+  // Results kept by the const methods above, allocated on first use.
+  // Filled under a lock shared with a few other matrices, so that const
+  // matrices can still be used from several threads at once.
+  struct Derived;
+  const LUDecomposition &factorization() const;
+
   double *vals;
   size_t n_rows;
   size_t n_cols;
+  mutable Derived *cache = nullptr;
+  // Which of the kept results are up to date.
+  mutable std::atomic<unsigned> cached{0};
 };
 
-Matrix operator*(const double &a, const Matrix &b);
+// Factorization P * A = L * U of a square matrix with partial pivoting,
+// computed in column panels with the trailing update done by the blocked
+// multiplication kernel. L is unit lower triangular; L and U are stored
+// together in one matrix.
+class LUDecomposition {
+public:
+  // Throws SizeMismatchException if a is not square.
+  explicit LUDecomposition(const Matrix &a);
+
+  Matrix lower() const;
+  Matrix upper() const;
+  Matrix permutationMatrix() const;
+  // Row i of P * A is row permutation()[i] of A.
+  const std::vector<size_t> &permutation() const;
+
+  double det() const;
+  bool singular() const;
+
+  // Solves A * X = b; throws SizeMismatchException if b has a different
+  // number of rows and SingularMatrixException if A is singular.
+  Matrix solve(const Matrix &b) const;
+  // The same for one right-hand side, by two triangular solves.
+  std::vector<double> solve(const std::vector<double> &b) const;
+  Matrix inverse() const;
+
+private:
+  Matrix factors;
+  std::vector<size_t> perm;
+  int parity;
+};
+
+// Number of element buffers allocated by all matrices so far. Tests use it
+// to check that an expression allocates no more than it has to.
+size_t allocationCount();
+
+struct DerivedStats {
+  size_t hits;          // det(), lu(), trace(), transposed(), solve() and
+                        // inverse() calls served from kept results
+  size_t computations;  // factorizations, traces and transposes computed
+};
+
+DerivedStats derivedStats();
+void resetDerivedStats();
+
+// Matrix product through the blocked kernel, see gemm.h, or through
+// Strassen-Winograd for large products when enabled, see strassen.h.
+// Strided and transposed views are multiplied without copying.
+Matrix product(const ConstMatrixView &a, const ConstMatrixView &b);
+
+// Element-wise arithmetic is lazy: operators build expression nodes that
+// are fused into one loop when assigned to a Matrix. Shapes are checked
+// when the node is built. Products are always materialised.
+
+template<class E>
+void Matrix::evaluate(const E &expr, double *dst) {
+  size_t n = expr.rowCount(), m = expr.colCount();
+  parallel::forRange(0, n, n * m, [&](size_t from, size_t to) {
+    for (size_t i = from; i < to; ++i) {
+      double *row = dst + i * m;
+      for (size_t j = 0; j < m; ++j) {
+        row[j] = expr.at(i, j);
+      }
+    }
+  });
+}
+
+template<class E>
+Matrix::Matrix(const MatrixExpr<E> &expr) : n_rows(expr.rowCount()), n_cols(expr.colCount()) {
+  vals = allocate(n_rows * n_cols);
+  evaluate(expr.self(), vals);
+}
+
+template<class E>
+Matrix &Matrix::operator=(const MatrixExpr<E> &expr) {
+  invalidate();
+  size_t new_rows = expr.rowCount(), new_cols = expr.colCount();
+  if (new_rows == n_rows && new_cols == n_cols && !readsAcross(expr.self(), *this)) {
+    // Element-wise expressions only read position (i, j) to write it,
+    // so evaluating in place is safe if *this is an operand, though not
+    // if it is read through a transposed or shifted view.
+    evaluate(expr.self(), vals);
+  } else {
+    double *new_vals = allocate(new_rows * new_cols);
+    evaluate(expr.self(), new_vals);
+    deallocate(vals, n_rows * n_cols);
+    vals = new_vals;
+    n_rows = new_rows;
+    n_cols = new_cols;
+  }
+  return *this;
+}
+
+template<class E>
+Matrix &Matrix::operator+=(const MatrixExpr<E> &expr) {
+  view() += expr;
+  return *this;
+}
+
+template<class E>
+Matrix &Matrix::operator-=(const MatrixExpr<E> &expr) {
+  view() -= expr;
+  return *this;
+}
+
+// Turns an operand of a product into something with storage.
+inline const Matrix &materialize(const Matrix &a) {
+  return a;
+}
+
+template<class T>
+BasicMatrixView<T> materialize(const BasicMatrixView<T> &a) {
+  return a;
+}
+
+template<class E>
+Matrix materialize(const MatrixExpr<E> &expr) {
+  return Matrix(expr);
+}
+
+template<class L, class R>
+MatrixBinaryExpr<L, R, ExprPlus> operator+(const MatrixExpr<L> &a, const MatrixExpr<R> &b) {
+  if (a.rowCount() != b.rowCount() || a.colCount() != b.colCount()) {
+    throw SizeMismatchException();
+  }
+  return MatrixBinaryExpr<L, R, ExprPlus>(a.self(), b.self());
+}
+
+template<class L, class R>
+MatrixBinaryExpr<L, R, ExprMinus> operator-(const MatrixExpr<L> &a, const MatrixExpr<R> &b) {
+  if (a.rowCount() != b.rowCount() || a.colCount() != b.colCount()) {
+    throw SizeMismatchException();
+  }
+  return MatrixBinaryExpr<L, R, ExprMinus>(a.self(), b.self());
+}
+
+template<class E>
+MatrixScaledExpr<E> operator*(const MatrixExpr<E> &a, const double &number) {
+  return MatrixScaledExpr<E>(a.self(), number);
+}
+
+template<class E>
+MatrixScaledExpr<E> operator*(const double &number, const MatrixExpr<E> &a) {
+  return MatrixScaledExpr<E>(a.self(), number);
+}
+
+template<class L, class R>
+Matrix operator*(const MatrixExpr<L> &a, const MatrixExpr<R> &b) {
+  return product(materialize(a.self()).view(), materialize(b.self()).view());
+}
+
+template<class E>
+MatrixNegatedExpr<E> operator-(const MatrixExpr<E> &a) {
+  return MatrixNegatedExpr<E>(a.self());
+}
+
+template<class E>
+const E &operator+(const MatrixExpr<E> &a) {
+  return a.self();
+}
+
+template<class L, class R>
+bool operator==(const MatrixExpr<L> &a, const MatrixExpr<R> &b) {
+  size_t n = a.rowCount(), m = a.colCount();
+  if (n != b.rowCount() || m != b.colCount()) {
+    throw SizeMismatchException();
+  }
+  for (size_t i = 0; i < n; ++i) {
+    for (size_t j = 0; j < m; ++j) {
+      if (std::fabs(a.at(i, j) - b.at(i, j)) > EPS) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+template<class L, class R>
+bool operator!=(const MatrixExpr<L> &a, const MatrixExpr<R> &b) {
+  return !(a == b);
+}
 
 std::ostream &operator<<(std::ostream &output, const Matrix &matrix);
 std::istream &operator>>(std::istream &input, Matrix &matrix);
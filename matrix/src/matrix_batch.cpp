@@ -0,0 +1,396 @@
+#include "matrix_batch.h"
+#include "simd.h"
+#include "storage.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define TASK_BATCH_X86
+#endif
+
+using namespace task;
+
+namespace {
+
+const size_t W = MatrixBatch::LANES;
+// Largest matrices det() eliminates in registers-sized local storage;
+// bigger ones go through Matrix::det() one by one.
+const size_t MAX_LANE_DET = 16;
+
+// One value from each of the W matrices of a chunk. GCC lowers operations
+// on this type to whatever registers the enclosing function targets: one
+// zmm with AVX-512, two ymm with AVX2, four xmm otherwise. The lane kernels
+// are inlined into the per-ISA entry points below, so each gets its own
+// code from the same source. Lane arrays are 64-byte aligned and chunks
+// start at multiples of W, so the casts are aligned loads and stores.
+typedef double Lanes __attribute__((vector_size(W * sizeof(double)), may_alias));
+
+__attribute__((always_inline)) inline const Lanes &at(const double *lanes, size_t base) {
+  return *reinterpret_cast<const Lanes *>(lanes + base);
+}
+
+__attribute__((always_inline)) inline Lanes &at(double *lanes, size_t base) {
+  return *reinterpret_cast<Lanes *>(lanes + base);
+}
+
+// out need not be aligned.
+__attribute__((always_inline)) inline void store(double *out, size_t base, const Lanes &value) {
+  std::memcpy(out + base, &value, sizeof(Lanes));
+}
+
+// Lanes [base, base + W) of c (m x n) = a (m x k) * b (k x n).
+__attribute__((always_inline)) inline void multiplyLanes(size_t m, size_t n, size_t k,
+                                                         const double *a, const double *b, double *c,
+                                                         size_t stride, size_t base) {
+  for (size_t i = 0; i < m; ++i) {
+    for (size_t j = 0; j < n; ++j) {
+      Lanes acc = {};
+      for (size_t l = 0; l < k; ++l) {
+        acc += at(a + (i * k + l) * stride, base) * at(b + (l * n + j) * stride, base);
+      }
+      at(c + (i * n + j) * stride, base) = acc;
+    }
+  }
+}
+
+// Gaussian elimination with partial pivoting in every lane at once; row
+// swaps become selects so that lanes never take different branches.
+__attribute__((always_inline)) inline void eliminateLanes(size_t n, const double *a, size_t stride,
+                                                          size_t base, double *out) {
+  Lanes m[MAX_LANE_DET * MAX_LANE_DET];
+  for (size_t index = 0; index < n * n; ++index) {
+    m[index] = at(a + index * stride, base);
+  }
+  Lanes zero = {}, det = zero + 1.;
+  for (size_t k = 0; k < n; ++k) {
+    // Row indices are small, so doubles hold them exactly.
+    Lanes best = m[k * n + k], pivot = zero + double(k);
+    best = best < 0 ? -best : best;
+    for (size_t i = k + 1; i < n; ++i) {
+      Lanes value = m[i * n + k];
+      value = value < 0 ? -value : value;
+      auto better = value > best;
+      best = better ? value : best;
+      pivot = better ? zero + double(i) : pivot;
+    }
+    det = pivot != double(k) ? -det : det;
+    for (size_t i = k + 1; i < n; ++i) {
+      auto swap = pivot == double(i);
+      for (size_t j = k; j < n; ++j) {
+        Lanes top = m[k * n + j], other = m[i * n + j];
+        m[k * n + j] = swap ? other : top;
+        m[i * n + j] = swap ? top : other;
+      }
+    }
+    Lanes p = m[k * n + k];
+    det *= p;
+    // A zero pivot means a zero column: det is 0 and stays finite.
+    Lanes inverse = p == 0 ? zero : 1 / p;
+    for (size_t i = k + 1; i < n; ++i) {
+      Lanes factor = m[i * n + k] * inverse;
+      for (size_t j = k + 1; j < n; ++j) {
+        m[i * n + j] -= factor * m[k * n + j];
+      }
+    }
+  }
+  store(out, base, det);
+}
+
+__attribute__((always_inline)) inline void detLanes(size_t n, const double *a, size_t stride,
+                                                    size_t base, double *out) {
+  auto e = [&](size_t i, size_t j) -> const Lanes & {
+    return at(a + (i * n + j) * stride, base);
+  };
+  if (n == 1) {
+    store(out, base, e(0, 0));
+  } else if (n == 2) {
+    store(out, base, e(0, 0) * e(1, 1) - e(0, 1) * e(1, 0));
+  } else if (n == 3) {
+    store(out, base, e(0, 0) * (e(1, 1) * e(2, 2) - e(1, 2) * e(2, 1))
+                   - e(0, 1) * (e(1, 0) * e(2, 2) - e(1, 2) * e(2, 0))
+                   + e(0, 2) * (e(1, 0) * e(2, 1) - e(1, 1) * e(2, 0)));
+  } else {
+    eliminateLanes(n, a, stride, base, out);
+  }
+}
+
+void multiplyChunks(size_t m, size_t n, size_t k, const double *a, const double *b, double *c,
+                    size_t stride, size_t from, size_t to) {
+  for (size_t chunk = from; chunk < to; ++chunk) {
+    multiplyLanes(m, n, k, a, b, c, stride, chunk * W);
+  }
+}
+
+void detChunks(size_t n, const double *a, size_t stride, double *out, size_t from, size_t to) {
+  for (size_t chunk = from; chunk < to; ++chunk) {
+    detLanes(n, a, stride, chunk * W, out);
+  }
+}
+
+#ifdef TASK_BATCH_X86
+
+__attribute__((target("avx2"))) void multiplyChunksAvx2(size_t m, size_t n, size_t k,
+                                                        const double *a, const double *b, double *c,
+                                                        size_t stride, size_t from, size_t to) {
+  for (size_t chunk = from; chunk < to; ++chunk) {
+    multiplyLanes(m, n, k, a, b, c, stride, chunk * W);
+  }
+}
+
+__attribute__((target("avx2"))) void detChunksAvx2(size_t n, const double *a, size_t stride,
+                                                   double *out, size_t from, size_t to) {
+  for (size_t chunk = from; chunk < to; ++chunk) {
+    detLanes(n, a, stride, chunk * W, out);
+  }
+}
+
+__attribute__((target("avx512f"))) void multiplyChunksAvx512(size_t m, size_t n, size_t k,
+                                                             const double *a, const double *b, double *c,
+                                                             size_t stride, size_t from, size_t to) {
+  for (size_t chunk = from; chunk < to; ++chunk) {
+    multiplyLanes(m, n, k, a, b, c, stride, chunk * W);
+  }
+}
+
+__attribute__((target("avx512f"))) void detChunksAvx512(size_t n, const double *a, size_t stride,
+                                                        double *out, size_t from, size_t to) {
+  for (size_t chunk = from; chunk < to; ++chunk) {
+    detLanes(n, a, stride, chunk * W, out);
+  }
+}
+
+#endif // TASK_BATCH_X86
+
+struct BatchKernels {
+  void (*multiply)(size_t m, size_t n, size_t k, const double *a, const double *b, double *c,
+                   size_t stride, size_t from, size_t to);
+  void (*det)(size_t n, const double *a, size_t stride, double *out, size_t from, size_t to);
+};
+
+// Follows the instruction set picked for the element-wise kernels.
+BatchKernels batchKernels() {
+#ifdef TASK_BATCH_X86
+  switch (simd::activeIsa()) {
+    case simd::Isa::kAvx2:
+      return {multiplyChunksAvx2, detChunksAvx2};
+    case simd::Isa::kAvx512:
+      return {multiplyChunksAvx512, detChunksAvx512};
+    default:
+      break;
+  }
+#endif
+  return {multiplyChunks, detChunks};
+}
+
+size_t paddedCount(size_t count) {
+  return (count + W - 1) / W * W;
+}
+
+} // namespace
+
+MatrixBatch::MatrixBatch(size_t count, size_t rows, size_t cols, Uninitialized)
+    : n_count(count), n_rows(rows), n_cols(cols), stride(paddedCount(count)) {
+  vals = storage::policy().allocate(bufferSize());
+}
+
+MatrixBatch::MatrixBatch(size_t count, size_t rows, size_t cols)
+    : MatrixBatch(count, rows, cols, Uninitialized()) {
+  std::fill(vals, vals + bufferSize(), 0.);
+  for (size_t i = 0; i < rows && i < cols; ++i) {
+    std::fill(lanes(i, i), lanes(i, i) + count, 1.);
+  }
+}
+
+MatrixBatch::MatrixBatch(const std::vector<Matrix> &matrices)
+    : MatrixBatch(matrices.size(),
+                  matrices.empty() ? 0 : matrices[0].rowCount(),
+                  matrices.empty() ? 0 : matrices[0].colCount(), Uninitialized()) {
+  // The delegated constructor has finished, so the destructor releases
+  // the buffer if a shape mismatch throws here.
+  std::fill(vals, vals + bufferSize(), 0.);
+  for (size_t index = 0; index < n_count; ++index) {
+    setMatrix(index, matrices[index]);
+  }
+}
+
+MatrixBatch::MatrixBatch(const MatrixBatch &copy)
+    : MatrixBatch(copy.n_count, copy.n_rows, copy.n_cols, Uninitialized()) {
+  std::copy(copy.vals, copy.vals + bufferSize(), vals);
+}
+
+MatrixBatch::MatrixBatch(MatrixBatch &&other) noexcept
+    : vals(other.vals), n_count(other.n_count), n_rows(other.n_rows), n_cols(other.n_cols),
+      stride(other.stride) {
+  other.vals = nullptr;
+  other.n_count = other.n_rows = other.n_cols = other.stride = 0;
+}
+
+MatrixBatch &MatrixBatch::operator=(const MatrixBatch &a) {
+  if (this != &a) {
+    if (bufferSize() != a.bufferSize()) {
+      double *new_vals = storage::policy().allocate(a.bufferSize());
+      storage::policy().deallocate(vals, bufferSize());
+      vals = new_vals;
+    }
+    n_count = a.n_count;
+    n_rows = a.n_rows;
+    n_cols = a.n_cols;
+    stride = a.stride;
+    std::copy(a.vals, a.vals + bufferSize(), vals);
+  }
+  return *this;
+}
+
+MatrixBatch &MatrixBatch::operator=(MatrixBatch &&a) noexcept {
+  std::swap(vals, a.vals);
+  std::swap(n_count, a.n_count);
+  std::swap(n_rows, a.n_rows);
+  std::swap(n_cols, a.n_cols);
+  std::swap(stride, a.stride);
+  return *this;
+}
+
+MatrixBatch::~MatrixBatch() {
+  storage::policy().deallocate(vals, bufferSize());
+}
+
+Matrix MatrixBatch::matrix(size_t index) const {
+  if (index >= n_count) {
+    throw OutOfBoundsException();
+  }
+  Matrix result(n_rows, n_cols);
+  for (size_t i = 0; i < n_rows; ++i) {
+    for (size_t j = 0; j < n_cols; ++j) {
+      result(i, j) = (*this)(index, i, j);
+    }
+  }
+  return result;
+}
+
+void MatrixBatch::setMatrix(size_t index, const Matrix &a) {
+  if (index >= n_count) {
+    throw OutOfBoundsException();
+  }
+  if (a.rowCount() != n_rows || a.colCount() != n_cols) {
+    throw SizeMismatchException();
+  }
+  for (size_t i = 0; i < n_rows; ++i) {
+    for (size_t j = 0; j < n_cols; ++j) {
+      (*this)(index, i, j) = a(i, j);
+    }
+  }
+}
+
+MatrixBatch &MatrixBatch::operator+=(const MatrixBatch &a) {
+  if (n_count != a.n_count || n_rows != a.n_rows || n_cols != a.n_cols) {
+    throw SizeMismatchException();
+  }
+  size_t size = bufferSize();
+  parallel::forRange(0, size, size, [&](size_t from, size_t to) {
+    simd::active().add(vals + from, a.vals + from, to - from);
+  });
+  return *this;
+}
+
+MatrixBatch &MatrixBatch::operator-=(const MatrixBatch &a) {
+  if (n_count != a.n_count || n_rows != a.n_rows || n_cols != a.n_cols) {
+    throw SizeMismatchException();
+  }
+  size_t size = bufferSize();
+  parallel::forRange(0, size, size, [&](size_t from, size_t to) {
+    simd::active().sub(vals + from, a.vals + from, to - from);
+  });
+  return *this;
+}
+
+MatrixBatch &MatrixBatch::operator*=(const double &number) {
+  size_t size = bufferSize();
+  parallel::forRange(0, size, size, [&](size_t from, size_t to) {
+    simd::active().scale(vals + from, number, to - from);
+  });
+  return *this;
+}
+
+std::vector<double> MatrixBatch::det() const {
+  if (n_rows != n_cols) {
+    throw SizeMismatchException();
+  }
+  std::vector<double> result(stride);
+  if (n_rows == 0) {
+    std::fill(result.begin(), result.end(), 1.);
+  } else if (n_rows <= MAX_LANE_DET) {
+    auto kernel = batchKernels().det;
+    parallel::forRange(0, stride / W, bufferSize(), [&](size_t from, size_t to) {
+      kernel(n_rows, vals, stride, result.data(), from, to);
+    });
+  } else {
+    for (size_t index = 0; index < n_count; ++index) {
+      result[index] = matrix(index).det();
+    }
+  }
+  result.resize(n_count);
+  return result;
+}
+
+std::vector<double> MatrixBatch::trace() const {
+  if (n_rows != n_cols) {
+    throw SizeMismatchException();
+  }
+  std::vector<double> result(stride, 0.);
+  for (size_t i = 0; i < n_rows; ++i) {
+    simd::active().add(result.data(), lanes(i, i), stride);
+  }
+  result.resize(n_count);
+  return result;
+}
+
+MatrixBatch MatrixBatch::transposed() const {
+  MatrixBatch result(n_count, n_cols, n_rows, Uninitialized());
+  for (size_t i = 0; i < n_rows; ++i) {
+    for (size_t j = 0; j < n_cols; ++j) {
+      std::memcpy(result.lanes(j, i), lanes(i, j), stride * sizeof(double));
+    }
+  }
+  return result;
+}
+
+MatrixBatch task::operator*(const MatrixBatch &a, const MatrixBatch &b) {
+  if (a.n_count != b.n_count || a.n_cols != b.n_rows) {
+    throw SizeMismatchException();
+  }
+  MatrixBatch result(a.n_count, a.n_rows, b.n_cols, MatrixBatch::Uninitialized());
+  if (a.n_cols == 0) {
+    std::fill(result.vals, result.vals + result.bufferSize(), 0.);
+    return result;
+  }
+  auto kernel = batchKernels().multiply;
+  size_t work = a.stride * a.n_rows * a.n_cols * b.n_cols;
+  parallel::forRange(0, a.stride / W, work, [&](size_t from, size_t to) {
+    kernel(a.n_rows, b.n_cols, a.n_cols, a.vals, b.vals, result.vals, a.stride, from, to);
+  });
+  return result;
+}
+
+MatrixBatch task::operator+(const MatrixBatch &a, const MatrixBatch &b) {
+  MatrixBatch result = a;
+  result += b;
+  return result;
+}
+
+MatrixBatch task::operator-(const MatrixBatch &a, const MatrixBatch &b) {
+  MatrixBatch result = a;
+  result -= b;
+  return result;
+}
+
+MatrixBatch task::operator*(const MatrixBatch &a, const double &number) {
+  MatrixBatch result = a;
+  result *= number;
+  return result;
+}
+
+MatrixBatch task::operator*(const double &number, const MatrixBatch &a) {
+  return a * number;
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include "common.h"
+#include "matrix.h"
+
+namespace task {
+
+// Many matrices of one shape stored as a structure of arrays: element
+// (row, col) of every matrix forms one contiguous array, the lanes of that
+// element, so operations process the whole batch with vector instructions
+// across matrices instead of looping over small matrices one at a time.
+// Lane arrays are padded to a multiple of LANES doubles and 64-byte
+// aligned; the padding holds zero matrices.
+//
+// Meant for tens of thousands of small (2..16) matrices; any shape works.
+class MatrixBatch {
+public:
+  // Matrices processed together by one kernel invocation.
+  static const size_t LANES = 8;
+
+  // count identity-like matrices, as Matrix(rows, cols) makes.
+  MatrixBatch(size_t count = 0, size_t rows = 1, size_t cols = 1);
+  // Throws SizeMismatchException unless all matrices have the same shape.
+  explicit MatrixBatch(const std::vector<Matrix> &matrices);
+  MatrixBatch(const MatrixBatch &copy);
+  MatrixBatch(MatrixBatch &&other) noexcept;
+  MatrixBatch &operator=(const MatrixBatch &a);
+  MatrixBatch &operator=(MatrixBatch &&a) noexcept;
+  ~MatrixBatch();
+
+  size_t size() const {
+    return n_count;
+  }
+  size_t rowCount() const {
+    return n_rows;
+  }
+  size_t colCount() const {
+    return n_cols;
+  }
+
+  // Element (row, col) of matrix index; not bounds checked.
+  double &operator()(size_t index, size_t row, size_t col) {
+    return vals[(row * n_cols + col) * stride + index];
+  }
+  const double &operator()(size_t index, size_t row, size_t col) const {
+    return vals[(row * n_cols + col) * stride + index];
+  }
+  // The same, checked as bounds::Default says.
+  double &get(size_t index, size_t row, size_t col) {
+    bounds::Default::check(index, n_count);
+    bounds::Default::check(row, n_rows);
+    bounds::Default::check(col, n_cols);
+    return (*this)(index, row, col);
+  }
+  const double &get(size_t index, size_t row, size_t col) const {
+    bounds::Default::check(index, n_count);
+    bounds::Default::check(row, n_rows);
+    bounds::Default::check(col, n_cols);
+    return (*this)(index, row, col);
+  }
+
+  // Lanes of element (row, col): laneStride() doubles, size() of them used.
+  double *lanes(size_t row, size_t col) {
+    return vals + (row * n_cols + col) * stride;
+  }
+  const double *lanes(size_t row, size_t col) const {
+    return vals + (row * n_cols + col) * stride;
+  }
+  size_t laneStride() const {
+    return stride;
+  }
+
+  // Copies one matrix out of or into the batch; throws OutOfBoundsException
+  // for a bad index and SizeMismatchException for a different shape.
+  Matrix matrix(size_t index) const;
+  void setMatrix(size_t index, const Matrix &a);
+
+  MatrixBatch &operator+=(const MatrixBatch &a);
+  MatrixBatch &operator-=(const MatrixBatch &a);
+  MatrixBatch &operator*=(const double &number);
+
+  // Per-matrix results, in batch order.
+  std::vector<double> det() const;
+  std::vector<double> trace() const;
+  MatrixBatch transposed() const;
+
+  // Matrix-by-matrix product of two batches of the same size.
+  friend MatrixBatch operator*(const MatrixBatch &a, const MatrixBatch &b);
+
+private:
+  struct Uninitialized {};
+  MatrixBatch(size_t count, size_t rows, size_t cols, Uninitialized);
+
+  size_t bufferSize() const {
+    return n_rows * n_cols * stride;
+  }
+
+  double *vals;
+  size_t n_count;
+  size_t n_rows;
+  size_t n_cols;
+  size_t stride;
+};
+
+// Shapes and sizes are checked as for Matrix, with SizeMismatchException.
+MatrixBatch operator+(const MatrixBatch &a, const MatrixBatch &b);
+MatrixBatch operator-(const MatrixBatch &a, const MatrixBatch &b);
+MatrixBatch operator*(const MatrixBatch &a, const MatrixBatch &b);
+MatrixBatch operator*(const MatrixBatch &a, const double &number);
+MatrixBatch operator*(const double &number, const MatrixBatch &a);
+
+} // namespace task
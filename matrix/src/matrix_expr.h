@@ -0,0 +1,126 @@
+#pragma once
+
+#include <cstddef>
+#include <type_traits>
+
+namespace task {
+
+// Base of everything that can appear in a lazy element-wise expression.
+// Derived types provide rowCount(), colCount() and an unchecked at(row, col);
+// they are evaluated in a single pass when assigned into a Matrix.
+template<class E>
+class MatrixExpr {
+public:
+  const E &self() const {
+    return static_cast<const E &>(*this);
+  }
+
+  size_t rowCount() const {
+    return self().rowCount();
+  }
+  size_t colCount() const {
+    return self().colCount();
+  }
+  double at(size_t row, size_t col) const {
+    return self().at(row, col);
+  }
+};
+
+// Matrices are captured by reference, views and intermediate nodes by
+// value, so an expression must not outlive the matrices it was built from.
+template<class E>
+using ExprOperand = typename std::conditional<E::held_by_reference, const E &, const E>::type;
+
+struct ExprPlus {
+  static double apply(double a, double b) {
+    return a + b;
+  }
+};
+
+struct ExprMinus {
+  static double apply(double a, double b) {
+    return a - b;
+  }
+};
+
+template<class L, class R, class Op>
+class MatrixBinaryExpr : public MatrixExpr<MatrixBinaryExpr<L, R, Op>> {
+public:
+  static constexpr bool held_by_reference = false;
+
+  MatrixBinaryExpr(const L &lhs, const R &rhs) : lhs(lhs), rhs(rhs) {}
+
+  size_t rowCount() const {
+    return lhs.rowCount();
+  }
+  size_t colCount() const {
+    return lhs.colCount();
+  }
+  double at(size_t row, size_t col) const {
+    return Op::apply(lhs.at(row, col), rhs.at(row, col));
+  }
+
+  const L &left() const {
+    return lhs;
+  }
+  const R &right() const {
+    return rhs;
+  }
+
+private:
+  ExprOperand<L> lhs;
+  ExprOperand<R> rhs;
+};
+
+template<class E>
+class MatrixScaledExpr : public MatrixExpr<MatrixScaledExpr<E>> {
+public:
+  static constexpr bool held_by_reference = false;
+
+  MatrixScaledExpr(const E &expr, double factor) : expr(expr), factor(factor) {}
+
+  size_t rowCount() const {
+    return expr.rowCount();
+  }
+  size_t colCount() const {
+    return expr.colCount();
+  }
+  double at(size_t row, size_t col) const {
+    return expr.at(row, col) * factor;
+  }
+
+  const E &operand() const {
+    return expr;
+  }
+
+private:
+  ExprOperand<E> expr;
+  double factor;
+};
+
+template<class E>
+class MatrixNegatedExpr : public MatrixExpr<MatrixNegatedExpr<E>> {
+public:
+  static constexpr bool held_by_reference = false;
+
+  explicit MatrixNegatedExpr(const E &expr) : expr(expr) {}
+
+  size_t rowCount() const {
+    return expr.rowCount();
+  }
+  size_t colCount() const {
+    return expr.colCount();
+  }
+  double at(size_t row, size_t col) const {
+    return -expr.at(row, col);
+  }
+
+  const E &operand() const {
+    return expr;
+  }
+
+private:
+  ExprOperand<E> expr;
+};
+
+} // namespace task
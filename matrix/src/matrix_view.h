@@ -0,0 +1,251 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "common.h"
+#include "matrix_expr.h"
+#include "simd.h"
+#include "thread_pool.h"
+
+namespace task {
+
+// Whether E is backed by strided storage (a Matrix or a view), i.e. has
+// data(), rowStride() and colStride().
+template<class E, class = void>
+struct HasStorage : std::false_type {};
+
+template<class E>
+struct HasStorage<E, decltype(void(std::declval<const E &>().rowStride()))> : std::true_type {};
+
+// Whether writing expr element by element into dst, which has storage
+// too, could overwrite an element before expr reads it: some operand
+// shares memory with dst but addresses it differently, like a transposed
+// or shifted view of the matrix being assigned. Operands addressing the
+// memory exactly as dst does are safe, as (i, j) is only read to write
+// (i, j).
+template<class E, class D>
+bool readsAcross(const E &expr, const D &dst) {
+  if constexpr (HasStorage<E>::value) {
+    if (expr.data() == dst.data() && expr.rowStride() == dst.rowStride() && expr.colStride() == dst.colStride()) {
+      return false;
+    }
+    if (expr.rowCount() == 0 || expr.colCount() == 0 || dst.rowCount() == 0 || dst.colCount() == 0) {
+      return false;
+    }
+    auto end = [](const auto &a) {
+      return a.data() + (a.rowCount() - 1) * a.rowStride() + (a.colCount() - 1) * a.colStride() + 1;
+    };
+    std::less<const double *> less;
+    return less(expr.data(), end(dst)) && less(dst.data(), end(expr));
+  } else {
+    return false;
+  }
+}
+
+template<class L, class R, class Op, class D>
+bool readsAcross(const MatrixBinaryExpr<L, R, Op> &expr, const D &dst) {
+  return readsAcross(expr.left(), dst) || readsAcross(expr.right(), dst);
+}
+
+template<class E, class D>
+bool readsAcross(const MatrixScaledExpr<E> &expr, const D &dst) {
+  return readsAcross(expr.operand(), dst);
+}
+
+template<class E, class D>
+bool readsAcross(const MatrixNegatedExpr<E> &expr, const D &dst) {
+  return readsAcross(expr.operand(), dst);
+}
+
+// Non-owning window into matrix storage: element (i, j) lives at
+// data[i * row_stride + j * col_stride]. Rows, columns, blocks and
+// transposed views share memory with the matrix they came from and
+// must not outlive it.
+//
+// Copying a view copies the window; assigning to a mutable view writes
+// elements, like assigning to a block of the underlying matrix. A source
+// that overlaps the view through other strides or offsets, as in
+// view = view.transposed(), is copied out first.
+template<class T>
+class BasicMatrixView : public MatrixExpr<BasicMatrixView<T>> {
+public:
+  static constexpr bool held_by_reference = false;
+
+  BasicMatrixView(T *data, size_t rows, size_t cols, size_t row_stride, size_t col_stride = 1)
+      : ptr(data), n_rows(rows), n_cols(cols), row_step(row_stride), col_step(col_stride) {}
+
+  BasicMatrixView(const BasicMatrixView &other) = default;
+
+  // A mutable view converts to a read-only one.
+  template<class U, class = typename std::enable_if<std::is_same<const U, T>::value && !std::is_same<U, T>::value>::type>
+  BasicMatrixView(const BasicMatrixView<U> &other)
+      : ptr(other.data()), n_rows(other.rowCount()), n_cols(other.colCount()),
+        row_step(other.rowStride()), col_step(other.colStride()) {}
+
+  T *data() const {
+    return ptr;
+  }
+  size_t rowStride() const {
+    return row_step;
+  }
+  size_t colStride() const {
+    return col_step;
+  }
+  size_t rowCount() const {
+    return n_rows;
+  }
+  size_t colCount() const {
+    return n_cols;
+  }
+
+  // Unchecked element access.
+  double at(size_t row, size_t col) const {
+    return ptr[row * row_step + col * col_step];
+  }
+  T &operator()(size_t row, size_t col) const {
+    return ptr[row * row_step + col * col_step];
+  }
+
+  // Checked as bounds::Default says, like Matrix::get.
+  T &get(size_t row, size_t col) const {
+    bounds::Default::check(row, n_rows);
+    bounds::Default::check(col, n_cols);
+    return (*this)(row, col);
+  }
+
+  BasicMatrixView row(size_t index) const {
+    return block(index, 0, 1, n_cols);
+  }
+
+  BasicMatrixView column(size_t index) const {
+    return block(0, index, n_rows, 1);
+  }
+
+  BasicMatrixView block(size_t row, size_t col, size_t rows, size_t cols) const {
+    if (row + rows > n_rows || col + cols > n_cols) {
+      throw OutOfBoundsException();
+    }
+    return BasicMatrixView(ptr + row * row_step + col * col_step, rows, cols, row_step, col_step);
+  }
+
+  BasicMatrixView transposed() const {
+    return BasicMatrixView(ptr, n_cols, n_rows, col_step, row_step);
+  }
+
+  BasicMatrixView<const double> view() const {
+    return *this;
+  }
+
+  BasicMatrixView &operator=(const BasicMatrixView &other) {
+    return assign(other);
+  }
+
+  template<class E>
+  BasicMatrixView &operator=(const MatrixExpr<E> &expr) {
+    return assign(expr.self());
+  }
+
+  template<class E>
+  BasicMatrixView &operator+=(const MatrixExpr<E> &expr) {
+    return combine(expr.self(), simd::active().add, [](double &x, double y) { x += y; });
+  }
+
+  template<class E>
+  BasicMatrixView &operator-=(const MatrixExpr<E> &expr) {
+    return combine(expr.self(), simd::active().sub, [](double &x, double y) { x -= y; });
+  }
+
+  BasicMatrixView &operator*=(const double &number) {
+    static_assert(!std::is_const<T>::value, "Cannot modify a read-only view");
+    parallel::forRange(0, n_rows, n_rows * n_cols, [&](size_t from, size_t to) {
+      for (size_t i = from; i < to; ++i) {
+        if (col_step == 1) {
+          simd::active().scale(ptr + i * row_step, number, n_cols);
+        } else {
+          for (size_t j = 0; j < n_cols; ++j) {
+            (*this)(i, j) *= number;
+          }
+        }
+      }
+    });
+    return *this;
+  }
+
+private:
+  template<class E>
+  BasicMatrixView &assign(const E &expr) {
+    static_assert(!std::is_const<T>::value, "Cannot modify a read-only view");
+    if (n_rows != expr.rowCount() || n_cols != expr.colCount()) {
+      throw SizeMismatchException();
+    }
+    if (readsAcross(expr, *this)) {
+      std::vector<double> copy = evaluateCopy(expr);
+      return assign(BasicMatrixView<const double>(copy.data(), n_rows, n_cols, n_cols));
+    }
+    parallel::forRange(0, n_rows, n_rows * n_cols, [&](size_t from, size_t to) {
+      for (size_t i = from; i < to; ++i) {
+        for (size_t j = 0; j < n_cols; ++j) {
+          (*this)(i, j) = expr.at(i, j);
+        }
+      }
+    });
+    return *this;
+  }
+
+  // Applies a SIMD row kernel when both sides have contiguous rows and an
+  // element-wise operation otherwise.
+  template<class E, class Op>
+  BasicMatrixView &combine(const E &a, void (*row_kernel)(double *, const double *, size_t), Op op) {
+    static_assert(!std::is_const<T>::value, "Cannot modify a read-only view");
+    if (n_rows != a.rowCount() || n_cols != a.colCount()) {
+      throw SizeMismatchException();
+    }
+    if (readsAcross(a, *this)) {
+      std::vector<double> copy = evaluateCopy(a);
+      return combine(BasicMatrixView<const double>(copy.data(), n_rows, n_cols, n_cols), row_kernel, op);
+    }
+    parallel::forRange(0, n_rows, n_rows * n_cols, [&](size_t from, size_t to) {
+      for (size_t i = from; i < to; ++i) {
+        if constexpr (HasStorage<E>::value) {
+          if (col_step == 1 && a.colStride() == 1) {
+            row_kernel(ptr + i * row_step, a.data() + i * a.rowStride(), n_cols);
+            continue;
+          }
+        }
+        for (size_t j = 0; j < n_cols; ++j) {
+          op((*this)(i, j), a.at(i, j));
+        }
+      }
+    });
+    return *this;
+  }
+
+  // expr evaluated into rows of a separate buffer.
+  template<class E>
+  static std::vector<double> evaluateCopy(const E &expr) {
+    size_t rows = expr.rowCount(), cols = expr.colCount();
+    std::vector<double> copy(rows * cols);
+    parallel::forRange(0, rows, rows * cols, [&](size_t from, size_t to) {
+      for (size_t i = from; i < to; ++i) {
+        for (size_t j = 0; j < cols; ++j) {
+          copy[i * cols + j] = expr.at(i, j);
+        }
+      }
+    });
+    return copy;
+  }
+
+  T *ptr;
+  size_t n_rows;
+  size_t n_cols;
+  size_t row_step;
+  size_t col_step;
+};
+
+using MatrixView = BasicMatrixView<double>;
+using ConstMatrixView = BasicMatrixView<const double>;
+
+} // namespace task
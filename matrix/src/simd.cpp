@@ -0,0 +1,437 @@
+#include "simd.h"
+#include <atomic>
+#include <cstring>
+#include <initializer_list>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define TASK_SIMD_X86
+#include <immintrin.h>
+#endif
+
+using namespace task;
+
+namespace {
+
+void addScalar(double *x, const double *y, size_t n) {
+  for (size_t i = 0; i < n; ++i) {
+    x[i] += y[i];
+  }
+}
+
+void subScalar(double *x, const double *y, size_t n) {
+  for (size_t i = 0; i < n; ++i) {
+    x[i] -= y[i];
+  }
+}
+
+void scaleScalar(double *x, double alpha, size_t n) {
+  for (size_t i = 0; i < n; ++i) {
+    x[i] *= alpha;
+  }
+}
+
+void negateScalar(double *dst, const double *src, size_t n) {
+  for (size_t i = 0; i < n; ++i) {
+    dst[i] = -src[i];
+  }
+}
+
+const simd::Kernels SCALAR = {addScalar, subScalar, scaleScalar, negateScalar};
+
+#ifdef TASK_SIMD_X86
+
+// SSE2 is part of x86-64, so these need no target attribute.
+
+void addSse2(double *x, const double *y, size_t n) {
+  size_t i = 0;
+  for (; i + 2 <= n; i += 2) {
+    _mm_storeu_pd(x + i, _mm_add_pd(_mm_loadu_pd(x + i), _mm_loadu_pd(y + i)));
+  }
+  addScalar(x + i, y + i, n - i);
+}
+
+void subSse2(double *x, const double *y, size_t n) {
+  size_t i = 0;
+  for (; i + 2 <= n; i += 2) {
+    _mm_storeu_pd(x + i, _mm_sub_pd(_mm_loadu_pd(x + i), _mm_loadu_pd(y + i)));
+  }
+  subScalar(x + i, y + i, n - i);
+}
+
+void scaleSse2(double *x, double alpha, size_t n) {
+  __m128d factor = _mm_set1_pd(alpha);
+  size_t i = 0;
+  for (; i + 2 <= n; i += 2) {
+    _mm_storeu_pd(x + i, _mm_mul_pd(_mm_loadu_pd(x + i), factor));
+  }
+  scaleScalar(x + i, alpha, n - i);
+}
+
+void negateSse2(double *dst, const double *src, size_t n) {
+  __m128d sign = _mm_set1_pd(-0.);
+  size_t i = 0;
+  for (; i + 2 <= n; i += 2) {
+    _mm_storeu_pd(dst + i, _mm_xor_pd(_mm_loadu_pd(src + i), sign));
+  }
+  negateScalar(dst + i, src + i, n - i);
+}
+
+__attribute__((target("avx2"))) void addAvx2(double *x, const double *y, size_t n) {
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m256d lo = _mm256_add_pd(_mm256_loadu_pd(x + i), _mm256_loadu_pd(y + i));
+    __m256d hi = _mm256_add_pd(_mm256_loadu_pd(x + i + 4), _mm256_loadu_pd(y + i + 4));
+    _mm256_storeu_pd(x + i, lo);
+    _mm256_storeu_pd(x + i + 4, hi);
+  }
+  addSse2(x + i, y + i, n - i);
+}
+
+__attribute__((target("avx2"))) void subAvx2(double *x, const double *y, size_t n) {
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m256d lo = _mm256_sub_pd(_mm256_loadu_pd(x + i), _mm256_loadu_pd(y + i));
+    __m256d hi = _mm256_sub_pd(_mm256_loadu_pd(x + i + 4), _mm256_loadu_pd(y + i + 4));
+    _mm256_storeu_pd(x + i, lo);
+    _mm256_storeu_pd(x + i + 4, hi);
+  }
+  subSse2(x + i, y + i, n - i);
+}
+
+__attribute__((target("avx2"))) void scaleAvx2(double *x, double alpha, size_t n) {
+  __m256d factor = _mm256_set1_pd(alpha);
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    _mm256_storeu_pd(x + i, _mm256_mul_pd(_mm256_loadu_pd(x + i), factor));
+    _mm256_storeu_pd(x + i + 4, _mm256_mul_pd(_mm256_loadu_pd(x + i + 4), factor));
+  }
+  scaleSse2(x + i, alpha, n - i);
+}
+
+__attribute__((target("avx2"))) void negateAvx2(double *dst, const double *src, size_t n) {
+  __m256d sign = _mm256_set1_pd(-0.);
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    _mm256_storeu_pd(dst + i, _mm256_xor_pd(_mm256_loadu_pd(src + i), sign));
+    _mm256_storeu_pd(dst + i + 4, _mm256_xor_pd(_mm256_loadu_pd(src + i + 4), sign));
+  }
+  negateSse2(dst + i, src + i, n - i);
+}
+
+// The AVX-512 kernels handle the ragged tail with a masked load/store.
+
+__attribute__((target("avx512f"))) inline __mmask8 tailMask(size_t rest) {
+  return static_cast<__mmask8>((1u << rest) - 1);
+}
+
+__attribute__((target("avx512f"))) void addAvx512(double *x, const double *y, size_t n) {
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    _mm512_storeu_pd(x + i, _mm512_add_pd(_mm512_loadu_pd(x + i), _mm512_loadu_pd(y + i)));
+  }
+  if (i < n) {
+    __mmask8 mask = tailMask(n - i);
+    __m512d sum = _mm512_add_pd(_mm512_maskz_loadu_pd(mask, x + i), _mm512_maskz_loadu_pd(mask, y + i));
+    _mm512_mask_storeu_pd(x + i, mask, sum);
+  }
+}
+
+__attribute__((target("avx512f"))) void subAvx512(double *x, const double *y, size_t n) {
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    _mm512_storeu_pd(x + i, _mm512_sub_pd(_mm512_loadu_pd(x + i), _mm512_loadu_pd(y + i)));
+  }
+  if (i < n) {
+    __mmask8 mask = tailMask(n - i);
+    __m512d diff = _mm512_sub_pd(_mm512_maskz_loadu_pd(mask, x + i), _mm512_maskz_loadu_pd(mask, y + i));
+    _mm512_mask_storeu_pd(x + i, mask, diff);
+  }
+}
+
+__attribute__((target("avx512f"))) void scaleAvx512(double *x, double alpha, size_t n) {
+  __m512d factor = _mm512_set1_pd(alpha);
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    _mm512_storeu_pd(x + i, _mm512_mul_pd(_mm512_loadu_pd(x + i), factor));
+  }
+  if (i < n) {
+    __mmask8 mask = tailMask(n - i);
+    _mm512_mask_storeu_pd(x + i, mask, _mm512_mul_pd(_mm512_maskz_loadu_pd(mask, x + i), factor));
+  }
+}
+
+__attribute__((target("avx512f"))) void negateAvx512(double *dst, const double *src, size_t n) {
+  __m512i sign = _mm512_set1_epi64(static_cast<long long>(0x8000000000000000ull));
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m512i bits = _mm512_castpd_si512(_mm512_loadu_pd(src + i));
+    _mm512_storeu_pd(dst + i, _mm512_castsi512_pd(_mm512_xor_si512(bits, sign)));
+  }
+  if (i < n) {
+    __mmask8 mask = tailMask(n - i);
+    __m512i bits = _mm512_castpd_si512(_mm512_maskz_loadu_pd(mask, src + i));
+    _mm512_mask_storeu_pd(dst + i, mask, _mm512_castsi512_pd(_mm512_xor_si512(bits, sign)));
+  }
+}
+
+const simd::Kernels SSE2 = {addSse2, subSse2, scaleSse2, negateSse2};
+const simd::Kernels AVX2 = {addAvx2, subAvx2, scaleAvx2, negateAvx2};
+const simd::Kernels AVX512 = {addAvx512, subAvx512, scaleAvx512, negateAvx512};
+
+#endif // TASK_SIMD_X86
+
+// Read by pool threads through active() while setActiveIsa() may write it.
+std::atomic<simd::Isa> &activeSlot() {
+  static std::atomic<simd::Isa> isa(simd::detectedIsa());
+  return isa;
+}
+
+} // namespace
+
+const char *simd::isaName(Isa isa) {
+  switch (isa) {
+    case Isa::kSse2:
+      return "sse2";
+    case Isa::kAvx2:
+      return "avx2";
+    case Isa::kAvx512:
+      return "avx512";
+    default:
+      return "scalar";
+  }
+}
+
+bool simd::supported(Isa isa) {
+#ifdef TASK_SIMD_X86
+  switch (isa) {
+    case Isa::kScalar:
+    case Isa::kSse2:
+      return true;
+    case Isa::kAvx2:
+      return __builtin_cpu_supports("avx2");
+    case Isa::kAvx512:
+      return __builtin_cpu_supports("avx512f");
+  }
+  return false;
+#else
+  return isa == Isa::kScalar;
+#endif
+}
+
+simd::Isa simd::detectedIsa() {
+  static const Isa detected = [] {
+    for (Isa isa : {Isa::kAvx512, Isa::kAvx2, Isa::kSse2}) {
+      if (supported(isa)) {
+        return isa;
+      }
+    }
+    return Isa::kScalar;
+  }();
+  return detected;
+}
+
+const simd::Kernels &simd::kernels(Isa isa) {
+#ifdef TASK_SIMD_X86
+  switch (isa) {
+    case Isa::kSse2:
+      return SSE2;
+    case Isa::kAvx2:
+      return AVX2;
+    case Isa::kAvx512:
+      return AVX512;
+    default:
+      return SCALAR;
+  }
+#else
+  return SCALAR;
+#endif
+}
+
+const simd::Kernels &simd::active() {
+  return kernels(activeIsa());
+}
+
+simd::Isa simd::activeIsa() {
+  return activeSlot().load(std::memory_order_relaxed);
+}
+
+void simd::setActiveIsa(Isa isa) {
+  activeSlot().store(supported(isa) ? isa : detectedIsa(), std::memory_order_relaxed);
+}
+
+namespace {
+
+// Kernels for the element types of BasicMatrix, written once over a GCC
+// vector of 64 bytes and inlined into an entry point per instruction set,
+// which lowers it to one zmm, two ymm or four xmm registers. The default
+// entry points get SSE2 on x86-64 and whatever the target has elsewhere.
+
+template<class T>
+struct Vector {
+  typedef T type __attribute__((vector_size(64)));
+};
+
+// Unaligned; vectors never pass by value, which would change the ABI of
+// the entry points built without AVX-512.
+template<class T>
+__attribute__((always_inline)) inline void load(typename Vector<T>::type &value, const T *data) {
+  std::memcpy(&value, data, sizeof(value));
+}
+
+template<class T>
+__attribute__((always_inline)) inline void store(T *data, const typename Vector<T>::type &value) {
+  std::memcpy(data, &value, sizeof(value));
+}
+
+template<class T>
+__attribute__((always_inline)) inline void addLanes(T *x, const T *y, size_t n) {
+  const size_t w = sizeof(typename Vector<T>::type) / sizeof(T);
+  size_t i = 0;
+  for (; i + w <= n; i += w) {
+    typename Vector<T>::type a, b;
+    load(a, x + i);
+    load(b, y + i);
+    store(x + i, a + b);
+  }
+  for (; i < n; ++i) {
+    x[i] += y[i];
+  }
+}
+
+template<class T>
+__attribute__((always_inline)) inline void subLanes(T *x, const T *y, size_t n) {
+  const size_t w = sizeof(typename Vector<T>::type) / sizeof(T);
+  size_t i = 0;
+  for (; i + w <= n; i += w) {
+    typename Vector<T>::type a, b;
+    load(a, x + i);
+    load(b, y + i);
+    store(x + i, a - b);
+  }
+  for (; i < n; ++i) {
+    x[i] -= y[i];
+  }
+}
+
+template<class T>
+__attribute__((always_inline)) inline void scaleLanes(T *x, T alpha, size_t n) {
+  const size_t w = sizeof(typename Vector<T>::type) / sizeof(T);
+  size_t i = 0;
+  for (; i + w <= n; i += w) {
+    typename Vector<T>::type a;
+    load(a, x + i);
+    store(x + i, a * alpha);
+  }
+  for (; i < n; ++i) {
+    x[i] *= alpha;
+  }
+}
+
+template<class T>
+__attribute__((always_inline)) inline void axpyLanes(T *y, T alpha, const T *x, size_t n) {
+  const size_t w = sizeof(typename Vector<T>::type) / sizeof(T);
+  size_t i = 0;
+  for (; i + w <= n; i += w) {
+    typename Vector<T>::type a, b;
+    load(a, y + i);
+    load(b, x + i);
+    store(y + i, a + b * alpha);
+  }
+  for (; i < n; ++i) {
+    y[i] += alpha * x[i];
+  }
+}
+
+template<class T>
+void addDefault(T *x, const T *y, size_t n) {
+  addLanes(x, y, n);
+}
+
+template<class T>
+void subDefault(T *x, const T *y, size_t n) {
+  subLanes(x, y, n);
+}
+
+template<class T>
+void scaleDefault(T *x, T alpha, size_t n) {
+  scaleLanes(x, alpha, n);
+}
+
+template<class T>
+void axpyDefault(T *y, T alpha, const T *x, size_t n) {
+  axpyLanes(y, alpha, x, n);
+}
+
+#ifdef TASK_SIMD_X86
+
+template<class T>
+__attribute__((target("avx2"))) void addTypedAvx2(T *x, const T *y, size_t n) {
+  addLanes(x, y, n);
+}
+
+template<class T>
+__attribute__((target("avx2"))) void subTypedAvx2(T *x, const T *y, size_t n) {
+  subLanes(x, y, n);
+}
+
+template<class T>
+__attribute__((target("avx2"))) void scaleTypedAvx2(T *x, T alpha, size_t n) {
+  scaleLanes(x, alpha, n);
+}
+
+template<class T>
+__attribute__((target("avx2"))) void axpyTypedAvx2(T *y, T alpha, const T *x, size_t n) {
+  axpyLanes(y, alpha, x, n);
+}
+
+template<class T>
+__attribute__((target("avx512f"))) void addTypedAvx512(T *x, const T *y, size_t n) {
+  addLanes(x, y, n);
+}
+
+template<class T>
+__attribute__((target("avx512f"))) void subTypedAvx512(T *x, const T *y, size_t n) {
+  subLanes(x, y, n);
+}
+
+template<class T>
+__attribute__((target("avx512f"))) void scaleTypedAvx512(T *x, T alpha, size_t n) {
+  scaleLanes(x, alpha, n);
+}
+
+template<class T>
+__attribute__((target("avx512f"))) void axpyTypedAvx512(T *y, T alpha, const T *x, size_t n) {
+  axpyLanes(y, alpha, x, n);
+}
+
+#endif // TASK_SIMD_X86
+
+} // namespace
+
+template<class T>
+const simd::TypedKernels<T> &simd::kernelsFor(Isa isa) {
+  static_assert(HasKernels<T>::value, "no compiled kernels for this element type");
+  static const TypedKernels<T> DEFAULT = {addDefault<T>, subDefault<T>, scaleDefault<T>, axpyDefault<T>};
+#ifdef TASK_SIMD_X86
+  static const TypedKernels<T> AVX2 = {addTypedAvx2<T>, subTypedAvx2<T>, scaleTypedAvx2<T>, axpyTypedAvx2<T>};
+  static const TypedKernels<T> AVX512 = {addTypedAvx512<T>, subTypedAvx512<T>, scaleTypedAvx512<T>,
+                                         axpyTypedAvx512<T>};
+  switch (isa) {
+    case Isa::kScalar:
+      return genericKernels<T>();
+    case Isa::kAvx2:
+      return AVX2;
+    case Isa::kAvx512:
+      return AVX512;
+    default:
+      return DEFAULT;
+  }
+#else
+  return isa == Isa::kScalar ? genericKernels<T>() : DEFAULT;
+#endif
+}
+
+template const simd::TypedKernels<float> &simd::kernelsFor<float>(Isa isa);
+template const simd::TypedKernels<double> &simd::kernelsFor<double>(Isa isa);
+template const simd::TypedKernels<int32_t> &simd::kernelsFor<int32_t>(Isa isa);
+template const simd::TypedKernels<int64_t> &simd::kernelsFor<int64_t>(Isa isa);
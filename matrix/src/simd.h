@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+namespace task {
+namespace simd {
+
+// Instruction sets the element-wise kernels are compiled for.
+enum class Isa { kScalar, kSse2, kAvx2, kAvx512 };
+
+// Element-wise kernels over contiguous arrays of n doubles.
+struct Kernels {
+  void (*add)(double *x, const double *y, size_t n);         // x += y
+  void (*sub)(double *x, const double *y, size_t n);         // x -= y
+  void (*scale)(double *x, double alpha, size_t n);          // x *= alpha
+  void (*negate)(double *dst, const double *src, size_t n);  // dst = -src
+};
+
+const char *isaName(Isa isa);
+
+// Whether the running CPU (and OS) can execute kernels built for isa.
+bool supported(Isa isa);
+
+// The best instruction set supported by the running CPU, detected once.
+Isa detectedIsa();
+
+// Kernel table for the given instruction set, which must be supported.
+const Kernels &kernels(Isa isa);
+
+// Kernel table used by Matrix, picked via cpuid on first use.
+const Kernels &active();
+Isa activeIsa();
+
+// Overrides the instruction set used by Matrix, e.g. to compare variants.
+// Falls back to detectedIsa() if isa is not supported.
+void setActiveIsa(Isa isa);
+
+// Element-wise kernels for the element types of BasicMatrix.
+template<class T>
+struct TypedKernels {
+  void (*add)(T *x, const T *y, size_t n);            // x += y
+  void (*sub)(T *x, const T *y, size_t n);            // x -= y
+  void (*scale)(T *x, T alpha, size_t n);             // x *= alpha
+  void (*axpy)(T *y, T alpha, const T *x, size_t n);  // y += alpha * x
+};
+
+// Types with compiled kernels: float, double, int32_t and int64_t.
+template<class T>
+struct HasKernels
+    : std::integral_constant<bool, std::is_same<T, float>::value || std::is_same<T, double>::value ||
+                                   std::is_same<T, int32_t>::value || std::is_same<T, int64_t>::value> {};
+
+// Kernel table of a type with HasKernels for the given instruction set,
+// which must be supported, and the one following activeIsa().
+template<class T>
+const TypedKernels<T> &kernelsFor(Isa isa);
+template<class T>
+const TypedKernels<T> &activeFor() {
+  return kernelsFor<T>(activeIsa());
+}
+
+// Plain loops, for element types without compiled kernels.
+template<class T>
+const TypedKernels<T> &genericKernels() {
+  static const TypedKernels<T> table = {
+    [](T *x, const T *y, size_t n) {
+      for (size_t i = 0; i < n; ++i) {
+        x[i] += y[i];
+      }
+    },
+    [](T *x, const T *y, size_t n) {
+      for (size_t i = 0; i < n; ++i) {
+        x[i] -= y[i];
+      }
+    },
+    [](T *x, T alpha, size_t n) {
+      for (size_t i = 0; i < n; ++i) {
+        x[i] *= alpha;
+      }
+    },
+    [](T *y, T alpha, const T *x, size_t n) {
+      for (size_t i = 0; i < n; ++i) {
+        y[i] += alpha * x[i];
+      }
+    },
+  };
+  return table;
+}
+
+} // namespace simd
+} // namespace task
@@ -0,0 +1,271 @@
+#include "sparse_matrix.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <cmath>
+#include <optional>
+
+using namespace task;
+
+SparseMatrix::SparseMatrix(size_t rows, size_t cols, Layout layout)
+    : n_rows(rows), n_cols(cols), storage_layout(layout), starts(majorCount() + 1, 0) {}
+
+SparseMatrix::SparseMatrix(const Matrix &dense, Layout layout, double threshold)
+    : n_rows(dense.rowCount()), n_cols(dense.colCount()), storage_layout(Layout::kCsr) {
+  starts.reserve(n_rows + 1);
+  starts.push_back(0);
+  for (size_t i = 0; i < n_rows; ++i) {
+    const double *row = dense.data() + i * n_cols;
+    for (size_t j = 0; j < n_cols; ++j) {
+      if (std::fabs(row[j]) > threshold) {
+        minor.push_back(j);
+        vals.push_back(row[j]);
+      }
+    }
+    starts.push_back(vals.size());
+  }
+  if (layout != Layout::kCsr) {
+    *this = toLayout(layout);
+  }
+}
+
+double SparseMatrix::density() const {
+  size_t size = n_rows * n_cols;
+  return size == 0 ? 0. : static_cast<double>(nonZeros()) / size;
+}
+
+size_t SparseMatrix::memoryBytes() const {
+  return (starts.size() + minor.size()) * sizeof(size_t) + vals.size() * sizeof(double);
+}
+
+double SparseMatrix::get(size_t row, size_t col) const {
+  if (row >= n_rows || col >= n_cols) {
+    throw OutOfBoundsException();
+  }
+  size_t major_index = storage_layout == Layout::kCsr ? row : col;
+  size_t minor_index = storage_layout == Layout::kCsr ? col : row;
+  auto begin = minor.begin() + starts[major_index], end = minor.begin() + starts[major_index + 1];
+  auto found = std::lower_bound(begin, end, minor_index);
+  return found != end && *found == minor_index ? vals[found - minor.begin()] : 0.;
+}
+
+SparseMatrix SparseMatrix::toLayout(Layout layout) const {
+  if (layout == storage_layout) {
+    return *this;
+  }
+  // Counting sort by the minor index. Majors are visited in order, so the
+  // new minor indices come out sorted.
+  SparseMatrix result(n_rows, n_cols, layout);
+  for (size_t index : minor) {
+    ++result.starts[index + 1];
+  }
+  for (size_t i = 1; i < result.starts.size(); ++i) {
+    result.starts[i] += result.starts[i - 1];
+  }
+  result.minor.resize(nonZeros());
+  result.vals.resize(nonZeros());
+  std::vector<size_t> next(result.starts.begin(), result.starts.end() - 1);
+  for (size_t major = 0; major < majorCount(); ++major) {
+    for (size_t p = starts[major]; p < starts[major + 1]; ++p) {
+      size_t position = next[minor[p]]++;
+      result.minor[position] = major;
+      result.vals[position] = vals[p];
+    }
+  }
+  return result;
+}
+
+SparseMatrix SparseMatrix::transposed() const {
+  SparseMatrix result = *this;
+  std::swap(result.n_rows, result.n_cols);
+  result.storage_layout = storage_layout == Layout::kCsr ? Layout::kCsc : Layout::kCsr;
+  return result;
+}
+
+Matrix SparseMatrix::toDense() const {
+  Matrix result(n_rows, n_cols, Matrix::Uninitialized());
+  MatrixView dense = result.view();
+  std::fill(dense.data(), dense.data() + n_rows * n_cols, 0.);
+  for (size_t major = 0; major < majorCount(); ++major) {
+    for (size_t p = starts[major]; p < starts[major + 1]; ++p) {
+      if (storage_layout == Layout::kCsr) {
+        dense(major, minor[p]) = vals[p];
+      } else {
+        dense(minor[p], major) = vals[p];
+      }
+    }
+  }
+  return result;
+}
+
+SparseMatrix &SparseMatrix::operator*=(const double &number) {
+  if (number == 0) {
+    *this = SparseMatrix(n_rows, n_cols, storage_layout);
+    return *this;
+  }
+  for (double &value : vals) {
+    value *= number;
+  }
+  return *this;
+}
+
+template<class Op>
+SparseMatrix SparseMatrix::merge(const SparseMatrix &a, const SparseMatrix &b_any, Op op) {
+  if (a.n_rows != b_any.n_rows || a.n_cols != b_any.n_cols) {
+    throw SizeMismatchException();
+  }
+  // Converted only when needed; a conditional expression would copy b_any.
+  std::optional<SparseMatrix> converted;
+  if (b_any.storage_layout != a.storage_layout) {
+    converted = b_any.toLayout(a.storage_layout);
+  }
+  const SparseMatrix &b = converted ? *converted : b_any;
+  SparseMatrix result(a.n_rows, a.n_cols, a.storage_layout);
+  result.minor.reserve(a.nonZeros() + b.nonZeros());
+  result.vals.reserve(a.nonZeros() + b.nonZeros());
+  auto append = [&](size_t index, double value) {
+    if (value != 0) {
+      result.minor.push_back(index);
+      result.vals.push_back(value);
+    }
+  };
+  for (size_t major = 0; major < a.majorCount(); ++major) {
+    size_t p = a.starts[major], p_end = a.starts[major + 1];
+    size_t q = b.starts[major], q_end = b.starts[major + 1];
+    while (p < p_end || q < q_end) {
+      if (q == q_end || (p < p_end && a.minor[p] < b.minor[q])) {
+        append(a.minor[p], op(a.vals[p], 0.));
+        ++p;
+      } else if (p == p_end || b.minor[q] < a.minor[p]) {
+        append(b.minor[q], op(0., b.vals[q]));
+        ++q;
+      } else {
+        append(a.minor[p], op(a.vals[p], b.vals[q]));
+        ++p;
+        ++q;
+      }
+    }
+    result.starts[major + 1] = result.vals.size();
+  }
+  return result;
+}
+
+SparseMatrix task::operator+(const SparseMatrix &a, const SparseMatrix &b) {
+  return SparseMatrix::merge(a, b, [](double x, double y) { return x + y; });
+}
+
+SparseMatrix task::operator-(const SparseMatrix &a, const SparseMatrix &b) {
+  return SparseMatrix::merge(a, b, [](double x, double y) { return x - y; });
+}
+
+SparseMatrix task::operator*(const SparseMatrix &a, const double &number) {
+  SparseMatrix result = a;
+  result *= number;
+  return result;
+}
+
+SparseMatrix task::operator*(const double &number, const SparseMatrix &a) {
+  return a * number;
+}
+
+std::vector<double> task::operator*(const SparseMatrix &a, const std::vector<double> &x) {
+  if (x.size() != a.colCount()) {
+    throw SizeMismatchException();
+  }
+  const auto &starts = a.offsets();
+  const auto &minor = a.indices();
+  const auto &vals = a.values();
+  std::vector<double> y(a.rowCount(), 0.);
+  if (a.layout() == SparseMatrix::Layout::kCsr) {
+    parallel::forRange(0, a.rowCount(), a.nonZeros(), [&](size_t from, size_t to) {
+      for (size_t i = from; i < to; ++i) {
+        double sum = 0;
+        for (size_t p = starts[i]; p < starts[i + 1]; ++p) {
+          sum += vals[p] * x[minor[p]];
+        }
+        y[i] = sum;
+      }
+    });
+  } else {
+    // Columns scatter into y, which does not split across threads.
+    for (size_t j = 0; j < a.colCount(); ++j) {
+      double x_j = x[j];
+      for (size_t p = starts[j]; p < starts[j + 1]; ++p) {
+        y[minor[p]] += vals[p] * x_j;
+      }
+    }
+  }
+  return y;
+}
+
+Matrix task::operator*(const SparseMatrix &a_any, const Matrix &b) {
+  if (a_any.colCount() != b.n_rows) {
+    throw SizeMismatchException();
+  }
+  // Row i of the result is a combination of the rows of b picked by row i
+  // of a, so CSR lets every thread own a band of result rows.
+  std::optional<SparseMatrix> converted;
+  if (a_any.layout() != SparseMatrix::Layout::kCsr) {
+    converted = a_any.toLayout(SparseMatrix::Layout::kCsr);
+  }
+  const SparseMatrix &a = converted ? *converted : a_any;
+  const auto &starts = a.offsets();
+  const auto &minor = a.indices();
+  const auto &vals = a.values();
+  size_t n = b.n_cols;
+  Matrix result(a.rowCount(), n, Matrix::Uninitialized());
+  parallel::forRange(0, a.rowCount(), a.nonZeros() * n, [&](size_t from, size_t to) {
+    for (size_t i = from; i < to; ++i) {
+      double *c_row = result.vals + i * n;
+      std::fill(c_row, c_row + n, 0.);
+      for (size_t p = starts[i]; p < starts[i + 1]; ++p) {
+        double value = vals[p];
+        const double *b_row = b.vals + minor[p] * n;
+        for (size_t j = 0; j < n; ++j) {
+          c_row[j] += value * b_row[j];
+        }
+      }
+    }
+  });
+  return result;
+}
+
+Matrix task::operator*(const Matrix &a, const SparseMatrix &b) {
+  if (a.n_cols != b.rowCount()) {
+    throw SizeMismatchException();
+  }
+  const auto &starts = b.offsets();
+  const auto &minor = b.indices();
+  const auto &vals = b.values();
+  size_t k = a.n_cols, n = b.colCount();
+  Matrix result(a.n_rows, n, Matrix::Uninitialized());
+  bool csr = b.layout() == SparseMatrix::Layout::kCsr;
+  parallel::forRange(0, a.n_rows, b.nonZeros() * a.n_rows, [&](size_t from, size_t to) {
+    for (size_t i = from; i < to; ++i) {
+      const double *a_row = a.vals + i * k;
+      double *c_row = result.vals + i * n;
+      if (csr) {
+        // Scatter a(i, l) * (row l of b).
+        std::fill(c_row, c_row + n, 0.);
+        for (size_t l = 0; l < k; ++l) {
+          double a_il = a_row[l];
+          if (a_il == 0) {
+            continue;
+          }
+          for (size_t p = starts[l]; p < starts[l + 1]; ++p) {
+            c_row[minor[p]] += a_il * vals[p];
+          }
+        }
+      } else {
+        // Gather row i of a against each stored column of b.
+        for (size_t j = 0; j < n; ++j) {
+          double sum = 0;
+          for (size_t p = starts[j]; p < starts[j + 1]; ++p) {
+            sum += a_row[minor[p]] * vals[p];
+          }
+          c_row[j] = sum;
+        }
+      }
+    }
+  });
+  return result;
+}
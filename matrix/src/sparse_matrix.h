@@ -0,0 +1,100 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include "common.h"
+#include "matrix.h"
+
+namespace task {
+
+// Compressed sparse matrix. In the row-major layout (CSR) the nonzeros of
+// row i are values[offsets[i] .. offsets[i + 1]) with their column numbers
+// in the same range of indices; the column-major layout (CSC) stores
+// columns the same way. Indices within a row (column) are increasing.
+//
+// Operations accept either layout and convert when an algorithm needs the
+// other one; keep operands in CSR for SpMV and products with dense
+// matrices, which run in parallel over rows without converting.
+class SparseMatrix {
+public:
+  enum class Layout {
+    kCsr,
+    kCsc,
+  };
+
+  // All zeros.
+  explicit SparseMatrix(size_t rows = 0, size_t cols = 0, Layout layout = Layout::kCsr);
+  // Keeps the elements with absolute value greater than threshold.
+  explicit SparseMatrix(const Matrix &dense, Layout layout = Layout::kCsr, double threshold = EPS);
+
+  size_t rowCount() const {
+    return n_rows;
+  }
+  size_t colCount() const {
+    return n_cols;
+  }
+  Layout layout() const {
+    return storage_layout;
+  }
+  size_t nonZeros() const {
+    return vals.size();
+  }
+  double density() const;
+  // Bytes held by the offsets, indices and values.
+  size_t memoryBytes() const;
+
+  const std::vector<size_t> &offsets() const {
+    return starts;
+  }
+  const std::vector<size_t> &indices() const {
+    return minor;
+  }
+  const std::vector<double> &values() const {
+    return vals;
+  }
+
+  // Throws OutOfBoundsException; zero for elements that are not stored.
+  double get(size_t row, size_t col) const;
+
+  // Same matrix in the requested layout, a copy if it is already in it.
+  SparseMatrix toLayout(Layout layout) const;
+  // CSR of A is CSC of A^T, so this only relabels the arrays.
+  SparseMatrix transposed() const;
+  Matrix toDense() const;
+
+  SparseMatrix &operator*=(const double &number);
+
+private:
+  size_t majorCount() const {
+    return storage_layout == Layout::kCsr ? n_rows : n_cols;
+  }
+
+  // a op b element-wise, in the layout of a.
+  template<class Op>
+  static SparseMatrix merge(const SparseMatrix &a, const SparseMatrix &b, Op op);
+
+  friend SparseMatrix operator+(const SparseMatrix &a, const SparseMatrix &b);
+  friend SparseMatrix operator-(const SparseMatrix &a, const SparseMatrix &b);
+
+  size_t n_rows;
+  size_t n_cols;
+  Layout storage_layout;
+  std::vector<size_t> starts;
+  std::vector<size_t> minor;
+  std::vector<double> vals;
+};
+
+// Shapes are checked and SizeMismatchException thrown as for Matrix.
+// Sums keep the layout of the left operand and drop exact cancellations.
+SparseMatrix operator+(const SparseMatrix &a, const SparseMatrix &b);
+SparseMatrix operator-(const SparseMatrix &a, const SparseMatrix &b);
+SparseMatrix operator*(const SparseMatrix &a, const double &number);
+SparseMatrix operator*(const double &number, const SparseMatrix &a);
+
+// SpMV: A * x.
+std::vector<double> operator*(const SparseMatrix &a, const std::vector<double> &x);
+// SpMM with a dense operand on either side.
+Matrix operator*(const SparseMatrix &a, const Matrix &b);
+Matrix operator*(const Matrix &a, const SparseMatrix &b);
+
+} // namespace task
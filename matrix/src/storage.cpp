@@ -0,0 +1,269 @@
+#include "storage.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <mutex>
+#include <new>
+
+using namespace task;
+
+namespace {
+
+// Size classes: multiples of 64 bytes up to 4 KiB, then four classes per
+// power of two, so rounding wastes at most a quarter of a buffer.
+const size_t SMALL_LIMIT = 4096;
+const size_t SMALL_CLASSES = SMALL_LIMIT / storage::ALIGNMENT;
+const size_t CLASSES = SMALL_CLASSES + 4 * (64 - 12);
+
+// Larger buffers are not cached at all.
+const size_t MAX_CACHED_BYTES = size_t(64) << 20;
+// Bytes of each class a thread keeps before handing buffers to the pool.
+const size_t LOCAL_BYTES = size_t(1) << 20;
+
+size_t classIndex(size_t bytes) {
+  bytes = std::max(bytes, storage::ALIGNMENT);
+  if (bytes <= SMALL_LIMIT) {
+    return (bytes + storage::ALIGNMENT - 1) / storage::ALIGNMENT - 1;
+  }
+  size_t power = 63 - __builtin_clzll(bytes - 1);  // 2^power < bytes <= 2^(power + 1)
+  size_t step = size_t(1) << (power - 2);
+  size_t sub = (bytes - (size_t(1) << power) + step - 1) / step;
+  return SMALL_CLASSES + (power - 12) * 4 + (sub - 1);
+}
+
+size_t classBytes(size_t index) {
+  if (index < SMALL_CLASSES) {
+    return (index + 1) * storage::ALIGNMENT;
+  }
+  index -= SMALL_CLASSES;
+  size_t power = 12 + index / 4;
+  return (size_t(1) << power) + (index % 4 + 1) * (size_t(1) << (power - 2));
+}
+
+size_t localLimit(size_t index) {
+  return std::max<size_t>(2, std::min<size_t>(32, LOCAL_BYTES / classBytes(index)));
+}
+
+struct Stats {
+  std::atomic<size_t> requests{0};
+  std::atomic<size_t> local_hits{0};
+  std::atomic<size_t> shared_hits{0};
+  std::atomic<size_t> misses{0};
+  std::atomic<size_t> releases{0};
+};
+
+Stats stats;
+
+void count(std::atomic<size_t> &counter) {
+  counter.fetch_add(1, std::memory_order_relaxed);
+}
+
+double *systemAllocate(size_t index) {
+  void *data = std::aligned_alloc(storage::ALIGNMENT, classBytes(index));
+  if (!data) {
+    throw std::bad_alloc();
+  }
+  return static_cast<double *>(data);
+}
+
+void systemDeallocate(void *data) {
+  count(stats.releases);
+  std::free(data);
+}
+
+// Free blocks are chained through their first bytes.
+struct FreeBlock {
+  FreeBlock *next;
+};
+
+// Shared by all threads; never destroyed, so matrices outliving main()
+// can still return their buffers.
+struct SharedPool {
+  std::mutex mutex;
+  FreeBlock *heads[CLASSES] = {};
+  size_t counts[CLASSES] = {};
+};
+
+SharedPool &sharedPool() {
+  static SharedPool *pool = new SharedPool();
+  return *pool;
+}
+
+// Trivially destructible, so it stays usable while the thread's other
+// thread_local objects are being destroyed.
+struct LocalCache {
+  FreeBlock *heads[CLASSES];
+  size_t counts[CLASSES];
+  bool closed;
+};
+
+thread_local LocalCache local_cache;
+
+void flushLocal(LocalCache &cache, size_t index, size_t keep) {
+  SharedPool &pool = sharedPool();
+  std::lock_guard<std::mutex> lock(pool.mutex);
+  while (cache.counts[index] > keep) {
+    FreeBlock *block = cache.heads[index];
+    cache.heads[index] = block->next;
+    --cache.counts[index];
+    if (pool.counts[index] < 4 * localLimit(index)) {
+      block->next = pool.heads[index];
+      pool.heads[index] = block;
+      ++pool.counts[index];
+    } else {
+      systemDeallocate(block);
+    }
+  }
+}
+
+struct LocalCacheOwner {
+  ~LocalCacheOwner() {
+    for (size_t i = 0; i < CLASSES; ++i) {
+      flushLocal(local_cache, i, 0);
+    }
+    local_cache.closed = true;
+  }
+};
+
+thread_local LocalCacheOwner local_cache_owner;
+
+LocalCache *localCache() {
+  if (local_cache.closed) {
+    return nullptr;
+  }
+  (void) &local_cache_owner;  // registers the flush at thread exit
+  return &local_cache;
+}
+
+double *heapAllocate(size_t size) {
+  return systemAllocate(classIndex(size * sizeof(double)));
+}
+
+void heapDeallocate(double *data, size_t) {
+  if (data) {
+    systemDeallocate(data);
+  }
+}
+
+double *pooledAllocate(size_t size) {
+  size_t bytes = size * sizeof(double);
+  size_t index = classIndex(bytes);
+  count(stats.requests);
+  if (bytes > MAX_CACHED_BYTES) {
+    count(stats.misses);
+    return systemAllocate(index);
+  }
+
+  LocalCache *cache = localCache();
+  if (cache && cache->heads[index]) {
+    FreeBlock *block = cache->heads[index];
+    cache->heads[index] = block->next;
+    --cache->counts[index];
+    count(stats.local_hits);
+    return reinterpret_cast<double *>(block);
+  }
+
+  SharedPool &pool = sharedPool();
+  {
+    std::lock_guard<std::mutex> lock(pool.mutex);
+    if (FreeBlock *block = pool.heads[index]) {
+      pool.heads[index] = block->next;
+      --pool.counts[index];
+      count(stats.shared_hits);
+      return reinterpret_cast<double *>(block);
+    }
+  }
+  count(stats.misses);
+  return systemAllocate(index);
+}
+
+void pooledDeallocate(double *data, size_t size) {
+  if (!data) {
+    return;
+  }
+  size_t bytes = size * sizeof(double);
+  if (bytes > MAX_CACHED_BYTES) {
+    systemDeallocate(data);
+    return;
+  }
+  size_t index = classIndex(bytes);
+  FreeBlock *block = reinterpret_cast<FreeBlock *>(data);
+  LocalCache *cache = localCache();
+  if (!cache) {
+    SharedPool &pool = sharedPool();
+    std::lock_guard<std::mutex> lock(pool.mutex);
+    block->next = pool.heads[index];
+    pool.heads[index] = block;
+    ++pool.counts[index];
+    return;
+  }
+  block->next = cache->heads[index];
+  cache->heads[index] = block;
+  if (++cache->counts[index] > localLimit(index)) {
+    flushLocal(*cache, index, localLimit(index) / 2);
+  }
+}
+
+} // namespace
+
+const storage::Policy storage::HEAP = {heapAllocate, heapDeallocate};
+const storage::Policy storage::POOLED = {pooledAllocate, pooledDeallocate};
+
+namespace {
+
+// Points at HEAP, POOLED or custom_policy, so that pool threads reading it
+// while setPolicy() switches between the built-in ones see either policy
+// whole.
+std::atomic<const storage::Policy *> current_policy{&storage::POOLED};
+storage::Policy custom_policy;
+
+bool samePolicy(const storage::Policy &a, const storage::Policy &b) {
+  return a.allocate == b.allocate && a.deallocate == b.deallocate;
+}
+
+} // namespace
+
+const storage::Policy &storage::policy() {
+  return *current_policy.load(std::memory_order_acquire);
+}
+
+void storage::setPolicy(const Policy &new_policy) {
+  if (samePolicy(new_policy, HEAP)) {
+    current_policy.store(&HEAP, std::memory_order_release);
+  } else if (samePolicy(new_policy, POOLED)) {
+    current_policy.store(&POOLED, std::memory_order_release);
+  } else {
+    custom_policy = new_policy;
+    current_policy.store(&custom_policy, std::memory_order_release);
+  }
+}
+
+storage::PoolStats storage::poolStats() {
+  return {stats.requests.load(), stats.local_hits.load(), stats.shared_hits.load(),
+          stats.misses.load(), stats.releases.load()};
+}
+
+void storage::resetPoolStats() {
+  stats.requests = 0;
+  stats.local_hits = 0;
+  stats.shared_hits = 0;
+  stats.misses = 0;
+  stats.releases = 0;
+}
+
+void storage::trim() {
+  if (LocalCache *cache = localCache()) {
+    for (size_t i = 0; i < CLASSES; ++i) {
+      flushLocal(*cache, i, 0);
+    }
+  }
+  SharedPool &pool = sharedPool();
+  std::lock_guard<std::mutex> lock(pool.mutex);
+  for (size_t i = 0; i < CLASSES; ++i) {
+    while (FreeBlock *block = pool.heads[i]) {
+      pool.heads[i] = block->next;
+      systemDeallocate(block);
+    }
+    pool.counts[i] = 0;
+  }
+}
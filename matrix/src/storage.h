@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+
+namespace task {
+namespace storage {
+
+// Alignment of every matrix buffer, enough for aligned AVX-512 loads.
+const size_t ALIGNMENT = 64;
+
+// How Matrix obtains and returns element buffers. Both built-in policies
+// round requests up to the same size classes, so buffers may be released
+// through a different built-in policy than the one that allocated them
+// and switching between them is safe at any time, even while other
+// threads allocate. A custom policy must be installed before the first
+// Matrix is created and while no other thread uses matrices.
+struct Policy {
+  double *(*allocate)(size_t size);
+  void (*deallocate)(double *data, size_t size);
+};
+
+// Goes to the system allocator on every call.
+extern const Policy HEAP;
+// Recycles buffers through per-thread free lists for each size class,
+// backed by a shared pool. This is the default.
+extern const Policy POOLED;
+
+const Policy &policy();
+void setPolicy(const Policy &new_policy);
+
+struct PoolStats {
+  size_t requests;     // allocations through POOLED
+  size_t local_hits;   // served from the calling thread's cache
+  size_t shared_hits;  // served from the shared pool
+  size_t misses;       // went to the system allocator
+  size_t releases;     // buffers given back to the system allocator
+
+  double hitRate() const {
+    return requests == 0 ? 0. : static_cast<double>(local_hits + shared_hits) / requests;
+  }
+};
+
+PoolStats poolStats();
+void resetPoolStats();
+
+// Returns the buffers cached by the calling thread and the shared pool
+// to the system allocator.
+void trim();
+
+} // namespace storage
+} // namespace task
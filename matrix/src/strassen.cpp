@@ -0,0 +1,137 @@
+#include "strassen.h"
+#include "gemm.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <atomic>
+#include <vector>
+
+using namespace task;
+
+namespace {
+
+std::atomic<size_t> crossover_size{0};
+
+// Strided read-only block: element (i, j) is data[i * rs + j * cs].
+struct Block {
+  const double *data;
+  size_t rs;
+  size_t cs;
+
+  Block at(size_t row, size_t col) const {
+    return {data + row * rs + col * cs, rs, cs};
+  }
+};
+
+// Row-major block that can be written.
+struct Out {
+  double *data;
+  size_t ld;
+
+  Out at(size_t row, size_t col) const {
+    return {data + row * ld + col, ld};
+  }
+  operator Block() const {
+    return {data, ld, 1};
+  }
+};
+
+// dst = x + sign * y, elementwise over rows x cols.
+void combine(size_t rows, size_t cols, Out dst, Block x, Block y, double sign) {
+  parallel::forRange(0, rows, rows * cols, [&](size_t from, size_t to) {
+    for (size_t i = from; i < to; ++i) {
+      double *d = dst.data + i * dst.ld;
+      const double *xr = x.data + i * x.rs, *yr = y.data + i * y.rs;
+      if (x.cs == 1 && y.cs == 1) {
+        for (size_t j = 0; j < cols; ++j) {
+          d[j] = xr[j] + sign * yr[j];
+        }
+      } else {
+        for (size_t j = 0; j < cols; ++j) {
+          d[j] = xr[j * x.cs] + sign * yr[j * y.cs];
+        }
+      }
+    }
+  });
+}
+
+void add(size_t rows, size_t cols, Out dst, Block x, Block y) {
+  combine(rows, cols, dst, x, y, 1.);
+}
+
+void sub(size_t rows, size_t cols, Out dst, Block x, Block y) {
+  combine(rows, cols, dst, x, y, -1.);
+}
+
+void classical(size_t m, size_t n, size_t k, Block a, Block b, double beta, Out c) {
+  gemm::multiply(m, n, k, 1., a.data, a.rs, a.cs, b.data, b.rs, b.cs, beta, c.data, c.ld);
+}
+
+void recurse(size_t m, size_t n, size_t k, Block a, Block b, Out c, size_t limit) {
+  if (std::min({m, n, k}) < limit) {
+    classical(m, n, k, a, b, 0., c);
+    return;
+  }
+  size_t m2 = m / 2, n2 = n / 2, k2 = k / 2;
+  Block a11 = a, a12 = a.at(0, k2), a21 = a.at(m2, 0), a22 = a.at(m2, k2);
+  Block b11 = b, b12 = b.at(0, n2), b21 = b.at(k2, 0), b22 = b.at(k2, n2);
+  Out c11 = c, c12 = c.at(0, n2), c21 = c.at(m2, 0), c22 = c.at(m2, n2);
+
+  // Winograd's variant scheduled with three temporaries, as in DGEFMM
+  // (Douglas et al., 1994). Comments give the classical names.
+  std::vector<double> x_buffer(m2 * k2), y_buffer(k2 * n2), z_buffer(m2 * n2);
+  Out x{x_buffer.data(), k2}, y{y_buffer.data(), n2}, z{z_buffer.data(), n2};
+
+  sub(m2, k2, x, a11, a21);                 // S3
+  sub(k2, n2, y, b22, b12);                 // T3
+  recurse(m2, n2, k2, x, y, c21, limit);    // P7
+  add(m2, k2, x, a21, a22);                 // S1
+  sub(k2, n2, y, b12, b11);                 // T1
+  recurse(m2, n2, k2, x, y, c22, limit);    // P5
+  sub(m2, k2, x, x, a11);                   // S2
+  sub(k2, n2, y, b22, y);                   // T2
+  recurse(m2, n2, k2, x, y, c12, limit);    // P6
+  sub(m2, k2, x, a12, x);                   // S4
+  recurse(m2, n2, k2, x, b22, c11, limit);  // P3
+  recurse(m2, n2, k2, a11, b11, z, limit);  // P1
+  add(m2, n2, c12, z, c12);                 // U2 = P1 + P6
+  add(m2, n2, c21, c12, c21);               // U3 = U2 + P7
+  add(m2, n2, c12, c12, c22);               // U4 = U2 + P5
+  add(m2, n2, c22, c21, c22);               // U7 = U3 + P5 = C22
+  add(m2, n2, c12, c12, c11);               // U5 = U4 + P3 = C12
+  sub(k2, n2, y, y, b21);                   // T4
+  recurse(m2, n2, k2, a22, y, c11, limit);  // P4
+  sub(m2, n2, c21, c21, c11);               // U6 = U3 - P4 = C21
+  recurse(m2, n2, k2, a12, b21, c11, limit);  // P2
+  add(m2, n2, c11, z, c11);                 // U1 = P1 + P2 = C11
+
+  // Peeling: the even part is done, add what the odd dimensions leave.
+  if (k % 2) {
+    classical(2 * m2, 2 * n2, 1, a.at(0, k - 1), b.at(k - 1, 0), 1., c);
+  }
+  if (n % 2) {
+    classical(m, 1, k, a, b.at(0, n - 1), 0., c.at(0, n - 1));
+  }
+  if (m % 2) {
+    classical(1, 2 * n2, k, a.at(m - 1, 0), b, 0., c.at(m - 1, 0));
+  }
+}
+
+} // namespace
+
+void strassen::setCrossover(size_t size) {
+  crossover_size = size;
+}
+
+size_t strassen::crossover() {
+  return crossover_size;
+}
+
+void strassen::multiply(size_t m, size_t n, size_t k,
+                        const double *a, size_t a_row_stride, size_t a_col_stride,
+                        const double *b, size_t b_row_stride, size_t b_col_stride,
+                        double *c, size_t ldc) {
+  size_t limit = crossover();
+  // Splitting needs halves of at least one element.
+  limit = limit == 0 ? static_cast<size_t>(-1) : std::max<size_t>(limit, 2);
+  recurse(m, n, k, {a, a_row_stride, a_col_stride}, {b, b_row_stride, b_col_stride}, {c, ldc}, limit);
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstddef>
+
+namespace task {
+namespace strassen {
+
+// Products whose smallest dimension is at least the crossover are split
+// recursively with Strassen-Winograd (7 half-size products instead of 8)
+// until the blocks drop below it, then finished by gemm::multiply. 0, the
+// default, turns the mode off so that products are always classical.
+//
+// Each level trades one eighth of the multiplications for 15 block
+// additions and a somewhat larger rounding error (see bench/strassen.cpp
+// for measurements), so it pays off only for large products; the
+// crossover is where the blocked kernel stops gaining from cache reuse.
+void setCrossover(size_t size);
+size_t crossover();
+
+// C = A * B, with operands addressed like in gemm::multiply. Odd
+// dimensions are peeled: the even part recurses and the remaining row,
+// column or rank-one update is done by the blocked kernel.
+void multiply(size_t m, size_t n, size_t k,
+              const double *a, size_t a_row_stride, size_t a_col_stride,
+              const double *b, size_t b_row_stride, size_t b_col_stride,
+              double *c, size_t ldc);
+
+} // namespace strassen
+} // namespace task
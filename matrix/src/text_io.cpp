@@ -0,0 +1,238 @@
+#include "matrix.h"
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cmath>
+#include <locale>
+#include <memory>
+#include <string>
+
+using namespace task;
+
+namespace {
+
+// Longest number token accepted by operator>>.
+const size_t MAX_TOKEN = 128;
+
+bool isSpace(int c) {
+  return c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+// Splits the stream into whitespace-separated tokens. Characters are taken
+// straight from the stream buffer, which refills itself in large blocks;
+// the parser never reads past the end of the last token it returns, so
+// whatever follows a matrix is left for the next extraction.
+class TokenReader {
+public:
+  explicit TokenReader(std::streambuf *buffer) : buffer(buffer), at_eof(false) {}
+
+  bool read(size_t &value) {
+    size_t length;
+    if (!next(length)) {
+      return false;
+    }
+    auto result = std::from_chars(token, token + length, value);
+    return result.ec == std::errc() && result.ptr == token + length;
+  }
+
+  bool read(double &value) {
+    size_t length;
+    if (!next(length)) {
+      return false;
+    }
+    // from_chars does not take the leading plus that operator>> accepts.
+    const char *begin = token;
+    if (length > 1 && token[0] == '+' && token[1] != '-' && token[1] != '+') {
+      ++begin;
+    }
+    auto result = std::from_chars(begin, token + length, value);
+    return result.ec == std::errc() && result.ptr == token + length;
+  }
+
+  bool eof() const {
+    return at_eof;
+  }
+
+private:
+  bool next(size_t &length) {
+    using Traits = std::streambuf::traits_type;
+    int c = buffer->sgetc();
+    while (c != Traits::eof() && isSpace(c)) {
+      c = buffer->snextc();
+    }
+    length = 0;
+    while (c != Traits::eof() && !isSpace(c)) {
+      if (length == MAX_TOKEN) {
+        return false;
+      }
+      token[length++] = Traits::to_char_type(c);
+      c = buffer->snextc();
+    }
+    at_eof = c == Traits::eof();
+    return length > 0;
+  }
+
+  std::streambuf *buffer;
+  bool at_eof;
+  char token[MAX_TOKEN];
+};
+
+// Formats numbers the way operator<<(double) does for the classic locale,
+// but with to_chars, and writes them through the stream buffer in blocks.
+class NumberWriter {
+public:
+  explicit NumberWriter(std::ostream &output) : output(output), used(0), failed(false) {
+    std::ios_base::fmtflags flags = output.flags();
+    std::ios_base::fmtflags floatfield = flags & std::ios_base::floatfield;
+    precision = static_cast<int>(output.precision());
+    hex = floatfield == (std::ios_base::fixed | std::ios_base::scientific);
+    if (hex) {
+      format = std::chars_format::hex;
+    } else if (floatfield == std::ios_base::fixed) {
+      format = std::chars_format::fixed;
+    } else if (floatfield == std::ios_base::scientific) {
+      format = std::chars_format::scientific;
+    } else {
+      format = std::chars_format::general;
+    }
+    show_pos = flags & std::ios_base::showpos;
+    uppercase = flags & std::ios_base::uppercase;
+  }
+
+  // The formatting to_chars cannot reproduce: padding, forced decimal
+  // points and locale-specific punctuation.
+  static bool supports(const std::ostream &output) {
+    return output.width() == 0 && !(output.flags() & std::ios_base::showpoint) &&
+           output.getloc() == std::locale::classic();
+  }
+
+  void write(double value) {
+    if (BLOCK - used < MAX_NUMBER) {
+      flush();
+    }
+    char *begin = block + used, *end = block + BLOCK;
+    char *cursor = begin;
+    double magnitude = value;
+    if (std::signbit(value)) {
+      *cursor++ = '-';
+      magnitude = -value;
+    } else if (show_pos) {
+      *cursor++ = '+';
+    }
+    if (hex && std::isfinite(value)) {
+      *cursor++ = '0';
+      *cursor++ = 'x';
+    }
+    auto result = hex ? std::to_chars(cursor, end, magnitude, format)
+                      : std::to_chars(cursor, end, magnitude, format, precision);
+    if (result.ec != std::errc()) {
+      // Does not fit in a block; only with huge fixed precisions.
+      flush();
+      output << value;
+      return;
+    }
+    if (uppercase) {
+      std::transform(begin, result.ptr, begin, [](char c) { return std::toupper(c); });
+    }
+    used = result.ptr - block;
+  }
+
+  void put(char c) {
+    if (used == BLOCK) {
+      flush();
+    }
+    block[used++] = c;
+  }
+
+  void flush() {
+    if (used > 0 && output.rdbuf()->sputn(block, used) != static_cast<std::streamsize>(used)) {
+      failed = true;
+    }
+    used = 0;
+  }
+
+  bool fail() const {
+    return failed;
+  }
+
+private:
+  static const size_t BLOCK = 1 << 16;
+  static const size_t MAX_NUMBER = 1024;
+
+  std::ostream &output;
+  std::chars_format format;
+  int precision;
+  bool hex;
+  bool show_pos;
+  bool uppercase;
+  size_t used;
+  bool failed;
+  char block[BLOCK];
+};
+
+} // namespace
+
+std::ostream &task::operator<<(std::ostream &output, const Matrix &matrix) {
+  if (!NumberWriter::supports(output)) {
+    for (size_t i = 0; i < matrix.n_rows; ++i) {
+      for (size_t j = 0; j < matrix.n_cols; ++j) {
+        output << matrix.at(i, j) << " ";
+      }
+      output << std::endl;
+    }
+    return output;
+  }
+  std::ostream::sentry sentry(output);
+  if (!sentry) {
+    return output;
+  }
+  auto writer = std::make_unique<NumberWriter>(output);
+  const double *value = matrix.vals;
+  for (size_t i = 0; i < matrix.n_rows; ++i) {
+    for (size_t j = 0; j < matrix.n_cols; ++j) {
+      writer->write(*value++);
+      writer->put(' ');
+    }
+    writer->put('\n');
+  }
+  writer->flush();
+  if (writer->fail()) {
+    output.setstate(std::ios_base::badbit);
+  }
+  // Rows used to end with std::endl; flush once at the end instead.
+  output.flush();
+  return output;
+}
+
+std::istream &task::operator>>(std::istream &input, Matrix &matrix) {
+  std::istream::sentry sentry(input);
+  if (!sentry) {
+    return input;
+  }
+  TokenReader reader(input.rdbuf());
+  size_t rows, cols;
+  if (!reader.read(rows) || !reader.read(cols)) {
+    input.setstate(reader.eof() ? std::ios_base::failbit | std::ios_base::eofbit : std::ios_base::failbit);
+    return input;
+  }
+  if (!fitsElements(rows, cols)) {
+    input.setstate(std::ios_base::failbit);
+    return input;
+  }
+  if (rows != matrix.n_rows || cols != matrix.n_cols) {
+    matrix = Matrix(rows, cols, Matrix::Uninitialized());
+  }
+  matrix.invalidate();
+  size_t size = rows * cols;
+  for (size_t i = 0; i < size; ++i) {
+    if (!reader.read(matrix.vals[i])) {
+      std::fill(matrix.vals + i, matrix.vals + size, 0.);
+      input.setstate(std::ios_base::failbit);
+      break;
+    }
+  }
+  if (reader.eof()) {
+    input.setstate(std::ios_base::eofbit);
+  }
+  return input;
+}
@@ -0,0 +1,186 @@
+#include "thread_pool.h"
+#include <algorithm>
+
+using namespace task;
+
+namespace {
+
+thread_local bool inside_chunk = false;
+
+size_t defaultThreadCount() {
+  return std::max<size_t>(1, std::thread::hardware_concurrency());
+}
+
+struct PoolState {
+  std::mutex mutex;
+  std::unique_ptr<ThreadPool> pool;
+  size_t threads = defaultThreadCount();
+  // Read by every forRange() call, so it can change while they run.
+  std::atomic<size_t> threshold{1 << 15};
+};
+
+PoolState &state() {
+  static PoolState pool_state;
+  return pool_state;
+}
+
+ThreadPool &sharedPool() {
+  PoolState &pool_state = state();
+  std::lock_guard<std::mutex> lock(pool_state.mutex);
+  if (!pool_state.pool) {
+    pool_state.pool.reset(new ThreadPool(pool_state.threads));
+  }
+  return *pool_state.pool;
+}
+
+} // namespace
+
+ThreadPool::ThreadPool(size_t threads) : pending(0), stopping(false) {
+  size_t worker_count = threads > 1 ? threads - 1 : 0;
+  for (size_t i = 0; i < worker_count; ++i) {
+    queues.emplace_back(new Queue());
+  }
+  for (size_t i = 0; i < worker_count; ++i) {
+    workers.emplace_back(&ThreadPool::workerLoop, this, i);
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(sleep_mutex);
+    stopping = true;
+  }
+  wake.notify_all();
+  for (auto &worker : workers) {
+    worker.join();
+  }
+}
+
+size_t ThreadPool::size() const {
+  return workers.size() + 1;
+}
+
+void ThreadPool::parallelFor(size_t begin, size_t end, size_t grain, const RangeFunction &body) {
+  if (begin >= end) {
+    return;
+  }
+  grain = std::max<size_t>(grain, 1);
+  if (workers.empty() || inside_chunk || end - begin <= grain) {
+    body(begin, end);
+    return;
+  }
+
+  Batch batch;
+  batch.body = &body;
+  size_t chunk_count = (end - begin + grain - 1) / grain;
+  batch.remaining = chunk_count;
+
+  {
+    std::lock_guard<std::mutex> lock(sleep_mutex);
+    pending += chunk_count;
+  }
+  for (size_t i = 0; i < chunk_count; ++i) {
+    size_t from = begin + i * grain;
+    Queue &queue = *queues[i % queues.size()];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    queue.chunks.push_back({&batch, from, std::min(end, from + grain)});
+  }
+  wake.notify_all();
+
+  Chunk chunk;
+  while (batch.remaining.load() > 0) {
+    if (steal(queues.size(), chunk)) {
+      execute(chunk);
+    } else {
+      std::unique_lock<std::mutex> lock(batch.mutex);
+      batch.done.wait(lock, [&batch] { return batch.remaining.load() == 0; });
+    }
+  }
+  // The last chunk may still hold the mutex while notifying.
+  std::lock_guard<std::mutex> lock(batch.mutex);
+}
+
+void ThreadPool::workerLoop(size_t index) {
+  Chunk chunk;
+  while (true) {
+    if (pop(index, chunk) || steal(index, chunk)) {
+      execute(chunk);
+      continue;
+    }
+    std::unique_lock<std::mutex> lock(sleep_mutex);
+    wake.wait(lock, [this] { return stopping || pending.load() > 0; });
+    if (stopping && pending.load() == 0) {
+      return;
+    }
+  }
+}
+
+bool ThreadPool::pop(size_t index, Chunk &chunk) {
+  Queue &queue = *queues[index];
+  std::lock_guard<std::mutex> lock(queue.mutex);
+  if (queue.chunks.empty()) {
+    return false;
+  }
+  chunk = queue.chunks.back();
+  queue.chunks.pop_back();
+  --pending;
+  return true;
+}
+
+bool ThreadPool::steal(size_t thief, Chunk &chunk) {
+  for (size_t i = 1; i <= queues.size(); ++i) {
+    Queue &queue = *queues[(thief + i) % queues.size()];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (!queue.chunks.empty()) {
+      chunk = queue.chunks.front();
+      queue.chunks.pop_front();
+      --pending;
+      return true;
+    }
+  }
+  return false;
+}
+
+void ThreadPool::execute(const Chunk &chunk) {
+  inside_chunk = true;
+  (*chunk.batch->body)(chunk.begin, chunk.end);
+  inside_chunk = false;
+  Batch *batch = chunk.batch;
+  std::lock_guard<std::mutex> lock(batch->mutex);
+  if (--batch->remaining == 0) {
+    batch->done.notify_all();
+  }
+}
+
+void parallel::setThreadCount(size_t threads) {
+  PoolState &pool_state = state();
+  size_t count = threads == 0 ? defaultThreadCount() : threads;
+  std::lock_guard<std::mutex> lock(pool_state.mutex);
+  if (count != pool_state.threads) {
+    pool_state.pool.reset();
+    pool_state.threads = count;
+  }
+}
+
+size_t parallel::threadCount() {
+  return state().threads;
+}
+
+void parallel::setThreshold(size_t elements) {
+  state().threshold.store(elements, std::memory_order_relaxed);
+}
+
+size_t parallel::threshold() {
+  return state().threshold.load(std::memory_order_relaxed);
+}
+
+void parallel::forRange(size_t begin, size_t end, size_t work, const ThreadPool::RangeFunction &body) {
+  size_t threads = threadCount();
+  if (threads == 1 || work < threshold() || inside_chunk) {
+    body(begin, end);
+    return;
+  }
+  // A few chunks per thread so that stealing can even out the load.
+  size_t chunks = threads * 4;
+  sharedPool().parallelFor(begin, end, (end - begin + chunks - 1) / chunks, body);
+}
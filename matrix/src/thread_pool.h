@@ -0,0 +1,89 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace task {
+
+// Fixed set of workers, each with its own task deque. A worker pops from
+// the back of its deque and, when it runs dry, steals from the front of
+// the others. The thread calling parallelFor works on the batch too.
+class ThreadPool {
+public:
+  using RangeFunction = std::function<void(size_t, size_t)>;
+
+  // Starts threads - 1 workers; the caller is the last thread.
+  explicit ThreadPool(size_t threads);
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  size_t size() const;
+
+  // Calls body(from, to) for consecutive chunks of at most grain elements
+  // covering [begin, end) and waits for all of them. body must not throw.
+  // Calls made from inside a running chunk are executed inline.
+  void parallelFor(size_t begin, size_t end, size_t grain, const RangeFunction &body);
+
+private:
+  struct Batch {
+    const RangeFunction *body;
+    std::atomic<size_t> remaining;
+    std::mutex mutex;
+    std::condition_variable done;
+  };
+
+  struct Chunk {
+    Batch *batch;
+    size_t begin;
+    size_t end;
+  };
+
+  struct Queue {
+    std::mutex mutex;
+    std::deque<Chunk> chunks;
+  };
+
+  void workerLoop(size_t index);
+  bool pop(size_t index, Chunk &chunk);
+  bool steal(size_t thief, Chunk &chunk);
+  void execute(const Chunk &chunk);
+
+  std::vector<std::unique_ptr<Queue>> queues;
+  std::vector<std::thread> workers;
+
+  std::mutex sleep_mutex;
+  std::condition_variable wake;
+  std::atomic<size_t> pending;
+  bool stopping;
+};
+
+namespace parallel {
+
+// Number of threads used by matrix operations, 1 disables threading.
+// Defaults to std::thread::hardware_concurrency(); 0 restores the default.
+// Must not be called while matrix operations run on other threads.
+void setThreadCount(size_t threads);
+size_t threadCount();
+
+// Matrices with fewer elements than this are processed on the calling
+// thread only. May be changed while matrix operations run; calls already
+// past the check keep their choice.
+void setThreshold(size_t elements);
+size_t threshold();
+
+// Runs body over [begin, end) on the shared pool if work, the number of
+// matrix elements touched, reaches threshold(); otherwise calls
+// body(begin, end) directly.
+void forRange(size_t begin, size_t end, size_t work, const ThreadPool::RangeFunction &body);
+
+} // namespace parallel
+} // namespace task
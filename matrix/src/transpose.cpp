@@ -0,0 +1,77 @@
+#include "transpose.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <vector>
+
+using namespace task;
+
+namespace {
+
+void transposeTile(size_t rows, size_t cols, const double *src, size_t lds, double *dst, size_t ldd) {
+  for (size_t i = 0; i < rows; ++i) {
+    for (size_t j = 0; j < cols; ++j) {
+      dst[j * ldd + i] = src[i * lds + j];
+    }
+  }
+}
+
+// Transposes the tile at (i0, j0) with the one at (j0, i0) of an n x n matrix.
+void swapTiles(size_t n, size_t i0, size_t j0, double *data) {
+  size_t i1 = std::min(n, i0 + transposition::TILE), j1 = std::min(n, j0 + transposition::TILE);
+  for (size_t i = i0; i < i1; ++i) {
+    for (size_t j = i0 == j0 ? i + 1 : j0; j < j1; ++j) {
+      std::swap(data[i * n + j], data[j * n + i]);
+    }
+  }
+}
+
+void inPlaceSquare(size_t n, double *data) {
+  size_t tiles = (n + transposition::TILE - 1) / transposition::TILE;
+  parallel::forRange(0, tiles, n * n, [&](size_t from, size_t to) {
+    for (size_t bi = from; bi < to; ++bi) {
+      for (size_t bj = bi; bj < tiles; ++bj) {
+        swapTiles(n, bi * transposition::TILE, bj * transposition::TILE, data);
+      }
+    }
+  });
+}
+
+void inPlaceCycles(size_t rows, size_t cols, double *data) {
+  size_t last = rows * cols - 1;
+  std::vector<bool> visited(last + 1);
+  // The first and the last elements never move.
+  for (size_t start = 1; start < last; ++start) {
+    if (visited[start]) {
+      continue;
+    }
+    double carried = data[start];
+    size_t k = start;
+    do {
+      size_t next = k * rows % last;
+      std::swap(carried, data[next]);
+      visited[next] = true;
+      k = next;
+    } while (k != start);
+  }
+}
+
+} // namespace
+
+void transposition::outOfPlace(size_t rows, size_t cols, const double *src, size_t lds, double *dst, size_t ldd) {
+  parallel::forRange(0, (rows + TILE - 1) / TILE, rows * cols, [&](size_t from, size_t to) {
+    for (size_t i = from * TILE; i < std::min(rows, to * TILE); i += TILE) {
+      size_t tile_rows = std::min(TILE, rows - i);
+      for (size_t j = 0; j < cols; j += TILE) {
+        transposeTile(tile_rows, std::min(TILE, cols - j), src + i * lds + j, lds, dst + j * ldd + i, ldd);
+      }
+    }
+  });
+}
+
+void transposition::inPlace(size_t rows, size_t cols, double *data) {
+  if (rows == cols) {
+    inPlaceSquare(rows, data);
+  } else if (rows > 1 && cols > 1) {
+    inPlaceCycles(rows, cols, data);
+  }
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstddef>
+
+// Side of the square tiles the transpose kernels work on; 32 x 32 doubles
+// of source and destination fit in L1 together.
+#ifndef TASK_TRANSPOSE_TILE
+#define TASK_TRANSPOSE_TILE 32
+#endif
+
+namespace task {
+namespace transposition {
+
+const size_t TILE = TASK_TRANSPOSE_TILE;
+
+// dst (cols x rows, leading dimension ldd) = transposed src (rows x cols,
+// leading dimension lds). The buffers must not overlap.
+void outOfPlace(size_t rows, size_t cols, const double *src, size_t lds, double *dst, size_t ldd);
+
+// Transposes a contiguous row-major rows x cols matrix in its own buffer.
+// Square matrices swap tiles across the diagonal; other shapes follow the
+// permutation cycles k -> k * rows mod (rows * cols - 1), keeping one bit
+// per element to mark visited positions.
+void inPlace(size_t rows, size_t cols, double *data);
+
+} // namespace transposition
+} // namespace task
@@ -2,13 +2,35 @@
 #include <string>
 #include <random>
 #include <algorithm>
+#include <atomic>
 #include <sstream>
+#include <fstream>
+#include <system_error>
 #include <cmath>
+#include <limits>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <cstdio>
+#include <thread>
+#include "src/basic_matrix.h"
+#include "src/blas2.h"
+#include "src/binary_io.h"
+#include "src/fixed_matrix.h"
 #include "src/matrix.h"
+#include "src/matrix_batch.h"
+#include "src/sparse_matrix.h"
+#include "src/simd.h"
+#include "src/storage.h"
+#include "src/strassen.h"
+#include "src/thread_pool.h"
 
 
 using task::Matrix;
 
+// The OutOfBoundsException checks below need checked element access.
+static_assert(TASK_BOUNDS_CHECK, "build the tests with TASK_BOUNDS_CHECK=1");
+
 
 size_t RandomUInt(size_t max = -1) {
     static std::mt19937 rand(std::random_device{}());
@@ -65,6 +87,146 @@ void FailWithMsg(const std::string& msg, int line) {
 #define REPEAT(count) for (size_t _iter = 0; _iter < (count); ++_iter)
 
 
+Matrix RandomSparseMatrix(size_t rows, size_t cols, double density) {
+    Matrix temp(rows, cols);
+    for (size_t row = 0; row < rows; ++row) {
+        for (size_t col = 0; col < cols; ++col) {
+            temp[row][col] = RandomUInt(999) < density * 1000 ? RandomDouble() : 0.;
+        }
+    }
+    return temp;
+}
+
+std::vector<double> RandomVector(size_t size) {
+    std::vector<double> temp(size);
+    for (auto& value : temp) {
+        value = RandomDouble();
+    }
+    return temp;
+}
+
+// Largest element-wise difference, relative to the magnitude of b.
+double MaxDifference(const std::vector<double>& a, const std::vector<double>& b) {
+    double difference = 0.;
+    for (size_t i = 0; i < a.size(); ++i) {
+        difference = std::max(difference, std::fabs(a[i] - b[i]) / std::max(1., std::fabs(b[i])));
+    }
+    return difference;
+}
+
+// Hands out a string like a pipe: reads work, seeks do not.
+class PipeBuffer : public std::streambuf {
+public:
+    explicit PipeBuffer(std::string contents) : data(std::move(contents)) {
+        setg(&data[0], &data[0], &data[0] + data.size());
+    }
+
+private:
+    std::string data;
+};
+
+Matrix RandomIntegerMatrix(size_t rows, size_t cols) {
+    Matrix temp(rows, cols);
+    for (size_t row = 0; row < rows; ++row) {
+        for (size_t col = 0; col < cols; ++col) {
+            temp[row][col] = static_cast<double>(RandomUInt(20)) - 10.;
+        }
+    }
+    return temp;
+}
+
+// Largest difference from the reference, relative to its magnitude.
+template<class T>
+double MaxError(const task::BasicMatrix<T> &result, const Matrix &reference) {
+    double error = 0.;
+    for (size_t row = 0; row < reference.rowCount(); ++row) {
+        for (size_t col = 0; col < reference.colCount(); ++col) {
+            double expected = reference(row, col);
+            double difference = std::fabs(static_cast<double>(result(row, col)) - expected);
+            error = std::max(error, difference / std::max(1., std::fabs(expected)));
+        }
+    }
+    return error;
+}
+
+// Checks BasicMatrix<T> against Matrix run on the same (converted) values.
+// Integer types get integer entries and must match exactly; the others
+// get entries scaled into range and must stay within tolerance.
+template<class T>
+void CheckElementType(const std::string &name, double scale, size_t max_size, double tolerance) {
+    using Typed = task::BasicMatrix<T>;
+    std::string msg = "BasicMatrix<" + name + "> ";
+    auto random = [&](size_t rows, size_t cols) {
+        Matrix values = std::is_integral<T>::value ? RandomIntegerMatrix(rows, cols) : Matrix(RandomMatrix(rows, cols) * scale);
+        return Typed(values);
+    };
+    REPEAT(20)
+    {
+        size_t n = RandomUInt(1, max_size), k = RandomUInt(1, 3 * max_size), m = RandomUInt(1, max_size);
+        Typed a = random(n, k), b = random(n, k), c = random(k, m), square = random(n, n);
+        Matrix a_ref = a.toMatrix(), b_ref = b.toMatrix(), c_ref = c.toMatrix(), square_ref = square.toMatrix();
+
+        ASSERT_TRUE_MSG(MaxError(a + b, a_ref + b_ref) <= tolerance, msg + "+")
+        ASSERT_TRUE_MSG(MaxError(a - b, a_ref - b_ref) <= tolerance, msg + "-")
+        ASSERT_TRUE_MSG(MaxError(-a, -a_ref) == 0., msg + "unary -")
+        ASSERT_TRUE_MSG(MaxError(a * T(3), a_ref * 3.) <= tolerance, msg + "* scalar")
+        ASSERT_TRUE_MSG(MaxError(a * c, a_ref * c_ref) <= tolerance * k, msg + "*")
+        ASSERT_TRUE_MSG(MaxError(a.transposed(), a_ref.transposed()) == 0., msg + "transposed()")
+        ASSERT_TRUE_MSG(Typed(a_ref + b_ref) == a + b, msg + "==")
+        ASSERT_TRUE_MSG(a + b != a + b + Typed(n, k), msg + "!=")
+
+        double trace = static_cast<double>(square.trace());
+        ASSERT_TRUE_MSG(std::fabs(trace - square_ref.trace()) <= tolerance * n * std::max(1., std::fabs(trace)), msg + "trace()")
+        double expected = square_ref.det();
+        if (std::is_integral<T>::value) {
+            // Exact while it fits T, which 8 x 8 with entries up to 10 need not.
+            double exact = std::round(expected);
+            if (std::fabs(exact) <= static_cast<double>(std::numeric_limits<T>::max())) {
+                ASSERT_TRUE_MSG(square.det() == static_cast<T>(exact), msg + "det()")
+            } else {
+                ASSERT_EXCEPTION_MSG(square.det(), task::OverflowException, msg + "det() out of range")
+            }
+        } else {
+            double det = static_cast<double>(square.det());
+            // Relative to Hadamard's bound, which scales like the rounding error.
+            double bound = 1.;
+            for (size_t row = 0; row < n; ++row) {
+                double norm = 0.;
+                for (size_t col = 0; col < n; ++col) {
+                    norm += square_ref(row, col) * square_ref(row, col);
+                }
+                bound *= std::max(1., std::sqrt(norm));
+            }
+            ASSERT_TRUE_MSG(std::fabs(det - expected) <= tolerance * n * bound, msg + "det()")
+        }
+    }
+}
+
+template<size_t N>
+void CheckFixedSquare() {
+    std::string msg = "FixedMatrix<" + std::to_string(N) + ", " + std::to_string(N) + "> ";
+    REPEAT(50)
+    {
+        Matrix mat1 = RandomMatrix(N, N), mat2 = RandomMatrix(N, N);
+        task::FixedMatrix<N, N> fixed1(mat1), fixed2(mat2);
+        double scalar = RandomDouble();
+
+        ASSERT_TRUE_MSG(fixed1 == mat1, msg + "from Matrix")
+        ASSERT_TRUE_MSG(Matrix(fixed1 * fixed2) == mat1 * mat2, msg + "*")
+        ASSERT_TRUE_MSG(Matrix(fixed1 + fixed2) == mat1 + mat2, msg + "+")
+        ASSERT_TRUE_MSG(Matrix(fixed1 - fixed2) == mat1 - mat2, msg + "-")
+        ASSERT_TRUE_MSG(Matrix(-fixed1 * scalar) == -mat1 * scalar, msg + "scalar")
+        ASSERT_TRUE_MSG(std::fabs(fixed1.det() - mat1.det()) < 1e-6 * std::max(1., std::fabs(mat1.det())), msg + "det()")
+        ASSERT_TRUE_MSG(std::fabs(fixed1.trace() - mat1.trace()) < task::EPS, msg + "trace()")
+        ASSERT_TRUE_MSG(fixed1.transposed() == mat1.transposed(), msg + "transposed()")
+        fixed1.transpose();
+        ASSERT_TRUE_MSG(fixed1 == mat1.transposed(), msg + "transpose()")
+        fixed1 *= fixed2;
+        ASSERT_TRUE_MSG(fixed1 == mat1.transposed() * mat2, msg + "*=")
+    }
+}
+
+
 const double EPS = 1e-6;
 
 
@@ -118,6 +280,13 @@ int main(int argc, char** argv) {
 
         ASSERT_TRUE_MSG(mat[0][0] == 1. && mat[0][1] == 0. && mat[1][0] == 0. && mat[1][1] == 0., "resize()")
 
+        ASSERT_EXCEPTION_MSG(mat[2], task::OutOfBoundsException, "Operator [] bounds")
+        ASSERT_EXCEPTION_MSG(mat.get<task::bounds::Checked>(0, 2), task::OutOfBoundsException, "Checked get()")
+        ASSERT_TRUE_MSG(&mat.get<task::bounds::Unchecked>(1, 1) == &mat(1, 1), "Unchecked get()")
+        mat.set<task::bounds::Unchecked>(1, 0, 5.);
+        ASSERT_TRUE_MSG(mat(1, 0) == 5. && mat.get(1, 0) == 5., "Unchecked set()")
+        mat(1, 0) = 0.;
+
         /*
         REPEAT(1000) {
             // oh boy i sure can't wait to resize
@@ -208,6 +377,1008 @@ int main(int argc, char** argv) {
     }
 
 
+    REPEAT(20)
+    {
+        auto rows = RandomUInt(1, 50), cols = RandomUInt(1, 50);
+        auto a = RandomMatrix(rows, cols), b = RandomMatrix(rows, cols), c = RandomMatrix(rows, cols);
+        auto d = RandomMatrix(cols, RandomUInt(1, 50));
+
+        Matrix expected = a;
+        expected += b;
+        Matrix scaled_c = c;
+        scaled_c *= 2.;
+        expected -= scaled_c;
+
+        Matrix res = a + b - 2. * c;
+        ASSERT_TRUE_MSG(res == expected, "Expression a + b - 2 * c")
+        ASSERT_TRUE_MSG(a + b - c * 2 == expected, "Expression comparison")
+
+        res = a;
+        res = b + res - 2. * c;
+        ASSERT_TRUE_MSG(res == expected, "Expression aliasing the target")
+
+        expected = a;
+        expected += b;
+        ASSERT_TRUE_MSG((a + b) * d == expected * d, "Expression times matrix")
+        ASSERT_TRUE_MSG(-(a - b) == b - a, "Negated expression")
+
+        auto e = RandomMatrix(rows + 1, cols);
+        ASSERT_EXCEPTION_MSG(a + b - e, task::SizeMismatchException, "Expression exceptions")
+    }
+
+
+    {
+        auto a = RandomMatrix(30, 20), b = RandomMatrix(30, 20), c = RandomMatrix(30, 20);
+        auto d = RandomMatrix(20, 30);
+        Matrix res(30, 20), square(30, 30);
+
+        size_t before = task::allocationCount();
+        res = a + b - 2. * c;
+        res = -a;
+        res = b;
+        res += a - c;
+        ASSERT_TRUE_MSG(task::allocationCount() == before, "Same-shape assignment must not allocate")
+
+        before = task::allocationCount();
+        Matrix fresh = a + b - 2. * c;
+        ASSERT_TRUE_MSG(task::allocationCount() == before + 1, "Expression construction allocates once")
+
+        before = task::allocationCount();
+        square = a * d;
+        square *= square;
+        ASSERT_TRUE_MSG(task::allocationCount() == before + 2, "Products allocate only their result")
+
+        before = task::allocationCount();
+        Matrix moved = std::move(fresh);
+        fresh = std::move(moved);
+        res = d.transposed();
+        ASSERT_TRUE_MSG(task::allocationCount() == before + 1, "Moves must not allocate")
+        ASSERT_TRUE_MSG(fresh == a + b - 2. * c, "Move constructor / assignment")
+        ASSERT_TRUE_MSG(res == d.transposed(), "Move assignment")
+    }
+
+
+    {
+        auto a = RandomMatrix(150, 130), b = RandomMatrix(150, 130), c = RandomMatrix(130, 170);
+        auto sq = RandomMatrix(40, 40);
+
+        task::parallel::setThreadCount(1);
+        Matrix sum = a + b, diff = a, scaled = a, prod = a * c, trans = a.transposed(), neg = -a;
+        diff -= b;
+        scaled *= 3.;
+        double det = sq.det();
+
+        task::parallel::setThreadCount(4);
+        task::parallel::setThreshold(0);
+        Matrix res = a;
+        res += b;
+        ASSERT_TRUE_MSG(res == sum && a + b == sum, "Parallel +")
+        res = a;
+        res -= b;
+        ASSERT_TRUE_MSG(res == diff, "Parallel -")
+        res = a;
+        res *= 3.;
+        ASSERT_TRUE_MSG(res == scaled, "Parallel scalar *")
+        ASSERT_TRUE_MSG(a * c == prod, "Parallel matrix *")
+        ASSERT_TRUE_MSG(a.transposed() == trans, "Parallel transposed()")
+        res = a;
+        res.transpose();
+        ASSERT_TRUE_MSG(res == trans, "Parallel transpose()")
+        res = -a;
+        ASSERT_TRUE_MSG(res == neg, "Parallel unary -")
+        ASSERT_TRUE_MSG(fabs(sq.det() - det) < EPS * fabs(det), "Parallel det()")
+
+        task::parallel::setThreadCount(0);
+        task::parallel::setThreshold(1 << 15);
+    }
+
+
+    REPEAT(20)
+    {
+        size_t n = RandomUInt(1, 150);
+        auto a = RandomMatrix(n, n), b = RandomMatrix(n, RandomUInt(1, 20));
+        auto lu = a.lu();
+        ASSERT_TRUE_MSG(lu.permutationMatrix() * a == lu.lower() * lu.upper(), "lu(): P * A == L * U")
+
+        auto x = a.solve(b);
+        Matrix residual = a * x - b;
+        double max_residual = 0.;
+        for (size_t i = 0; i < n; ++i) {
+            for (size_t j = 0; j < b.cols(); ++j) {
+                max_residual = std::max(max_residual, fabs(residual[i][j]));
+            }
+        }
+        ASSERT_TRUE_MSG(max_residual < 1e-8, "solve()")
+        ASSERT_TRUE_MSG(a * a.inverse() == Matrix(n, n), "inverse()")
+        ASSERT_EXCEPTION_MSG(a.solve(RandomMatrix(n + 1, 1)), task::SizeMismatchException, "solve() exceptions")
+    }
+    {
+        Matrix singular(3, 3);
+        singular[2][2] = 0.;
+        ASSERT_TRUE_MSG(singular.det() == 0., "det() of a singular matrix")
+        ASSERT_EXCEPTION_MSG(singular.inverse(), task::SingularMatrixException, "inverse() exceptions")
+        ASSERT_EXCEPTION_MSG(RandomMatrix(2, 3).lu(), task::SizeMismatchException, "lu() exceptions")
+    }
+
+
+    REPEAT(50)
+    {
+        auto rows = RandomUInt(1, 120), cols = RandomUInt(1, 120);
+        auto mat = RandomMatrix(rows, cols);
+        auto res = mat.transposed();
+        bool ok = true;
+        for (size_t i = 0; i < rows; ++i) {
+            for (size_t j = 0; j < cols; ++j) {
+                ok = ok && res[j][i] == mat[i][j];
+            }
+        }
+        ASSERT_TRUE_MSG(ok, "transposed()")
+        mat.transpose();
+        ASSERT_TRUE_MSG(mat.rows() == cols && mat.cols() == rows && mat == res, "transpose() in place")
+    }
+
+
+    REPEAT(20)
+    {
+        auto rows = RandomUInt(2, 80), cols = RandomUInt(2, 80);
+        auto mat = RandomMatrix(rows, cols);
+        const Matrix& mat_c = mat;
+
+        size_t r = RandomUInt(0, rows - 1), c = RandomUInt(0, cols - 1);
+        auto row = mat.row(r);
+        auto column = mat_c.column(c);
+        ASSERT_TRUE_MSG(row.rowCount() == 1 && row.colCount() == cols, "row() view")
+        ASSERT_TRUE_MSG(column.rowCount() == rows && column.colCount() == 1, "column() view")
+        ASSERT_TRUE_MSG(row(0, c) == mat[r][c] && column(r, 0) == mat[r][c], "row() / column() view")
+        ASSERT_TRUE_MSG(mat.getRow(r).size() == cols && mat.getColumn(c).size() == rows, "getRow() / getColumn()")
+
+        row(0, c) = 42.;
+        ASSERT_TRUE_MSG(mat[r][c] == 42. && column(r, 0) == 42., "Views share storage")
+
+        size_t h = RandomUInt(1, rows - 1), w = RandomUInt(1, cols - 1);
+        auto block = mat.block(rows - h, cols - w, h, w);
+        auto transposed = mat_c.view().transposed();
+        ASSERT_TRUE_MSG(block(h - 1, w - 1) == mat[rows - 1][cols - 1], "block() view")
+        ASSERT_TRUE_MSG(transposed == mat.transposed(), "transposed() view")
+        ASSERT_EXCEPTION_MSG(mat.block(1, 1, rows, cols), task::OutOfBoundsException, "block() bounds")
+        ASSERT_EXCEPTION_MSG(mat.row(rows), task::OutOfBoundsException, "row() bounds")
+
+        auto other = RandomMatrix(cols, RandomUInt(1, 40));
+        ASSERT_TRUE_MSG(mat.view() * other == mat * other, "Product of views")
+        ASSERT_TRUE_MSG(transposed.transposed() * other == mat * other, "Product of transposed views")
+        ASSERT_TRUE_MSG(other.view().transposed() * transposed == (mat * other).transposed(), "Product of transposed views")
+
+        Matrix sub = mat.block(0, 0, h, w);
+        auto addend = RandomMatrix(h, w);
+        size_t before = task::allocationCount();
+        block += addend;
+        block -= sub.view();
+        block *= 2.;
+        ASSERT_TRUE_MSG(task::allocationCount() == before, "View arithmetic must not allocate")
+
+        block = 2. * addend - sub;
+        ASSERT_TRUE_MSG(block == 2. * addend - sub && mat.block(rows - h, cols - w, h, w) == block, "Assignment into a view")
+        ASSERT_EXCEPTION_MSG(block += RandomMatrix(h + 1, w), task::SizeMismatchException, "View exceptions")
+    }
+
+    // Sources that overlap the destination through other strides; 600 rows
+    // also split the work between threads.
+    for (size_t size : {3, 600}) {
+        auto mat = RandomMatrix(size, size);
+        Matrix original = mat, expected = original.transposed();
+        mat = mat.view().transposed();
+        ASSERT_TRUE_MSG(mat == expected, "Assigning a transposed view of itself")
+
+        mat = original;
+        mat += mat.view().transposed();
+        expected = original + original.transposed();
+        ASSERT_TRUE_MSG(mat == expected, "Adding a transposed view of itself")
+
+        mat = original;
+        mat -= 2. * mat.view().transposed();
+        expected = original - 2. * original.transposed();
+        ASSERT_TRUE_MSG(mat == expected, "Subtracting a transposed view of itself")
+
+        mat = original;
+        mat.view() = mat.view().transposed() + original;
+        expected = original.transposed() + original;
+        ASSERT_TRUE_MSG(mat == expected, "Assigning a transposed view into a view")
+
+        mat = original;
+        size_t half = size / 2;
+        mat.block(1, 0, size - 1, half) = mat.block(0, 0, size - 1, half);
+        expected = original;
+        for (size_t i = 1; i < size; ++i) {
+            for (size_t j = 0; j < half; ++j) {
+                expected[i][j] = original[i - 1][j];
+            }
+        }
+        ASSERT_TRUE_MSG(mat == expected, "Assigning a shifted block")
+
+        mat = original;
+        mat = mat + mat;
+        expected = 2. * original;
+        ASSERT_TRUE_MSG(mat == expected, "Assigning an expression of itself")
+    }
+
+
+    for (auto isa : {task::simd::Isa::kSse2, task::simd::Isa::kAvx2, task::simd::Isa::kAvx512}) {
+        if (!task::simd::supported(isa)) {
+            continue;
+        }
+        const auto& scalar = task::simd::kernels(task::simd::Isa::kScalar);
+        const auto& vector = task::simd::kernels(isa);
+        std::string msg = std::string("SIMD kernels: ") + task::simd::isaName(isa);
+
+        REPEAT(200)
+        {
+            size_t size = RandomUInt(0, 67);
+            std::vector<double> x(size), y(size), expected, actual;
+            for (size_t i = 0; i < size; ++i) {
+                x[i] = RandomDouble();
+                y[i] = RandomDouble();
+            }
+            double alpha = RandomDouble();
+
+            expected = actual = x;
+            scalar.add(expected.data(), y.data(), size);
+            vector.add(actual.data(), y.data(), size);
+            ASSERT_TRUE_MSG(expected == actual, msg + " add")
+
+            expected = actual = x;
+            scalar.sub(expected.data(), y.data(), size);
+            vector.sub(actual.data(), y.data(), size);
+            ASSERT_TRUE_MSG(expected == actual, msg + " sub")
+
+            expected = actual = x;
+            scalar.scale(expected.data(), alpha, size);
+            vector.scale(actual.data(), alpha, size);
+            ASSERT_TRUE_MSG(expected == actual, msg + " scale")
+
+            scalar.negate(expected.data(), y.data(), size);
+            vector.negate(actual.data(), y.data(), size);
+            ASSERT_TRUE_MSG(expected == actual, msg + " negate")
+        }
+
+        REPEAT(20)
+        {
+            auto rows = RandomUInt(1, 40), cols = RandomUInt(1, 40);
+            auto mat1 = RandomMatrix(rows, cols), mat2 = RandomMatrix(rows, cols);
+            double scalar_value = RandomDouble();
+
+            task::simd::setActiveIsa(task::simd::Isa::kScalar);
+            Matrix sum = mat1 + mat2, diff = mat1 - mat2, scaled = mat1 * scalar_value, neg = -mat1;
+            task::simd::setActiveIsa(isa);
+            ASSERT_TRUE_MSG(sum == mat1 + mat2, msg + " Matrix +")
+            ASSERT_TRUE_MSG(diff == mat1 - mat2, msg + " Matrix -")
+            ASSERT_TRUE_MSG(scaled == mat1 * scalar_value, msg + " Matrix * scalar")
+            ASSERT_TRUE_MSG(neg == -mat1, msg + " Unary -")
+        }
+        task::simd::setActiveIsa(task::simd::detectedIsa());
+    }
+
+    // FixedMatrix
+    {
+        constexpr task::FixedMatrix<2, 3> a{1, 2, 3, 4, 5, 6};
+        constexpr task::FixedMatrix<3, 2> b = a.transposed();
+        constexpr auto c = a * b;
+        static_assert(c(0, 0) == 14 && c(0, 1) == 32 && c(1, 1) == 77, "constexpr FixedMatrix *");
+        static_assert(c.det() == 54 && c.trace() == 91, "constexpr det() / trace()");
+        static_assert(task::FixedMatrix<5, 5>().det() == 1, "constexpr det() by elimination");
+        static_assert(task::FixedMatrix<2, 2>::zero() + task::FixedMatrix<2, 2>() == task::FixedMatrix<2, 2>(), "constexpr +");
+
+        task::FixedMatrix<3, 4> identity;
+        ASSERT_TRUE_MSG(identity == Matrix(3, 4), "FixedMatrix default constructor")
+        ASSERT_EXCEPTION_MSG(identity.get(3, 0), task::OutOfBoundsException, "FixedMatrix get()")
+        ASSERT_EXCEPTION_MSG(identity.set(0, 4, 1.), task::OutOfBoundsException, "FixedMatrix set()")
+        ASSERT_EXCEPTION_MSG(identity[3], task::OutOfBoundsException, "FixedMatrix operator []")
+        ASSERT_EXCEPTION_MSG((task::FixedMatrix<2, 2>{1, 2, 3}), task::SizeMismatchException, "FixedMatrix values")
+        ASSERT_EXCEPTION_MSG((task::FixedMatrix<3, 3>(Matrix(3, 4))), task::SizeMismatchException, "FixedMatrix from Matrix")
+
+        CheckFixedSquare<1>();
+        CheckFixedSquare<2>();
+        CheckFixedSquare<3>();
+        CheckFixedSquare<4>();
+        CheckFixedSquare<6>();
+
+        REPEAT(20)
+        {
+            auto mat = RandomMatrix(3, RandomUInt(3, 10));
+            task::FixedMatrix<3, 3> transform(RandomMatrix(3, 3));
+            ASSERT_TRUE_MSG(transform * mat == Matrix(transform) * mat, "FixedMatrix * Matrix")
+            ASSERT_TRUE_MSG(mat.transposed() * transform == mat.transposed() * Matrix(transform), "Matrix * FixedMatrix")
+
+            Matrix sum = mat.block(0, 0, 3, 3) + transform;
+            Matrix copy = mat.block(0, 0, 3, 3);
+            copy += transform;
+            ASSERT_TRUE_MSG(sum == copy, "Matrix + FixedMatrix")
+            transform = sum;
+            ASSERT_TRUE_MSG(transform == sum, "FixedMatrix = Matrix")
+        }
+    }
+
+    // Text I/O
+    {
+        auto mat = RandomMatrix(7, 5);
+        mat[0][0] = -0.;
+        mat[0][1] = 1e300;
+        mat[0][2] = -1e-300;
+        mat[0][3] = std::numeric_limits<double>::infinity();
+        mat[0][4] = -std::numeric_limits<double>::quiet_NaN();
+        mat[1][0] = 0.;
+        mat[1][1] = 123456789.;
+
+        using std::ios_base;
+        const ios_base::fmtflags flag_sets[] = {
+            ios_base::fmtflags(), ios_base::fixed, ios_base::scientific, ios_base::fixed | ios_base::scientific,
+            ios_base::showpos, ios_base::uppercase | ios_base::scientific,
+            ios_base::uppercase | ios_base::showpos | ios_base::fixed | ios_base::scientific,
+            ios_base::showpoint};
+        for (auto flags : flag_sets) {
+            for (int precision : {0, 3, 6, 17}) {
+                std::ostringstream actual, expected;
+                actual.flags(flags);
+                expected.flags(flags);
+                actual.precision(precision);
+                expected.precision(precision);
+                actual << mat;
+                for (size_t i = 0; i < mat.rows(); ++i) {
+                    for (size_t j = 0; j < mat.cols(); ++j) {
+                        expected << mat[i][j] << " ";
+                    }
+                    expected << "\n";
+                }
+                ASSERT_TRUE_MSG(actual.str() == expected.str(),
+                                "Stream output flags " + std::to_string(flags) + " precision " + std::to_string(precision))
+            }
+        }
+
+        REPEAT(20)
+        {
+            auto mat1 = RandomMatrix(RandomUInt(0, 30), RandomUInt(0, 30));
+            std::stringstream stream;
+            stream.precision(17);
+            stream << mat1.rows() << " " << mat1.cols() << "\n" << mat1 << "42.5 tail";
+            Matrix mat2;
+            double next;
+            std::string tail;
+            stream >> mat2 >> next >> tail;
+            ASSERT_TRUE_MSG(mat2.rows() == mat1.rows() && mat2.cols() == mat1.cols(), "Stream input shape")
+            ASSERT_TRUE_MSG(std::equal(mat1.data(), mat1.data() + mat1.rowCount() * mat1.colCount(), mat2.data()),
+                            "Stream input is exact at precision 17")
+            ASSERT_TRUE_MSG(next == 42.5 && tail == "tail", "Stream input leaves what follows the matrix")
+        }
+
+        Matrix mat1;
+        std::stringstream signs("2 2\n+1.5 -2 1e3 -.5");
+        signs >> mat1;
+        ASSERT_TRUE_MSG(!signs.fail() && signs.eof(), "Stream input state at the end")
+        ASSERT_TRUE_MSG(mat1[0][0] == 1.5 && mat1[0][1] == -2. && mat1[1][0] == 1000. && mat1[1][1] == -.5,
+                        "Stream input signs and exponents")
+
+        std::stringstream bad("2 2 1 x 3 4");
+        bad >> mat1;
+        ASSERT_TRUE_MSG(bad.fail(), "Stream input of a non-number")
+        std::stringstream short_input("3 3 1 2 3");
+        short_input >> mat1;
+        ASSERT_TRUE_MSG(short_input.fail() && short_input.eof(), "Stream input of a truncated matrix")
+        std::stringstream bad_shape("-1 2 1 2");
+        bad_shape >> mat1;
+        ASSERT_TRUE_MSG(bad_shape.fail(), "Stream input of a negative size")
+        Matrix before = mat1;
+        std::stringstream huge_shape("4294967296 4294967296 1 2");
+        huge_shape >> mat1;
+        ASSERT_TRUE_MSG(huge_shape.fail() && mat1 == before, "Stream input of a size beyond memory")
+    }
+
+    // Binary I/O
+    {
+        REPEAT(20)
+        {
+            auto rows = RandomUInt(0, 40), cols = RandomUInt(0, 40);
+            auto mat = RandomMatrix(rows, cols);
+            std::stringstream stream;
+            task::binary::write(stream, mat);
+            task::binary::write(stream, mat.view().transposed());
+            Matrix read = task::binary::read(stream), read_t = task::binary::read(stream);
+            ASSERT_TRUE_MSG(read.rows() == rows && read.cols() == cols, "Binary round trip shape")
+            ASSERT_TRUE_MSG(std::equal(mat.data(), mat.data() + rows * cols, read.data()), "Binary round trip")
+            ASSERT_TRUE_MSG(read_t == mat.transposed(), "Binary round trip of a strided view")
+        }
+
+        const std::string path = "matrix_test_binary.tmp";
+        auto mat = RandomMatrix(37, 29);
+        task::binary::save(path, mat);
+        {
+            task::binary::MappedMatrix mapped(path);
+            auto address = reinterpret_cast<std::uintptr_t>(mapped.data());
+            ASSERT_TRUE_MSG(address % task::binary::PAYLOAD_ALIGNMENT == 0, "Mapped payload alignment")
+            ASSERT_TRUE_MSG(mapped == mat, "Mapped matrix")
+            ASSERT_TRUE_MSG(mapped.view().column(3) == mat.column(3), "Mapped matrix view")
+            ASSERT_TRUE_MSG(mapped.get(36, 28) == mat.get(36, 28), "Mapped matrix get()")
+            ASSERT_EXCEPTION_MSG(mapped.get(37, 0), task::OutOfBoundsException, "Mapped matrix get()")
+
+            auto other = RandomMatrix(29, 5);
+            ASSERT_TRUE_MSG(mapped * other == mat * other, "Mapped matrix product")
+            Matrix copy = mapped;
+            copy += mapped;
+            ASSERT_TRUE_MSG(copy == mat * 2., "Mapped matrix arithmetic")
+
+            task::binary::MappedMatrix moved = std::move(mapped);
+            ASSERT_TRUE_MSG(moved == mat && mapped.rowCount() == 0, "Mapped matrix move")
+        }
+        ASSERT_TRUE_MSG(task::binary::load(path) == mat, "Binary load()")
+
+        std::stringstream stream;
+        task::binary::write(stream, mat);
+        std::string bytes = stream.str();
+        std::stringstream truncated(bytes.substr(0, bytes.size() - 1));
+        ASSERT_EXCEPTION_MSG(task::binary::read(truncated), task::FormatException, "Truncated binary matrix")
+        bytes[0] = 'X';
+        std::stringstream corrupted(bytes);
+        ASSERT_EXCEPTION_MSG(task::binary::read(corrupted), task::FormatException, "Binary magic")
+        std::stringstream text("2 2\n1 2\n3 4\n");
+        ASSERT_EXCEPTION_MSG(task::binary::read(text), task::FormatException, "Text is not binary")
+
+        // A valid header claiming 10^12 elements must fail without
+        // allocating them, from a string and from a stream without seeks.
+        std::string intact = stream.str(), huge = intact;
+        uint64_t million = 1000000;
+        std::memcpy(&huge[offsetof(task::binary::Header, rows)], &million, sizeof(million));
+        std::memcpy(&huge[offsetof(task::binary::Header, cols)], &million, sizeof(million));
+        std::stringstream oversized(huge);
+        ASSERT_EXCEPTION_MSG(task::binary::read(oversized), task::FormatException, "Binary size beyond the stream")
+
+        PipeBuffer pipe(intact), truncated_pipe(intact.substr(0, intact.size() - 1)), huge_pipe(huge);
+        std::istream piped(&pipe), truncated_piped(&truncated_pipe), huge_piped(&huge_pipe);
+        ASSERT_TRUE_MSG(task::binary::read(piped) == mat, "Binary read() without seeks")
+        ASSERT_EXCEPTION_MSG(task::binary::read(truncated_piped), task::FormatException, "Truncated binary matrix without seeks")
+        ASSERT_EXCEPTION_MSG(task::binary::read(huge_piped), task::FormatException, "Binary size beyond a stream without seeks")
+
+        {
+            std::ofstream output(path, std::ios::binary);
+            output << bytes.substr(0, 100);
+        }
+        ASSERT_EXCEPTION_MSG(task::binary::MappedMatrix(path), task::FormatException, "Mapped magic")
+        std::remove(path.c_str());
+        ASSERT_EXCEPTION_MSG(task::binary::MappedMatrix(path), std::system_error, "Mapped missing file")
+    }
+
+    // Sparse matrices
+    {
+        using Layout = task::SparseMatrix::Layout;
+        REPEAT(30)
+        {
+            auto rows = RandomUInt(0, 40), cols = RandomUInt(0, 40), inner = RandomUInt(0, 40);
+            double density = RandomUInt(0, 10) / 10.;
+            auto dense1 = RandomSparseMatrix(rows, cols, density), dense2 = RandomSparseMatrix(rows, cols, density);
+            auto dense3 = RandomSparseMatrix(cols, inner, density);
+            auto layout1 = TossCoin() ? Layout::kCsr : Layout::kCsc;
+            auto layout2 = TossCoin() ? Layout::kCsr : Layout::kCsc;
+            task::SparseMatrix sparse1(dense1, layout1), sparse2(dense2, layout2), sparse3(dense3, layout2);
+
+            ASSERT_TRUE_MSG(sparse1.toDense() == dense1, "SparseMatrix from Matrix")
+            ASSERT_TRUE_MSG(sparse1.toLayout(layout2).toDense() == dense1, "SparseMatrix layout conversion")
+            ASSERT_TRUE_MSG(sparse1.transposed().toDense() == dense1.transposed(), "SparseMatrix transposed()")
+            ASSERT_TRUE_MSG((sparse1 + sparse2).toDense() == dense1 + dense2, "SparseMatrix +")
+            ASSERT_TRUE_MSG((sparse1 - sparse2).layout() == layout1, "SparseMatrix - keeps the layout")
+            ASSERT_TRUE_MSG((sparse1 - sparse2).toDense() == dense1 - dense2, "SparseMatrix -")
+            ASSERT_TRUE_MSG((sparse1 - sparse1).nonZeros() == 0, "SparseMatrix drops cancellations")
+            ASSERT_TRUE_MSG((2. * sparse1).toDense() == dense1 * 2., "SparseMatrix * scalar")
+            ASSERT_TRUE_MSG(sparse1 * dense3 == dense1 * dense3, "SparseMatrix * Matrix")
+            ASSERT_TRUE_MSG(dense1 * sparse3 == dense1 * dense3, "Matrix * SparseMatrix")
+
+            std::vector<double> x(cols);
+            Matrix x_column(cols, 1);
+            for (size_t i = 0; i < cols; ++i) {
+                x[i] = x_column[i][0] = RandomDouble();
+            }
+            auto y = sparse1 * x;
+            Matrix y_column = dense1 * x_column;
+            ASSERT_TRUE_MSG(y.size() == rows, "SpMV size")
+            for (size_t i = 0; i < rows; ++i) {
+                ASSERT_TRUE_MSG(std::fabs(y[i] - y_column[i][0]) < EPS, "SpMV")
+            }
+
+            size_t stored = 0;
+            for (size_t i = 0; i < rows; ++i) {
+                for (size_t j = 0; j < cols; ++j) {
+                    stored += dense1[i][j] != 0;
+                    ASSERT_TRUE_MSG(sparse1.get(i, j) == dense1[i][j], "SparseMatrix get()")
+                }
+            }
+            ASSERT_TRUE_MSG(sparse1.nonZeros() == stored, "SparseMatrix nonZeros()")
+        }
+
+        Matrix dense(2, 3);
+        dense[0][2] = EPS / 2;
+        task::SparseMatrix sparse(dense);
+        ASSERT_TRUE_MSG(sparse.nonZeros() == 2, "SparseMatrix threshold")
+        ASSERT_EXCEPTION_MSG(sparse.get(2, 0), task::OutOfBoundsException, "SparseMatrix get()")
+        ASSERT_EXCEPTION_MSG(sparse + sparse.transposed(), task::SizeMismatchException, "SparseMatrix +")
+        ASSERT_EXCEPTION_MSG(sparse * dense, task::SizeMismatchException, "SparseMatrix * Matrix")
+        ASSERT_EXCEPTION_MSG(sparse * std::vector<double>(2), task::SizeMismatchException, "SpMV")
+    }
+
+    // Cached derived values
+    {
+        auto a = RandomMatrix(40, 40);
+        auto stats = [] {
+            auto current = task::derivedStats();
+            return std::make_pair(current.hits, current.computations);
+        };
+        task::resetDerivedStats();
+        double det = a.det(), trace = a.trace();
+        ASSERT_TRUE_MSG(stats() == std::make_pair(size_t(0), size_t(2)), "det() and trace() are computed")
+        ASSERT_TRUE_MSG(a.det() == det && a.trace() == trace, "Cached det() and trace()")
+        ASSERT_TRUE_MSG(stats() == std::make_pair(size_t(2), size_t(2)), "Cached det() and trace() are hits")
+        auto b = RandomMatrix(40, 3);
+        auto x = a.solve(b);
+        auto lu = a.lu();
+        ASSERT_TRUE_MSG(a.inverse() * b == x && lu.solve(b) == x, "Cached LU")
+        ASSERT_TRUE_MSG(stats() == std::make_pair(size_t(5), size_t(2)), "solve(), lu() and inverse() reuse the factorization")
+
+        Matrix copy = a;
+        ASSERT_TRUE_MSG(copy.det() == det && stats().second == 3, "Copies start without cached values")
+        Matrix moved = std::move(copy);
+        ASSERT_TRUE_MSG(moved.det() == det && stats().second == 3, "Moves keep cached values")
+
+        // transposed() keeps its result from the second call on.
+        auto transposed = a.transposed();
+        ASSERT_TRUE_MSG(a.transposed() == transposed && stats().second == 5, "transposed() is computed twice")
+        ASSERT_TRUE_MSG(a.transposed() == transposed && stats().second == 5, "Cached transposed()")
+
+        auto check = [&](Matrix& m, const std::string& what) {
+            Matrix fresh(m.rowCount(), m.colCount());
+            fresh = m.view();
+            ASSERT_TRUE_MSG(std::fabs(m.det() - fresh.det()) <= EPS * std::max(1., std::fabs(fresh.det())), "det() after " + what)
+            ASSERT_TRUE_MSG(std::fabs(m.trace() - fresh.trace()) <= EPS, "trace() after " + what)
+            ASSERT_TRUE_MSG(m.transposed() == fresh.transposed(), "transposed() after " + what)
+            ASSERT_TRUE_MSG(m.lu().permutationMatrix() * m == m.lu().lower() * m.lu().upper(), "lu() after " + what)
+            m.transposed();
+        };
+        a.set(1, 2, 5.);
+        check(a, "set()");
+        a.get(2, 1) = -3.;
+        check(a, "get()");
+        a[3][3] += 7.;
+        check(a, "operator[]");
+        a(4, 0) = 11.;
+        check(a, "operator()");
+        a += RandomMatrix(40, 40);
+        check(a, "+=");
+        a -= RandomMatrix(40, 40);
+        check(a, "-=");
+        a *= 0.5;
+        check(a, "*= number");
+        a *= RandomMatrix(40, 40);
+        check(a, "*= matrix");
+        a += 2. * RandomMatrix(40, 40);
+        check(a, "+= expression");
+        a = RandomMatrix(40, 40);
+        check(a, "assignment");
+        a = a * 2. + RandomMatrix(40, 40);
+        check(a, "assignment of an expression");
+        a.transpose();
+        check(a, "transpose()");
+        a.block(5, 5, 3, 3) *= 4.;
+        check(a, "a mutable view");
+        a.resize(41, 41);
+        a[40][40] = 1.;
+        check(a, "resize()");
+        std::stringstream text;
+        text << "41 41\n" << RandomMatrix(41, 41);
+        text >> a;
+        check(a, "operator>>");
+
+        double* row = a[0];
+        a.det();
+        row[0] += 100.;
+        a.invalidate();
+        check(a, "invalidate()");
+
+        // Const matrices may be shared between threads.
+        const Matrix shared = RandomMatrix(60, 60);
+        double expected = Matrix(shared).det();
+        std::vector<double> results(4);
+        std::vector<std::thread> threads;
+        for (size_t i = 0; i < results.size(); ++i) {
+            threads.emplace_back([&, i] {
+                for (int repeat = 0; repeat < 20; ++repeat) {
+                    results[i] = shared.det() + shared.transposed().trace() - shared.trace();
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        for (double result : results) {
+            ASSERT_TRUE_MSG(std::fabs(result - expected) <= EPS * std::max(1., std::fabs(expected)), "Concurrent det()")
+        }
+        ASSERT_EXCEPTION_MSG(RandomMatrix(2, 3).det(), task::SizeMismatchException, "Cached det() exceptions")
+    }
+
+    // Matrix-vector kernels
+    for (auto isa : {task::simd::Isa::kScalar, task::simd::Isa::kAvx2, task::simd::Isa::kAvx512}) {
+        if (!task::simd::supported(isa)) {
+            continue;
+        }
+        task::simd::setActiveIsa(isa);
+        std::string msg = std::string("BLAS-2, ") + task::simd::isaName(isa) + ": ";
+
+        REPEAT(20)
+        {
+            auto m = RandomUInt(1, 150), n = RandomUInt(1, 150);
+            auto a = RandomMatrix(m, n);
+            auto x = RandomVector(n), y = RandomVector(m), row = RandomVector(m);
+            double alpha = RandomDouble(), beta = RandomDouble();
+
+            std::vector<double> expected(m), expected_row(n);
+            for (size_t i = 0; i < m; ++i) {
+                double sum = 0.;
+                for (size_t j = 0; j < n; ++j) {
+                    sum += a[i][j] * x[j];
+                    expected_row[j] += row[i] * a[i][j];
+                }
+                expected[i] = alpha * sum + beta * y[i];
+            }
+            auto result = y;
+            task::gemv(alpha, a, x, beta, result);
+            ASSERT_TRUE_MSG(MaxDifference(result, expected) < 1e-9, msg + "gemv()")
+            task::gemv(alpha, a.transposed().view().transposed(), x, beta, y);
+            ASSERT_TRUE_MSG(MaxDifference(y, expected) < 1e-9, msg + "gemv() of a transposed view")
+            ASSERT_TRUE_MSG(MaxDifference(row * a, expected_row) < 1e-9, msg + "x * A")
+
+            Matrix column(n, 1);
+            for (size_t j = 0; j < n; ++j) {
+                column[j][0] = x[j];
+            }
+            auto product = a * x, reference = (a * column).getColumn(0);
+            ASSERT_TRUE_MSG(MaxDifference(product, reference) < 1e-9, msg + "A * x")
+
+            // Every other row and column: neither stride is 1.
+            task::ConstMatrixView strided(a.data(), (m + 1) / 2, (n + 1) / 2, 2 * n, 2);
+            std::vector<double> half_x(strided.colCount()), half_y(strided.rowCount());
+            for (size_t j = 0; j < half_x.size(); ++j) {
+                half_x[j] = x[2 * j];
+            }
+            task::gemv(1., strided, half_x, 0., half_y);
+            for (size_t i = 0; i < half_y.size(); ++i) {
+                double sum = 0.;
+                for (size_t j = 0; j < half_x.size(); ++j) {
+                    sum += a[2 * i][2 * j] * x[2 * j];
+                }
+                half_y[i] -= sum;
+            }
+            ASSERT_TRUE_MSG(MaxDifference(half_y, std::vector<double>(half_y.size())) < 1e-9, msg + "gemv() of a strided view")
+
+            auto updated = a, updated_t = a.transposed();
+            task::ger(alpha, y, x, updated);
+            task::ger(alpha, y, x, updated_t.view().transposed());
+            bool ok = true;
+            for (size_t i = 0; i < m; ++i) {
+                for (size_t j = 0; j < n; ++j) {
+                    double value = a[i][j] + alpha * y[i] * x[j];
+                    ok = ok && std::fabs(updated[i][j] - value) < 1e-12 * std::max(1., std::fabs(value));
+                    ok = ok && std::fabs(updated_t[j][i] - value) < 1e-12 * std::max(1., std::fabs(value));
+                }
+            }
+            ASSERT_TRUE_MSG(ok, msg + "ger()")
+        }
+
+        REPEAT(10)
+        {
+            // Sizes across several blocks of blas2::NB.
+            auto n = RandomUInt(1, 3 * task::blas2::NB + 7);
+            // Small off-diagonal entries keep unit triangles well conditioned.
+            Matrix a = RandomMatrix(n, n) * (0.01 / n);
+            for (size_t i = 0; i < n; ++i) {
+                a[i][i] = 2.;
+            }
+            auto b = RandomVector(n);
+            for (auto triangle : {task::blas2::Triangle::kLower, task::blas2::Triangle::kUpper}) {
+                for (auto diagonal : {task::blas2::Diagonal::kNonUnit, task::blas2::Diagonal::kUnit}) {
+                    bool lower = triangle == task::blas2::Triangle::kLower;
+                    Matrix t(n, n);
+                    for (size_t i = 0; i < n; ++i) {
+                        for (size_t j = 0; j < n; ++j) {
+                            bool inside = lower ? j < i : j > i;
+                            t[i][j] = inside ? a[i][j] : i == j && diagonal == task::blas2::Diagonal::kNonUnit ? a[i][j] : i == j ? 1. : 0.;
+                        }
+                    }
+                    auto x = b, x_t = b;
+                    task::trsv(triangle, diagonal, a, x);
+                    ASSERT_TRUE_MSG(MaxDifference(t * x, b) < 1e-9, msg + "trsv()")
+                    Matrix a_t = a.transposed();
+                    task::trsv(triangle, diagonal, a_t.view().transposed(), x_t);
+                    ASSERT_TRUE_MSG(MaxDifference(x_t, x) < 1e-9, msg + "trsv() of a transposed view")
+                }
+            }
+            auto solution = a.solve(b);
+            ASSERT_TRUE_MSG(MaxDifference(a * solution, b) < 1e-9, msg + "solve() of a vector")
+        }
+    }
+    task::simd::setActiveIsa(task::simd::detectedIsa());
+    {
+        auto a = RandomMatrix(300, 200), t = RandomMatrix(300, 300);
+        auto x = RandomVector(200), y = RandomVector(300), b = RandomVector(300);
+        for (size_t i = 0; i < 300; ++i) {
+            t[i][i] = 1e4;
+        }
+        task::parallel::setThreadCount(1);
+        auto product = a * x, product_t = y * a;
+        auto solution = b;
+        auto updated = a;
+        task::ger(2., y, x, updated);
+        task::trsv(task::blas2::Triangle::kLower, task::blas2::Diagonal::kNonUnit, t, solution);
+
+        task::parallel::setThreadCount(4);
+        task::parallel::setThreshold(0);
+        ASSERT_TRUE_MSG(a * x == product && y * a == product_t, "Parallel gemv()")
+        auto parallel_updated = a;
+        auto parallel_solution = b;
+        task::ger(2., y, x, parallel_updated);
+        ASSERT_TRUE_MSG(parallel_updated == updated, "Parallel ger()")
+        task::trsv(task::blas2::Triangle::kLower, task::blas2::Diagonal::kNonUnit, t, parallel_solution);
+        ASSERT_TRUE_MSG(parallel_solution == solution, "Parallel trsv()")
+        task::parallel::setThreadCount(0);
+        task::parallel::setThreshold(1 << 15);
+    }
+    {
+        auto a = RandomMatrix(3, 4);
+        std::vector<double> x(4), y(3);
+        ASSERT_EXCEPTION_MSG(a * std::vector<double>(3), task::SizeMismatchException, "gemv() exceptions")
+        ASSERT_EXCEPTION_MSG(std::vector<double>(4) * a, task::SizeMismatchException, "gemv() exceptions")
+        ASSERT_EXCEPTION_MSG(task::gemv(1., a, x, 0., x), task::SizeMismatchException, "gemv() exceptions")
+        ASSERT_EXCEPTION_MSG(task::ger(1., x, y, a), task::SizeMismatchException, "ger() exceptions")
+        ASSERT_EXCEPTION_MSG(task::trsv(task::blas2::Triangle::kLower, task::blas2::Diagonal::kUnit, a, y),
+                             task::SizeMismatchException, "trsv() exceptions")
+        Matrix singular(3, 3);
+        singular[1][1] = 0.;
+        ASSERT_EXCEPTION_MSG(task::trsv(task::blas2::Triangle::kUpper, task::blas2::Diagonal::kNonUnit, singular, y),
+                             task::SingularMatrixException, "trsv() exceptions")
+        task::trsv(task::blas2::Triangle::kUpper, task::blas2::Diagonal::kUnit, singular, y);
+        ASSERT_EXCEPTION_MSG(singular.solve(y), task::SingularMatrixException, "solve() of a vector exceptions")
+        ASSERT_EXCEPTION_MSG(Matrix(3, 3).solve(x), task::SizeMismatchException, "solve() of a vector exceptions")
+    }
+
+    // Strassen-Winograd
+    {
+        for (size_t crossover : {2, 5, 16}) {
+            task::strassen::setCrossover(crossover);
+            REPEAT(20)
+            {
+                auto m = RandomUInt(1, 70), n = RandomUInt(1, 70), k = RandomUInt(1, 70);
+                auto a = RandomMatrix(m, k), b = RandomMatrix(k, n);
+                Matrix expected(m, n);
+                for (size_t i = 0; i < m; ++i) {
+                    for (size_t j = 0; j < n; ++j) {
+                        double sum = 0;
+                        for (size_t l = 0; l < k; ++l) {
+                            sum += a[i][l] * b[l][j];
+                        }
+                        expected[i][j] = sum;
+                    }
+                }
+                ASSERT_TRUE_MSG(a * b == expected, "Strassen product, crossover " + std::to_string(crossover))
+                auto at = RandomMatrix(k, m);
+                ASSERT_TRUE_MSG(at.transposed() * b == at.view().transposed() * b, "Strassen product of a view")
+            }
+        }
+        task::strassen::setCrossover(0);
+    }
+
+    // Matrix batches
+    {
+        for (auto isa : {task::simd::Isa::kScalar, task::simd::Isa::kAvx2, task::simd::Isa::kAvx512}) {
+            if (!task::simd::supported(isa)) {
+                continue;
+            }
+            task::simd::setActiveIsa(isa);
+            std::string msg = std::string("MatrixBatch (") + task::simd::isaName(isa) + ") ";
+            REPEAT(10)
+            {
+                size_t count = RandomUInt(0, 40), n = RandomUInt(1, 18), k = RandomUInt(1, 6), m = RandomUInt(1, 6);
+                std::vector<Matrix> squares, lefts, rights, others;
+                for (size_t index = 0; index < count; ++index) {
+                    squares.push_back(RandomMatrix(n, n));
+                    if (index % 5 == 0) {
+                        squares.back()[0][0] = squares.back()[1 % n][0];
+                        squares.back()[0][n - 1] = 0.;
+                    }
+                    lefts.push_back(RandomMatrix(m, k));
+                    rights.push_back(RandomMatrix(k, m));
+                    others.push_back(RandomMatrix(m, k));
+                }
+                task::MatrixBatch square(squares), left(lefts), right(rights), other(others);
+                auto dets = square.det(), traces = square.trace();
+                auto product = left * right, sum = left + other, diff = left - other, scaled = left * 3.;
+                auto transposed = left.transposed();
+                ASSERT_TRUE_MSG(dets.size() == count && traces.size() == count, msg + "result sizes")
+                for (size_t index = 0; index < count; ++index) {
+                    double det = squares[index].det();
+                    ASSERT_TRUE_MSG(std::fabs(dets[index] - det) <= 1e-9 * std::max(1., std::fabs(det)), msg + "det()")
+                    ASSERT_TRUE_MSG(std::fabs(traces[index] - squares[index].trace()) < EPS, msg + "trace()")
+                    ASSERT_TRUE_MSG(product.matrix(index) == lefts[index] * rights[index], msg + "*")
+                    ASSERT_TRUE_MSG(sum.matrix(index) == lefts[index] + others[index], msg + "+")
+                    ASSERT_TRUE_MSG(diff.matrix(index) == lefts[index] - others[index], msg + "-")
+                    ASSERT_TRUE_MSG(scaled.matrix(index) == lefts[index] * 3., msg + "* scalar")
+                    ASSERT_TRUE_MSG(transposed.matrix(index) == lefts[index].transposed(), msg + "transposed()")
+                }
+            }
+        }
+        task::simd::setActiveIsa(task::simd::detectedIsa());
+
+        task::MatrixBatch identities(3, 2, 3);
+        ASSERT_TRUE_MSG(identities.matrix(2) == Matrix(2, 3), "MatrixBatch constructor")
+        identities.setMatrix(1, RandomMatrix(2, 3));
+        ASSERT_TRUE_MSG(identities.matrix(0) == Matrix(2, 3), "MatrixBatch setMatrix()")
+        ASSERT_EXCEPTION_MSG(identities.setMatrix(1, Matrix(3, 2)), task::SizeMismatchException, "MatrixBatch setMatrix()")
+        ASSERT_EXCEPTION_MSG(identities.get(3, 0, 0), task::OutOfBoundsException, "MatrixBatch get()")
+        ASSERT_EXCEPTION_MSG(identities.det(), task::SizeMismatchException, "MatrixBatch det()")
+        ASSERT_EXCEPTION_MSG(identities * identities, task::SizeMismatchException, "MatrixBatch *")
+        ASSERT_EXCEPTION_MSG(identities + task::MatrixBatch(4, 2, 3), task::SizeMismatchException, "MatrixBatch +")
+        ASSERT_EXCEPTION_MSG(task::MatrixBatch(std::vector<Matrix>{Matrix(2, 2), Matrix(2, 3)}),
+                             task::SizeMismatchException, "MatrixBatch from matrices")
+        auto address = reinterpret_cast<std::uintptr_t>(identities.lanes(1, 2));
+        ASSERT_TRUE_MSG(address % 64 == 0, "MatrixBatch lane alignment")
+    }
+
+    // Generic element types
+    {
+        for (auto isa : {task::simd::Isa::kScalar, task::simd::Isa::kSse2, task::simd::Isa::kAvx2, task::simd::Isa::kAvx512}) {
+            if (!task::simd::supported(isa)) {
+                continue;
+            }
+            task::simd::setActiveIsa(isa);
+            std::string suffix = std::string(" (") + task::simd::isaName(isa) + ")";
+            CheckElementType<float>("float" + suffix, 1., 20, 1e-5);
+            CheckElementType<double>("double" + suffix, 1., 20, 1e-12);
+            CheckElementType<int32_t>("int32_t" + suffix, 1., 8, 0.);
+            CheckElementType<int64_t>("int64_t" + suffix, 1., 8, 0.);
+        }
+        task::simd::setActiveIsa(task::simd::detectedIsa());
+        CheckElementType<task::FixedPoint<16>>("FixedPoint<16>", 0.25, 4, 1e-3);
+        CheckElementType<task::FixedPoint<32, int64_t>>("FixedPoint<32, int64_t>", 1., 8, 1e-7);
+
+        // Large enough to cross the panels of the product.
+        Matrix big_a = RandomMatrix(150, 300), big_b = RandomMatrix(300, 700);
+        task::BasicMatrix<float> float_a(big_a), float_b(big_b);
+        ASSERT_TRUE_MSG(MaxError(float_a * float_b, float_a.toMatrix() * float_b.toMatrix()) < 1e-3, "BasicMatrix<float> large *")
+
+        using Fixed = task::FixedPoint<16>;
+        ASSERT_TRUE_MSG(Fixed(1.5) * Fixed(-2.25) == Fixed(-3.375), "FixedPoint *")
+        ASSERT_TRUE_MSG((Fixed(1.) / Fixed(3.)).raw() == 21845 && (Fixed(-2.) / Fixed(3.)).raw() == -43691, "FixedPoint / rounding")
+        ASSERT_TRUE_MSG(static_cast<double>(Fixed(-0.1)) == -6554. / 65536., "FixedPoint from double")
+        ASSERT_TRUE_MSG(Fixed(2.) > Fixed(-3.) && -Fixed(2.) == Fixed(-2.), "FixedPoint comparisons")
+        auto max = Fixed::fromRaw(std::numeric_limits<int32_t>::max()), min = Fixed::fromRaw(std::numeric_limits<int32_t>::min());
+        ASSERT_TRUE_MSG(max + Fixed::fromRaw(1) == min && min - Fixed::fromRaw(1) == max && -min == min, "FixedPoint overflow wraps")
+
+        task::BasicMatrix<int32_t> ints(2, 3);
+        ints(0, 2) = -7;
+        std::stringstream text;
+        text << "2 3\n" << ints;
+        task::BasicMatrix<int32_t> read_back;
+        text >> read_back;
+        ASSERT_TRUE_MSG(text && read_back == ints, "BasicMatrix I/O")
+        std::stringstream huge_text("4294967296 4294967296 1 2");
+        huge_text >> read_back;
+        ASSERT_TRUE_MSG(huge_text.fail() && read_back == ints, "BasicMatrix input of a size beyond memory")
+        ASSERT_EXCEPTION_MSG(task::BasicMatrix<float>(size_t(1) << 32, size_t(1) << 32), task::OverflowException, "BasicMatrix size beyond memory")
+        ASSERT_TRUE_MSG((task::BasicMatrix<float>(task::BasicMatrix<int32_t>(ints)) == task::BasicMatrix<float>(ints)), "BasicMatrix conversions")
+        ASSERT_TRUE_MSG(task::BasicMatrix<float>(2, 2) == task::BasicMatrix<float>(Matrix(2, 2)), "BasicMatrix identity")
+        ASSERT_TRUE_MSG(ints.getRow(0) == (std::vector<int32_t>{1, 0, -7}) && ints.getColumn(2) == (std::vector<int32_t>{-7, 0}), "BasicMatrix getRow()/getColumn()")
+        ints.resize(3, 3);
+        ASSERT_TRUE_MSG(ints(2, 2) == 0 && ints(1, 1) == 1 && ints.det() == 0, "BasicMatrix resize()")
+
+        ASSERT_EXCEPTION_MSG(ints.get(3, 0), task::OutOfBoundsException, "BasicMatrix get()")
+        ASSERT_EXCEPTION_MSG(ints + task::BasicMatrix<int32_t>(3, 2), task::SizeMismatchException, "BasicMatrix +")
+        ASSERT_EXCEPTION_MSG(ints * task::BasicMatrix<int32_t>(2, 2), task::SizeMismatchException, "BasicMatrix *")
+        ASSERT_EXCEPTION_MSG(task::BasicMatrix<float>(2, 3).det(), task::SizeMismatchException, "BasicMatrix det()")
+
+        // Entries near the ends of int32_t take Bareiss beyond 64 bits; the
+        // cofactor expansion in 128 bits is the reference.
+        auto det3 = [](const task::BasicMatrix<int32_t> &a) {
+            auto at = [&](size_t row, size_t col) {
+                return static_cast<__int128>(a(row, col));
+            };
+            return at(0, 0) * (at(1, 1) * at(2, 2) - at(1, 2) * at(2, 1)) -
+                   at(0, 1) * (at(1, 0) * at(2, 2) - at(1, 2) * at(2, 0)) +
+                   at(0, 2) * (at(1, 0) * at(2, 1) - at(1, 1) * at(2, 0));
+        };
+        task::BasicMatrix<int32_t> large(3, 3);
+        int32_t entries[] = {2100000000, 2000000000, 1999999999, 2099999999, 2000000000, 1999999999,
+                             -2000000000, 2000000002, 2000000001};
+        for (size_t i = 0; i < 9; ++i) {
+            large(i / 3, i % 3) = entries[i];
+        }
+        ASSERT_TRUE_MSG(det3(large) == 2 && large.det() == 2, "BasicMatrix<int32_t> det() of large entries")
+        REPEAT(100)
+        {
+            for (size_t i = 0; i < 9; ++i) {
+                auto magnitude = static_cast<int32_t>(RandomUInt(1900000000, 2147483647));
+                large(i / 3, i % 3) = TossCoin() ? magnitude : -magnitude;
+            }
+            // Now and then one that fits, shaped like the one above: its
+            // determinant is b * f - c * e with b * f within b / 2 of c * e.
+            if (TossCoin()) {
+                int64_t b = RandomUInt(2000000000, 2147483647), c = RandomUInt(1900000000, b), e = RandomUInt(1900000000, b);
+                large(0, 1) = large(1, 1) = b;
+                large(0, 2) = large(1, 2) = c;
+                large(1, 0) = large(0, 0) - (large(0, 0) > 0 ? 1 : -1);
+                large(2, 1) = e;
+                large(2, 2) = (c * e + b / 2) / b;
+            }
+            __int128 expected = det3(large);
+            if (expected >= std::numeric_limits<int32_t>::min() && expected <= std::numeric_limits<int32_t>::max()) {
+                ASSERT_TRUE_MSG(large.det() == expected, "BasicMatrix<int32_t> det() of large entries")
+            } else {
+                ASSERT_EXCEPTION_MSG(large.det(), task::OverflowException, "BasicMatrix<int32_t> det() out of range")
+            }
+        }
+        task::BasicMatrix<int64_t> wide(3, 3);
+        wide(0, 0) = int64_t(1) << 62;
+        wide(1, 1) = 4;
+        ASSERT_EXCEPTION_MSG(wide.det(), task::OverflowException, "BasicMatrix<int64_t> det() out of range")
+        wide(1, 1) = std::numeric_limits<int64_t>::max();
+        wide(0, 1) = std::numeric_limits<int64_t>::max();
+        wide(1, 0) = std::numeric_limits<int64_t>::min();
+        ASSERT_EXCEPTION_MSG(wide.det(), task::OverflowException, "BasicMatrix<int64_t> det() past 128 bits")
+        ASSERT_EXCEPTION_MSG(task::BasicMatrix<float>(2, 3).trace(), task::SizeMismatchException, "BasicMatrix trace()")
+        ASSERT_EXCEPTION_MSG(ints == task::BasicMatrix<int32_t>(2, 3), task::SizeMismatchException, "BasicMatrix ==")
+    }
+
+    // Storage
+    {
+        REPEAT(20)
+        {
+            auto rows = RandomUInt(0, 50), cols = RandomUInt(0, 50);
+            Matrix mat(rows, cols);
+            auto address = reinterpret_cast<std::uintptr_t>(mat.data());
+            ASSERT_TRUE_MSG(address % task::storage::ALIGNMENT == 0, "Storage: alignment")
+        }
+
+        task::storage::resetPoolStats();
+        REPEAT(100)
+        {
+            Matrix mat(17, 23);
+            mat.set(16, 22, 1);
+        }
+        auto stats = task::storage::poolStats();
+        ASSERT_TRUE_MSG(stats.requests == 100, "Storage: pool requests")
+        ASSERT_TRUE_MSG(stats.local_hits >= 99, "Storage: thread-local reuse")
+        ASSERT_TRUE_MSG(stats.hitRate() > 0.9, "Storage: hit rate")
+
+        Matrix pooled = RandomMatrix(30, 30);
+        task::storage::setPolicy(task::storage::HEAP);
+        Matrix heap = pooled;
+        auto address = reinterpret_cast<std::uintptr_t>(heap.data());
+        ASSERT_TRUE_MSG(address % task::storage::ALIGNMENT == 0, "Storage: heap alignment")
+        pooled.resize(40, 40);
+        ASSERT_TRUE_MSG(heap == pooled.block(0, 0, 30, 30), "Storage: heap copy")
+        task::storage::setPolicy(task::storage::POOLED);
+        heap.resize(40, 40);
+        ASSERT_TRUE_MSG(heap == pooled, "Storage: switching policies")
+
+        // Switching while another thread allocates.
+        std::atomic<bool> done{false};
+        std::thread worker([&] {
+            while (!done) {
+                Matrix temp(RandomUInt(1, 20), 7);
+                temp.set(0, 6, 2.);
+            }
+        });
+        REPEAT(1000)
+        {
+            task::storage::setPolicy(_iter % 2 == 0 ? task::storage::HEAP : task::storage::POOLED);
+        }
+        done = true;
+        worker.join();
+        ASSERT_TRUE_MSG(&task::storage::policy() == &task::storage::POOLED, "Storage: switching while allocating")
+        task::storage::trim();
+    }
+
+
     const int STRESS_TEST_COUNT = argc > 1 ? std::stoi(argv[1]) : 0;
 
     REPEAT(STRESS_TEST_COUNT)
@@ -0,0 +1,6 @@
+#!/bin/bash
+
+set -e
+
+g++ -std=c++17 -O2 -DNDEBUG -I./ bench/bench.cpp -o vector_ops_bench
+./vector_ops_bench "$@"
@@ -0,0 +1,355 @@
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+#include "src/vector_ops.h"
+
+using namespace task;
+
+namespace {
+
+template <class T>
+void DoNotOptimize(const T &value) {
+  asm volatile("" : : "r,m"(value) : "memory");
+}
+
+// Seconds per call of fn, averaged over at least min_seconds.
+template <class F>
+double Measure(F &&fn, double min_seconds = 0.2) {
+  using Clock = std::chrono::steady_clock;
+  fn();
+  size_t iterations = 1;
+  for (;;) {
+    auto start = Clock::now();
+    for (size_t i = 0; i < iterations; ++i) {
+      fn();
+    }
+    double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+    if (elapsed >= min_seconds) {
+      return elapsed / iterations;
+    }
+    iterations *= elapsed > 0 ? std::max<size_t>(2, static_cast<size_t>(min_seconds / elapsed * 1.2)) : 10;
+  }
+}
+
+// The loops the operators used before the kernels, for reference.
+namespace loops {
+
+std::vector<double> add(const std::vector<double> &a, const std::vector<double> &b) {
+  std::vector<double> c(a.size());
+  for (size_t i = 0; i < a.size(); ++i) {
+    c[i] = a[i] + b[i];
+  }
+  return c;
+}
+
+std::vector<double> sub(const std::vector<double> &a, const std::vector<double> &b) {
+  std::vector<double> c(a.size());
+  for (size_t i = 0; i < a.size(); ++i) {
+    c[i] = a[i] - b[i];
+  }
+  return c;
+}
+
+std::vector<double> negate(const std::vector<double> &a) {
+  std::vector<double> c(a.size());
+  for (size_t i = 0; i < a.size(); ++i) {
+    c[i] = -a[i];
+  }
+  return c;
+}
+
+double dot(const std::vector<double> &a, const std::vector<double> &b) {
+  double c = 0;
+  for (size_t i = 0; i < a.size(); ++i) {
+    c += a[i] * b[i];
+  }
+  return c;
+}
+
+bool collinear(const std::vector<double> &a, const std::vector<double> &b) {
+  size_t i;
+  size_t n = a.size();
+  const double EPS = 1e-12;
+  std::vector<double> c(n, 0.);
+  if (a == c || b == c) {
+    return true;
+  }
+  for (i = 0; i < n; ++i) {
+    if (a[i] != 0 && b[i] != 0) {
+      break;
+    }
+  }
+  if (i == n) {
+    return false;
+  }
+  double alpha = a[i] / b[i];
+  for (size_t j = 0; j < n; ++j) {
+    if ((b[j] == 0 && a[j] != 0) || (a[j] == 0 && b[j] != 0)) {
+      return false;
+    }
+    if ((b[j] != 0) && (fabs(a[j] / b[j] - alpha) >= EPS)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+
+bool codirectional(const std::vector<double> &a, const std::vector<double> &b) {
+  size_t n = a.size();
+  std::vector<double> c(n, 0.);
+  size_t i;
+  if (a == c || b == c) {
+    return true;
+  }
+  for (i = 0; i < n; ++i) {
+    if (a[i] != 0 && b[i] != 0) {
+      break;
+    }
+  }
+  if (i == n) {
+    return false;
+  }
+  double alpha = a[i] / b[i];
+  if (collinear(a, b) && (alpha > 0)) {
+    return true;
+  } else {
+    return false;
+  }
+}
+
+std::vector<int> bitOr(const std::vector<int> &a, const std::vector<int> &b) {
+  std::vector<int> c(a.size());
+  for (size_t i = 0; i < a.size(); ++i) {
+    c[i] = a[i] | b[i];
+  }
+  return c;
+}
+
+std::vector<bool> collinearEach(const std::vector<double> &a, const std::vector<std::vector<double>> &b) {
+  std::vector<bool> result(b.size());
+  for (size_t k = 0; k < b.size(); ++k) {
+    result[k] = collinear(a, b[k]);
+  }
+  return result;
+}
+
+} // namespace loops
+
+struct Variant {
+  std::string name;
+  bool loop;
+  kernels::Isa isa;
+};
+
+// One row: amount / 1e9 per second (GB/s unless said otherwise) of each
+// variant for one operation and length.
+template <class Loop, class Kernel>
+void Row(const char *operation, size_t n, double amount, const std::vector<Variant> &variants,
+         Loop &&loop, Kernel &&kernel) {
+  std::printf("%-18s %10zu", operation, n);
+  for (const auto &variant : variants) {
+    kernels::setActiveIsa(variant.isa);
+    double seconds = variant.loop ? Measure(loop) : Measure(kernel);
+    std::printf(" %10.2f", amount / seconds * 1e-9);
+  }
+  std::printf("\n");
+  std::fflush(stdout);
+  kernels::setActiveIsa(kernels::detectedIsa());
+}
+
+} // namespace
+
+// GB/s moved by each operator, counting the operands read and the result
+// written, for the plain loops and each kernel table. Operators that
+// return a vector include its allocation. An optional argument caps the
+// length; the largest one needs about 2.5 GB.
+int main(int argc, char **argv) {
+  size_t max_length = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 100000000;
+
+  std::vector<Variant> variants = {{"loop", true, kernels::Isa::kScalar}};
+  for (auto isa : {kernels::Isa::kScalar, kernels::Isa::kAvx2, kernels::Isa::kAvx512}) {
+    if (kernels::supported(isa)) {
+      variants.push_back({kernels::isaName(isa), false, isa});
+    }
+  }
+  auto header = [&](const char *unit, const char *length) {
+    std::printf("%-18s %10s", unit, length);
+    for (const auto &variant : variants) {
+      std::printf(" %10s", variant.name.c_str());
+    }
+    std::printf("\n");
+  };
+  header("GB/s", "length");
+
+  std::mt19937 rand(42);
+  std::uniform_real_distribution<double> dist(-10., 10.);
+  for (size_t n : {16ul, 256ul, 4096ul, 65536ul, 1000000ul, 10000000ul, 100000000ul}) {
+    if (n > max_length) {
+      break;
+    }
+    std::vector<double> a(n), b(n), c(n);
+    for (size_t i = 0; i < n; ++i) {
+      a[i] = dist(rand);
+      b[i] = dist(rand);
+      c[i] = dist(rand);
+    }
+    std::vector<int> x(n), y(n);
+    for (size_t i = 0; i < n; ++i) {
+      x[i] = static_cast<int>(rand());
+      y[i] = static_cast<int>(rand());
+    }
+
+    Row("a + b", n, 24. * n, variants,
+        [&] { auto c = loops::add(a, b); DoNotOptimize(c.data()); },
+        [&] { std::vector<double> c = a + b; DoNotOptimize(c.data()); });
+    std::vector<double> out(n);
+    Row("addInto(out, a, b)", n, 24. * n, variants,
+        [&] { auto c = loops::add(a, b); DoNotOptimize(c.data()); },
+        [&] { addInto(out, a, b); DoNotOptimize(out.data()); });
+    Row("-a", n, 16. * n, variants,
+        [&] { auto c = loops::negate(a); DoNotOptimize(c.data()); },
+        [&] { std::vector<double> c = -a; DoNotOptimize(c.data()); });
+    Row("a * b", n, 16. * n, variants,
+        [&] { DoNotOptimize(loops::dot(a, b)); },
+        [&] { DoNotOptimize(a * b); });
+    Row("compensatedDot", n, 16. * n, variants,
+        [&] { DoNotOptimize(loops::dot(a, b)); },
+        [&] { DoNotOptimize(compensatedDot(a, b)); });
+    // Chains: the loop column evaluates one operator at a time.
+    Row("a + b - c", n, 32. * n, variants,
+        [&] {
+          auto t = loops::add(a, b), d = loops::sub(t, c);
+          DoNotOptimize(d.data());
+        },
+        [&] { std::vector<double> d = a + b - c; DoNotOptimize(d.data()); });
+    Row("(a - b) * (a - b)", n, 16. * n, variants,
+        [&] {
+          auto d = loops::sub(a, b);
+          DoNotOptimize(loops::dot(d, d));
+        },
+        [&] { DoNotOptimize((a - b) * (a - b)); });
+    Row("x | y", n, 12. * n, variants,
+        [&] { auto c = loops::bitOr(x, y); DoNotOptimize(c.data()); },
+        [&] { auto c = x | y; DoNotOptimize(c.data()); });
+  }
+
+  // 10^6 collinearity checks of one vector against others, a third of
+  // them collinear, a third off in the last element and a third random.
+  header("Mpairs/s", "dimension");
+  const size_t pairs = 1000000;
+  for (size_t n : {3ul, 16ul, 64ul}) {
+    if (n * pairs > max_length) {
+      break;
+    }
+    std::vector<double> a(n);
+    for (auto &item : a) {
+      item = dist(rand);
+    }
+    std::vector<std::vector<double>> many(pairs);
+    for (size_t k = 0; k < pairs; ++k) {
+      double mult = dist(rand);
+      for (size_t i = 0; i < n; ++i) {
+        many[k].push_back(k % 3 == 2 ? dist(rand) : a[i] * mult);
+      }
+      if (k % 3 == 1) {
+        many[k].back() += 1.;
+      }
+    }
+    Row("a || b", n, 1e3 * pairs, variants,
+        [&] {
+          size_t count = 0;
+          for (const auto &b : many) {
+            count += loops::collinear(a, b);
+          }
+          DoNotOptimize(count);
+        },
+        [&] {
+          size_t count = 0;
+          for (const auto &b : many) {
+            count += a || b;
+          }
+          DoNotOptimize(count);
+        });
+    Row("a && b", n, 1e3 * pairs, variants,
+        [&] {
+          size_t count = 0;
+          for (const auto &b : many) {
+            count += loops::codirectional(a, b);
+          }
+          DoNotOptimize(count);
+        },
+        [&] {
+          size_t count = 0;
+          for (const auto &b : many) {
+            count += a && b;
+          }
+          DoNotOptimize(count);
+        });
+    Row("collinearEach", n, 1e3 * pairs, variants,
+        [&] { auto result = loops::collinearEach(a, many); DoNotOptimize(result.size()); },
+        [&] { auto result = collinearEach(a, many); DoNotOptimize(result.size()); });
+  }
+
+  // 3-D vectors, std::vector<double> each in the loop column, against
+  // the batches over structures of arrays and Vec3 by value (the same in
+  // every column). 1000 stay in cache, 10^6 do not.
+  header("Mvectors/s", "count");
+  for (size_t count : {1000ul, 1000000ul}) {
+    std::vector<std::vector<double>> vecs(count), vecs2(count);
+    std::vector<Vec3> points(count), points2(count);
+    Vec3Array batch(count), batch2(count), crosses(count);
+    std::vector<double> values(count);
+    for (size_t i = 0; i < count; ++i) {
+      Vec3 p = {dist(rand), dist(rand), dist(rand)}, q = {dist(rand), dist(rand), dist(rand)};
+      vecs[i] = {p.x, p.y, p.z};
+      vecs2[i] = {q.x, q.y, q.z};
+      points[i] = p;
+      points2[i] = q;
+      batch.set(i, p);
+      batch2.set(i, q);
+    }
+    auto vector_cross = [&] {
+      for (size_t i = 0; i < count; ++i) {
+        auto c = vecs[i] % vecs2[i];
+        DoNotOptimize(c.data());
+      }
+    };
+    Row("cross, batch", count, 1e3 * count, variants, vector_cross, [&] {
+      cross(batch.span(), batch2.span(), crosses.span());
+      DoNotOptimize(crosses.span().x);
+    });
+    Row("cross, Vec3", count, 1e3 * count, variants, vector_cross, [&] {
+      for (size_t i = 0; i < count; ++i) {
+        Vec3 c = points[i] % points2[i];
+        DoNotOptimize(c);
+      }
+    });
+    Row("dot, batch", count, 1e3 * count, variants,
+        [&] {
+          for (size_t i = 0; i < count; ++i) {
+            values[i] = vecs[i] * vecs2[i];
+          }
+          DoNotOptimize(values.data());
+        },
+        [&] {
+          dot(batch.span(), batch2.span(), values.data());
+          DoNotOptimize(values.data());
+        });
+    Row("norm, batch", count, 1e3 * count, variants,
+        [&] {
+          for (size_t i = 0; i < count; ++i) {
+            values[i] = std::sqrt(vecs[i] * vecs[i]);
+          }
+          DoNotOptimize(values.data());
+        },
+        [&] {
+          norm(batch.span(), values.data());
+          DoNotOptimize(values.data());
+        });
+  }
+}
@@ -0,0 +1,583 @@
+#pragma once
+
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define TASK_KERNELS_X86
+#include <immintrin.h>
+#endif
+
+namespace task {
+namespace kernels {
+
+// Element-wise kernels behind the vector operators, compiled for several
+// instruction sets in this header and picked at run time, so no -m flags
+// are needed. Everything is inline to keep vector_ops.h header-only.
+
+enum class Isa { kScalar, kAvx2, kAvx512 };
+
+struct Table {
+  void (*add)(double *c, const double *a, const double *b, size_t n);  // c = a + b
+  void (*sub)(double *c, const double *a, const double *b, size_t n);  // c = a - b
+  void (*negate)(double *c, const double *a, size_t n);                // c = -a
+  void (*scale)(double *c, const double *a, double factor, size_t n);  // c = a * factor
+  double (*dot)(const double *a, const double *b, size_t n);
+  double (*compensated_dot)(const double *a, const double *b, size_t n);
+  // Whether b[i] == 0 exactly where a[i] == 0, and |a[i] - alpha * b[i]| <
+  // eps * |b[i]| elsewhere. The vector versions check branch-free in blocks
+  // of PROPORTIONAL_BLOCK elements, stopping after the first that fails.
+  bool (*proportional)(const double *a, const double *b, double alpha, double eps, size_t n);
+  void (*bit_or)(int *c, const int *a, const int *b, size_t n);        // c = a | b
+  void (*bit_and)(int *c, const int *a, const int *b, size_t n);       // c = a & b
+  // n 3-D vectors as structures of arrays: a[0], a[1] and a[2] hold the x,
+  // y and z coordinates. c may be a or b.
+  void (*cross3)(const double *const *a, const double *const *b, double *const *c, size_t n);  // c = a x b
+  void (*dot3)(const double *const *a, const double *const *b, double *c, size_t n);           // c = a . b
+  void (*norm3)(const double *const *a, double *c, size_t n);                                  // c = |a|
+};
+
+const size_t PROPORTIONAL_BLOCK = 256;
+
+// Error-free transformations for the compensated dot product: a + b and
+// a * b as a rounded result plus its exact rounding error.
+inline void twoSum(double a, double b, double &sum, double &error) {
+  sum = a + b;
+  double z = sum - a;
+  error = (a - (sum - z)) + (b - z);
+}
+
+inline void twoProduct(double a, double b, double &product, double &error) {
+  product = a * b;
+  error = std::fma(a, b, -product);
+}
+
+// Portable loops. The dot product keeps four partial sums, which both
+// lets additions overlap and shortens the chains rounding errors build
+// up along.
+
+inline void addScalar(double *c, const double *a, const double *b, size_t n) {
+  for (size_t i = 0; i < n; ++i) {
+    c[i] = a[i] + b[i];
+  }
+}
+
+inline void subScalar(double *c, const double *a, const double *b, size_t n) {
+  for (size_t i = 0; i < n; ++i) {
+    c[i] = a[i] - b[i];
+  }
+}
+
+inline void negateScalar(double *c, const double *a, size_t n) {
+  for (size_t i = 0; i < n; ++i) {
+    c[i] = -a[i];
+  }
+}
+
+inline void scaleScalar(double *c, const double *a, double factor, size_t n) {
+  for (size_t i = 0; i < n; ++i) {
+    c[i] = a[i] * factor;
+  }
+}
+
+inline double dotScalar(const double *a, const double *b, size_t n) {
+  double sum[4] = {};
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    for (size_t k = 0; k < 4; ++k) {
+      sum[k] += a[i + k] * b[i + k];
+    }
+  }
+  for (; i < n; ++i) {
+    sum[0] += a[i] * b[i];
+  }
+  return (sum[0] + sum[1]) + (sum[2] + sum[3]);
+}
+
+// Dot2 of Ogita, Rump and Oishi (2005): as accurate as if computed in
+// twice the working precision, then rounded. The state is a running sum
+// and the accumulated rounding errors, added together at the end.
+inline void compensatedDotStep(const double *a, const double *b, size_t n, double &sum, double &error) {
+  for (size_t i = 0; i < n; ++i) {
+    double product, product_error, sum_error;
+    twoProduct(a[i], b[i], product, product_error);
+    twoSum(sum, product, sum, sum_error);
+    error += sum_error + product_error;
+  }
+}
+
+inline double compensatedDotScalar(const double *a, const double *b, size_t n) {
+  double sum = 0., error = 0.;
+  compensatedDotStep(a, b, n, sum, error);
+  return sum + error;
+}
+
+// Merges per-lane Dot2 states into one result.
+inline double mergeCompensated(const double *sums, const double *errors, size_t lanes) {
+  double sum = 0., error = 0.;
+  for (size_t k = 0; k < lanes; ++k) {
+    double sum_error;
+    twoSum(sum, sums[k], sum, sum_error);
+    error += sum_error + errors[k];
+  }
+  return sum + error;
+}
+
+inline bool proportionalScalar(const double *a, const double *b, double alpha, double eps, size_t n) {
+  for (size_t i = 0; i < n; ++i) {
+    bool a_zero = a[i] == 0., b_zero = b[i] == 0.;
+    if (a_zero != b_zero || (!a_zero && !(std::fabs(a[i] - alpha * b[i]) < eps * std::fabs(b[i])))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+inline void orScalar(int *c, const int *a, const int *b, size_t n) {
+  for (size_t i = 0; i < n; ++i) {
+    c[i] = a[i] | b[i];
+  }
+}
+
+inline void andScalar(int *c, const int *a, const int *b, size_t n) {
+  for (size_t i = 0; i < n; ++i) {
+    c[i] = a[i] & b[i];
+  }
+}
+
+// The same formulas as Vec3. Results of the tables agree up to rounding:
+// where the target has FMA, the compiler may fuse a multiply and an add.
+inline void cross3Scalar(const double *const *a, const double *const *b, double *const *c, size_t n) {
+  for (size_t i = 0; i < n; ++i) {
+    double ax = a[0][i], ay = a[1][i], az = a[2][i];
+    double bx = b[0][i], by = b[1][i], bz = b[2][i];
+    c[0][i] = ay * bz - az * by;
+    c[1][i] = az * bx - ax * bz;
+    c[2][i] = ax * by - ay * bx;
+  }
+}
+
+inline void dot3Scalar(const double *const *a, const double *const *b, double *c, size_t n) {
+  for (size_t i = 0; i < n; ++i) {
+    c[i] = a[0][i] * b[0][i] + a[1][i] * b[1][i] + a[2][i] * b[2][i];
+  }
+}
+
+inline void norm3Scalar(const double *const *a, double *c, size_t n) {
+  for (size_t i = 0; i < n; ++i) {
+    c[i] = std::sqrt(a[0][i] * a[0][i] + a[1][i] * a[1][i] + a[2][i] * a[2][i]);
+  }
+}
+
+#ifdef TASK_KERNELS_X86
+
+__attribute__((target("avx2"))) inline void addAvx2(double *c, const double *a, const double *b, size_t n) {
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    _mm256_storeu_pd(c + i, _mm256_add_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i)));
+  }
+  addScalar(c + i, a + i, b + i, n - i);
+}
+
+__attribute__((target("avx2"))) inline void subAvx2(double *c, const double *a, const double *b, size_t n) {
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    _mm256_storeu_pd(c + i, _mm256_sub_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i)));
+  }
+  subScalar(c + i, a + i, b + i, n - i);
+}
+
+__attribute__((target("avx2"))) inline void negateAvx2(double *c, const double *a, size_t n) {
+  const __m256d sign = _mm256_set1_pd(-0.);
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    _mm256_storeu_pd(c + i, _mm256_xor_pd(_mm256_loadu_pd(a + i), sign));
+  }
+  negateScalar(c + i, a + i, n - i);
+}
+
+__attribute__((target("avx2"))) inline void scaleAvx2(double *c, const double *a, double factor, size_t n) {
+  const __m256d f = _mm256_set1_pd(factor);
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    _mm256_storeu_pd(c + i, _mm256_mul_pd(_mm256_loadu_pd(a + i), f));
+  }
+  scaleScalar(c + i, a + i, factor, n - i);
+}
+
+// Four accumulators of four lanes: sixteen partial sums.
+__attribute__((target("avx2,fma"))) inline double dotAvx2(const double *a, const double *b, size_t n) {
+  __m256d acc0 = _mm256_setzero_pd(), acc1 = _mm256_setzero_pd();
+  __m256d acc2 = _mm256_setzero_pd(), acc3 = _mm256_setzero_pd();
+  size_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    acc0 = _mm256_fmadd_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i), acc0);
+    acc1 = _mm256_fmadd_pd(_mm256_loadu_pd(a + i + 4), _mm256_loadu_pd(b + i + 4), acc1);
+    acc2 = _mm256_fmadd_pd(_mm256_loadu_pd(a + i + 8), _mm256_loadu_pd(b + i + 8), acc2);
+    acc3 = _mm256_fmadd_pd(_mm256_loadu_pd(a + i + 12), _mm256_loadu_pd(b + i + 12), acc3);
+  }
+  for (; i + 4 <= n; i += 4) {
+    acc0 = _mm256_fmadd_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i), acc0);
+  }
+  __m256d acc = _mm256_add_pd(_mm256_add_pd(acc0, acc1), _mm256_add_pd(acc2, acc3));
+  double lanes[4];
+  _mm256_storeu_pd(lanes, acc);
+  return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]) + dotScalar(a + i, b + i, n - i);
+}
+
+__attribute__((target("avx2,fma"))) inline double compensatedDotAvx2(const double *a, const double *b, size_t n) {
+  __m256d sum = _mm256_setzero_pd(), error = _mm256_setzero_pd();
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    __m256d x = _mm256_loadu_pd(a + i), y = _mm256_loadu_pd(b + i);
+    __m256d product = _mm256_mul_pd(x, y);
+    __m256d product_error = _mm256_fmsub_pd(x, y, product);
+    __m256d new_sum = _mm256_add_pd(sum, product);
+    __m256d z = _mm256_sub_pd(new_sum, sum);
+    __m256d sum_error = _mm256_add_pd(_mm256_sub_pd(sum, _mm256_sub_pd(new_sum, z)), _mm256_sub_pd(product, z));
+    sum = new_sum;
+    error = _mm256_add_pd(error, _mm256_add_pd(sum_error, product_error));
+  }
+  double sums[5], errors[5];
+  _mm256_storeu_pd(sums, sum);
+  _mm256_storeu_pd(errors, error);
+  sums[4] = errors[4] = 0.;
+  compensatedDotStep(a + i, b + i, n - i, sums[4], errors[4]);
+  return mergeCompensated(sums, errors, 5);
+}
+
+__attribute__((target("avx2"))) inline bool proportionalAvx2(const double *a, const double *b, double alpha,
+                                                             double eps, size_t n) {
+  const __m256d zero = _mm256_setzero_pd(), sign = _mm256_set1_pd(-0.);
+  const __m256d va = _mm256_set1_pd(alpha), ve = _mm256_set1_pd(eps);
+  size_t i = 0;
+  while (i + 4 <= n) {
+    size_t end = n - i > PROPORTIONAL_BLOCK ? i + PROPORTIONAL_BLOCK : n;
+    __m256d bad = zero;
+    for (; i + 4 <= end; i += 4) {
+      __m256d x = _mm256_loadu_pd(a + i), y = _mm256_loadu_pd(b + i);
+      __m256d x_zero = _mm256_cmp_pd(x, zero, _CMP_EQ_OQ), y_zero = _mm256_cmp_pd(y, zero, _CMP_EQ_OQ);
+      __m256d diff = _mm256_andnot_pd(sign, _mm256_sub_pd(x, _mm256_mul_pd(va, y)));
+      __m256d limit = _mm256_mul_pd(ve, _mm256_andnot_pd(sign, y));
+      __m256d far = _mm256_cmp_pd(diff, limit, _CMP_NLT_UQ);
+      bad = _mm256_or_pd(bad, _mm256_or_pd(_mm256_xor_pd(x_zero, y_zero), _mm256_andnot_pd(x_zero, far)));
+    }
+    if (_mm256_movemask_pd(bad) != 0) {
+      return false;
+    }
+  }
+  return proportionalScalar(a + i, b + i, alpha, eps, n - i);
+}
+
+__attribute__((target("avx2"))) inline void orAvx2(int *c, const int *a, const int *b, size_t n) {
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + i));
+    __m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + i));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(c + i), _mm256_or_si256(x, y));
+  }
+  orScalar(c + i, a + i, b + i, n - i);
+}
+
+__attribute__((target("avx2"))) inline void andAvx2(int *c, const int *a, const int *b, size_t n) {
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + i));
+    __m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + i));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(c + i), _mm256_and_si256(x, y));
+  }
+  andScalar(c + i, a + i, b + i, n - i);
+}
+
+__attribute__((target("avx2"))) inline void cross3Avx2(const double *const *a, const double *const *b,
+                                                       double *const *c, size_t n) {
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    __m256d ax = _mm256_loadu_pd(a[0] + i), ay = _mm256_loadu_pd(a[1] + i), az = _mm256_loadu_pd(a[2] + i);
+    __m256d bx = _mm256_loadu_pd(b[0] + i), by = _mm256_loadu_pd(b[1] + i), bz = _mm256_loadu_pd(b[2] + i);
+    _mm256_storeu_pd(c[0] + i, _mm256_sub_pd(_mm256_mul_pd(ay, bz), _mm256_mul_pd(az, by)));
+    _mm256_storeu_pd(c[1] + i, _mm256_sub_pd(_mm256_mul_pd(az, bx), _mm256_mul_pd(ax, bz)));
+    _mm256_storeu_pd(c[2] + i, _mm256_sub_pd(_mm256_mul_pd(ax, by), _mm256_mul_pd(ay, bx)));
+  }
+  const double *const a_rest[3] = {a[0] + i, a[1] + i, a[2] + i}, *const b_rest[3] = {b[0] + i, b[1] + i, b[2] + i};
+  double *const c_rest[3] = {c[0] + i, c[1] + i, c[2] + i};
+  cross3Scalar(a_rest, b_rest, c_rest, n - i);
+}
+
+__attribute__((target("avx2"))) inline __m256d dot3Avx2At(const double *const *a, const double *const *b, size_t i) {
+  __m256d xx = _mm256_mul_pd(_mm256_loadu_pd(a[0] + i), _mm256_loadu_pd(b[0] + i));
+  __m256d yy = _mm256_mul_pd(_mm256_loadu_pd(a[1] + i), _mm256_loadu_pd(b[1] + i));
+  __m256d zz = _mm256_mul_pd(_mm256_loadu_pd(a[2] + i), _mm256_loadu_pd(b[2] + i));
+  return _mm256_add_pd(_mm256_add_pd(xx, yy), zz);
+}
+
+__attribute__((target("avx2"))) inline void dot3Avx2(const double *const *a, const double *const *b, double *c,
+                                                     size_t n) {
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    _mm256_storeu_pd(c + i, dot3Avx2At(a, b, i));
+  }
+  const double *const a_rest[3] = {a[0] + i, a[1] + i, a[2] + i}, *const b_rest[3] = {b[0] + i, b[1] + i, b[2] + i};
+  dot3Scalar(a_rest, b_rest, c + i, n - i);
+}
+
+__attribute__((target("avx2"))) inline void norm3Avx2(const double *const *a, double *c, size_t n) {
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    _mm256_storeu_pd(c + i, _mm256_sqrt_pd(dot3Avx2At(a, a, i)));
+  }
+  const double *const a_rest[3] = {a[0] + i, a[1] + i, a[2] + i};
+  norm3Scalar(a_rest, c + i, n - i);
+}
+
+// AVX-512 handles the tail with a masked iteration instead of a scalar loop.
+
+__attribute__((target("avx512f"))) inline __mmask8 tailMask(size_t rest) {
+  return static_cast<__mmask8>((1u << rest) - 1);
+}
+
+__attribute__((target("avx512f"))) inline void addAvx512(double *c, const double *a, const double *b, size_t n) {
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    _mm512_storeu_pd(c + i, _mm512_add_pd(_mm512_loadu_pd(a + i), _mm512_loadu_pd(b + i)));
+  }
+  if (i < n) {
+    __mmask8 mask = tailMask(n - i);
+    __m512d sum = _mm512_add_pd(_mm512_maskz_loadu_pd(mask, a + i), _mm512_maskz_loadu_pd(mask, b + i));
+    _mm512_mask_storeu_pd(c + i, mask, sum);
+  }
+}
+
+__attribute__((target("avx512f"))) inline void subAvx512(double *c, const double *a, const double *b, size_t n) {
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    _mm512_storeu_pd(c + i, _mm512_sub_pd(_mm512_loadu_pd(a + i), _mm512_loadu_pd(b + i)));
+  }
+  if (i < n) {
+    __mmask8 mask = tailMask(n - i);
+    __m512d diff = _mm512_sub_pd(_mm512_maskz_loadu_pd(mask, a + i), _mm512_maskz_loadu_pd(mask, b + i));
+    _mm512_mask_storeu_pd(c + i, mask, diff);
+  }
+}
+
+__attribute__((target("avx512f"))) inline void negateAvx512(double *c, const double *a, size_t n) {
+  const __m512i sign = _mm512_set1_epi64(static_cast<long long>(0x8000000000000000ull));
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m512i x = _mm512_castpd_si512(_mm512_loadu_pd(a + i));
+    _mm512_storeu_pd(c + i, _mm512_castsi512_pd(_mm512_xor_si512(x, sign)));
+  }
+  if (i < n) {
+    __mmask8 mask = tailMask(n - i);
+    __m512i x = _mm512_castpd_si512(_mm512_maskz_loadu_pd(mask, a + i));
+    _mm512_mask_storeu_pd(c + i, mask, _mm512_castsi512_pd(_mm512_xor_si512(x, sign)));
+  }
+}
+
+__attribute__((target("avx512f"))) inline void scaleAvx512(double *c, const double *a, double factor, size_t n) {
+  const __m512d f = _mm512_set1_pd(factor);
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    _mm512_storeu_pd(c + i, _mm512_mul_pd(_mm512_loadu_pd(a + i), f));
+  }
+  if (i < n) {
+    __mmask8 mask = tailMask(n - i);
+    _mm512_mask_storeu_pd(c + i, mask, _mm512_mul_pd(_mm512_maskz_loadu_pd(mask, a + i), f));
+  }
+}
+
+// Four accumulators of eight lanes: thirty-two partial sums.
+__attribute__((target("avx512f"))) inline double dotAvx512(const double *a, const double *b, size_t n) {
+  __m512d acc0 = _mm512_setzero_pd(), acc1 = _mm512_setzero_pd();
+  __m512d acc2 = _mm512_setzero_pd(), acc3 = _mm512_setzero_pd();
+  size_t i = 0;
+  for (; i + 32 <= n; i += 32) {
+    acc0 = _mm512_fmadd_pd(_mm512_loadu_pd(a + i), _mm512_loadu_pd(b + i), acc0);
+    acc1 = _mm512_fmadd_pd(_mm512_loadu_pd(a + i + 8), _mm512_loadu_pd(b + i + 8), acc1);
+    acc2 = _mm512_fmadd_pd(_mm512_loadu_pd(a + i + 16), _mm512_loadu_pd(b + i + 16), acc2);
+    acc3 = _mm512_fmadd_pd(_mm512_loadu_pd(a + i + 24), _mm512_loadu_pd(b + i + 24), acc3);
+  }
+  for (; i + 8 <= n; i += 8) {
+    acc0 = _mm512_fmadd_pd(_mm512_loadu_pd(a + i), _mm512_loadu_pd(b + i), acc0);
+  }
+  if (i < n) {
+    __mmask8 mask = tailMask(n - i);
+    acc1 = _mm512_fmadd_pd(_mm512_maskz_loadu_pd(mask, a + i), _mm512_maskz_loadu_pd(mask, b + i), acc1);
+  }
+  // Through memory like the AVX2 kernel: _mm512_reduce_add_pd extracts
+  // halves into undefined registers, which GCC warns about.
+  double lanes[8];
+  _mm512_storeu_pd(lanes, _mm512_add_pd(_mm512_add_pd(acc0, acc1), _mm512_add_pd(acc2, acc3)));
+  return ((lanes[0] + lanes[1]) + (lanes[2] + lanes[3])) + ((lanes[4] + lanes[5]) + (lanes[6] + lanes[7]));
+}
+
+__attribute__((target("avx512f"))) inline double compensatedDotAvx512(const double *a, const double *b, size_t n) {
+  __m512d sum = _mm512_setzero_pd(), error = _mm512_setzero_pd();
+  for (size_t i = 0; i < n; i += 8) {
+    __mmask8 mask = n - i >= 8 ? static_cast<__mmask8>(0xff) : tailMask(n - i);
+    __m512d x = _mm512_maskz_loadu_pd(mask, a + i), y = _mm512_maskz_loadu_pd(mask, b + i);
+    __m512d product = _mm512_mul_pd(x, y);
+    __m512d product_error = _mm512_fmsub_pd(x, y, product);
+    __m512d new_sum = _mm512_add_pd(sum, product);
+    __m512d z = _mm512_sub_pd(new_sum, sum);
+    __m512d sum_error = _mm512_add_pd(_mm512_sub_pd(sum, _mm512_sub_pd(new_sum, z)), _mm512_sub_pd(product, z));
+    sum = new_sum;
+    error = _mm512_add_pd(error, _mm512_add_pd(sum_error, product_error));
+  }
+  double sums[8], errors[8];
+  _mm512_storeu_pd(sums, sum);
+  _mm512_storeu_pd(errors, error);
+  return mergeCompensated(sums, errors, 8);
+}
+
+__attribute__((target("avx512f"))) inline bool proportionalAvx512(const double *a, const double *b, double alpha,
+                                                                  double eps, size_t n) {
+  const __m512d zero = _mm512_setzero_pd(), va = _mm512_set1_pd(alpha), ve = _mm512_set1_pd(eps);
+  for (size_t i = 0; i < n;) {
+    size_t end = n - i > PROPORTIONAL_BLOCK ? i + PROPORTIONAL_BLOCK : n;
+    __mmask8 bad = 0;
+    for (; i < end; i += 8) {
+      __mmask8 mask = end - i >= 8 ? static_cast<__mmask8>(0xff) : tailMask(end - i);
+      __m512d x = _mm512_maskz_loadu_pd(mask, a + i), y = _mm512_maskz_loadu_pd(mask, b + i);
+      __mmask8 x_zero = _mm512_cmp_pd_mask(x, zero, _CMP_EQ_OQ), y_zero = _mm512_cmp_pd_mask(y, zero, _CMP_EQ_OQ);
+      __m512d diff = _mm512_abs_pd(_mm512_sub_pd(x, _mm512_mul_pd(va, y)));
+      __mmask8 far = _mm512_cmp_pd_mask(diff, _mm512_mul_pd(ve, _mm512_abs_pd(y)), _CMP_NLT_UQ);
+      bad |= (x_zero ^ y_zero) | (~x_zero & far);
+    }
+    if (bad != 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+__attribute__((target("avx512f"))) inline void cross3Avx512(const double *const *a, const double *const *b,
+                                                            double *const *c, size_t n) {
+  for (size_t i = 0; i < n; i += 8) {
+    __mmask8 mask = n - i >= 8 ? static_cast<__mmask8>(0xff) : tailMask(n - i);
+    __m512d ax = _mm512_maskz_loadu_pd(mask, a[0] + i), ay = _mm512_maskz_loadu_pd(mask, a[1] + i);
+    __m512d az = _mm512_maskz_loadu_pd(mask, a[2] + i), bx = _mm512_maskz_loadu_pd(mask, b[0] + i);
+    __m512d by = _mm512_maskz_loadu_pd(mask, b[1] + i), bz = _mm512_maskz_loadu_pd(mask, b[2] + i);
+    _mm512_mask_storeu_pd(c[0] + i, mask, _mm512_sub_pd(_mm512_mul_pd(ay, bz), _mm512_mul_pd(az, by)));
+    _mm512_mask_storeu_pd(c[1] + i, mask, _mm512_sub_pd(_mm512_mul_pd(az, bx), _mm512_mul_pd(ax, bz)));
+    _mm512_mask_storeu_pd(c[2] + i, mask, _mm512_sub_pd(_mm512_mul_pd(ax, by), _mm512_mul_pd(ay, bx)));
+  }
+}
+
+__attribute__((target("avx512f"))) inline __m512d dot3Avx512At(const double *const *a, const double *const *b,
+                                                               size_t i, __mmask8 mask) {
+  __m512d xx = _mm512_mul_pd(_mm512_maskz_loadu_pd(mask, a[0] + i), _mm512_maskz_loadu_pd(mask, b[0] + i));
+  __m512d yy = _mm512_mul_pd(_mm512_maskz_loadu_pd(mask, a[1] + i), _mm512_maskz_loadu_pd(mask, b[1] + i));
+  __m512d zz = _mm512_mul_pd(_mm512_maskz_loadu_pd(mask, a[2] + i), _mm512_maskz_loadu_pd(mask, b[2] + i));
+  return _mm512_add_pd(_mm512_add_pd(xx, yy), zz);
+}
+
+__attribute__((target("avx512f"))) inline void dot3Avx512(const double *const *a, const double *const *b, double *c,
+                                                          size_t n) {
+  for (size_t i = 0; i < n; i += 8) {
+    __mmask8 mask = n - i >= 8 ? static_cast<__mmask8>(0xff) : tailMask(n - i);
+    _mm512_mask_storeu_pd(c + i, mask, dot3Avx512At(a, b, i, mask));
+  }
+}
+
+__attribute__((target("avx512f"))) inline void norm3Avx512(const double *const *a, double *c, size_t n) {
+  for (size_t i = 0; i < n; i += 8) {
+    __mmask8 mask = n - i >= 8 ? static_cast<__mmask8>(0xff) : tailMask(n - i);
+    _mm512_mask_storeu_pd(c + i, mask, _mm512_maskz_sqrt_pd(mask, dot3Avx512At(a, a, i, mask)));
+  }
+}
+
+__attribute__((target("avx512f"))) inline void orAvx512(int *c, const int *a, const int *b, size_t n) {
+  size_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    _mm512_storeu_si512(c + i, _mm512_or_si512(_mm512_loadu_si512(a + i), _mm512_loadu_si512(b + i)));
+  }
+  orScalar(c + i, a + i, b + i, n - i);
+}
+
+__attribute__((target("avx512f"))) inline void andAvx512(int *c, const int *a, const int *b, size_t n) {
+  size_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    _mm512_storeu_si512(c + i, _mm512_and_si512(_mm512_loadu_si512(a + i), _mm512_loadu_si512(b + i)));
+  }
+  andScalar(c + i, a + i, b + i, n - i);
+}
+
+#endif // TASK_KERNELS_X86
+
+inline const char *isaName(Isa isa) {
+  switch (isa) {
+    case Isa::kAvx2:
+      return "avx2";
+    case Isa::kAvx512:
+      return "avx512";
+    default:
+      return "scalar";
+  }
+}
+
+// Whether the running CPU can execute the kernels built for isa. The AVX2
+// table also needs FMA for the dot products.
+inline bool supported(Isa isa) {
+#ifdef TASK_KERNELS_X86
+  switch (isa) {
+    case Isa::kAvx2:
+      return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+    case Isa::kAvx512:
+      return __builtin_cpu_supports("avx512f");
+    default:
+      return true;
+  }
+#else
+  return isa == Isa::kScalar;
+#endif
+}
+
+inline Isa detectedIsa() {
+  static const Isa isa = supported(Isa::kAvx512) ? Isa::kAvx512 : supported(Isa::kAvx2) ? Isa::kAvx2 : Isa::kScalar;
+  return isa;
+}
+
+// Kernel table for isa, which must be supported.
+inline const Table &table(Isa isa) {
+  static const Table SCALAR = {addScalar, subScalar, negateScalar, scaleScalar, dotScalar, compensatedDotScalar,
+                               proportionalScalar, orScalar, andScalar, cross3Scalar, dot3Scalar, norm3Scalar};
+#ifdef TASK_KERNELS_X86
+  static const Table AVX2 = {addAvx2, subAvx2, negateAvx2, scaleAvx2, dotAvx2, compensatedDotAvx2,
+                             proportionalAvx2, orAvx2, andAvx2, cross3Avx2, dot3Avx2, norm3Avx2};
+  static const Table AVX512 = {addAvx512, subAvx512, negateAvx512, scaleAvx512, dotAvx512, compensatedDotAvx512,
+                               proportionalAvx512, orAvx512, andAvx512, cross3Avx512, dot3Avx512, norm3Avx512};
+  switch (isa) {
+    case Isa::kAvx2:
+      return AVX2;
+    case Isa::kAvx512:
+      return AVX512;
+    default:
+      break;
+  }
+#endif
+  return SCALAR;
+}
+
+inline std::atomic<Isa> &activeSlot() {
+  static std::atomic<Isa> isa(detectedIsa());
+  return isa;
+}
+
+// The instruction set used by the operators: detectedIsa() unless
+// overridden, e.g. to compare variants. Unsupported ones fall back to it.
+inline Isa activeIsa() {
+  return activeSlot().load(std::memory_order_relaxed);
+}
+
+inline void setActiveIsa(Isa isa) {
+  activeSlot().store(supported(isa) ? isa : detectedIsa(), std::memory_order_relaxed);
+}
+
+inline const Table &active() {
+  return table(activeIsa());
+}
+
+} // namespace kernels
+} // namespace task
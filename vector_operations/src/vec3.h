@@ -0,0 +1,124 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <vector>
+#include "kernels.h"
+
+namespace task {
+
+// A 3-D vector by value, for single operations without the heap. % and *
+// are the cross and dot products, as for std::vector<double>.
+struct Vec3 {
+  double x, y, z;
+};
+
+inline Vec3 operator+(const Vec3 &a, const Vec3 &b) {
+  return {a.x + b.x, a.y + b.y, a.z + b.z};
+}
+
+inline Vec3 operator-(const Vec3 &a, const Vec3 &b) {
+  return {a.x - b.x, a.y - b.y, a.z - b.z};
+}
+
+inline Vec3 operator-(const Vec3 &a) {
+  return {-a.x, -a.y, -a.z};
+}
+
+inline Vec3 operator*(const Vec3 &a, double factor) {
+  return {a.x * factor, a.y * factor, a.z * factor};
+}
+
+inline Vec3 operator*(double factor, const Vec3 &a) {
+  return a * factor;
+}
+
+inline double operator*(const Vec3 &a, const Vec3 &b) {
+  return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+inline Vec3 operator%(const Vec3 &a, const Vec3 &b) {
+  return {a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x};
+}
+
+inline bool operator==(const Vec3 &a, const Vec3 &b) {
+  return a.x == b.x && a.y == b.y && a.z == b.z;
+}
+
+inline bool operator!=(const Vec3 &a, const Vec3 &b) {
+  return !(a == b);
+}
+
+inline double norm(const Vec3 &a) {
+  return std::sqrt(a * a);
+}
+
+// size 3-D vectors stored as structures of arrays, one array per
+// coordinate, which the batch functions below process with SIMD.
+struct ConstVec3Span {
+  const double *x, *y, *z;
+  size_t size;
+};
+
+struct Vec3Span {
+  double *x, *y, *z;
+  size_t size;
+
+  operator ConstVec3Span() const {
+    return {x, y, z, size};
+  }
+};
+
+// Owns the arrays of a batch.
+class Vec3Array {
+public:
+  explicit Vec3Array(size_t size = 0) : xs(size), ys(size), zs(size) {}
+
+  size_t size() const {
+    return xs.size();
+  }
+  void resize(size_t size) {
+    xs.resize(size);
+    ys.resize(size);
+    zs.resize(size);
+  }
+
+  Vec3 get(size_t i) const {
+    return {xs[i], ys[i], zs[i]};
+  }
+  void set(size_t i, const Vec3 &a) {
+    xs[i] = a.x;
+    ys[i] = a.y;
+    zs[i] = a.z;
+  }
+
+  Vec3Span span() {
+    return {xs.data(), ys.data(), zs.data(), xs.size()};
+  }
+  ConstVec3Span span() const {
+    return {xs.data(), ys.data(), zs.data(), xs.size()};
+  }
+
+private:
+  std::vector<double> xs, ys, zs;
+};
+
+// Element-wise over a.size vectors; b and out must hold at least as many.
+// Results match the Vec3 operators up to rounding. out may be a or b.
+inline void cross(const ConstVec3Span &a, const ConstVec3Span &b, const Vec3Span &out) {
+  const double *const as[3] = {a.x, a.y, a.z}, *const bs[3] = {b.x, b.y, b.z};
+  double *const outs[3] = {out.x, out.y, out.z};
+  kernels::active().cross3(as, bs, outs, a.size);
+}
+
+inline void dot(const ConstVec3Span &a, const ConstVec3Span &b, double *out) {
+  const double *const as[3] = {a.x, a.y, a.z}, *const bs[3] = {b.x, b.y, b.z};
+  kernels::active().dot3(as, bs, out, a.size);
+}
+
+inline void norm(const ConstVec3Span &a, double *out) {
+  const double *const as[3] = {a.x, a.y, a.z};
+  kernels::active().norm3(as, out, a.size);
+}
+
+} // namespace task
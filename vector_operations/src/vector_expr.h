@@ -0,0 +1,208 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include "kernels.h"
+
+namespace task {
+
+// Base of everything that can appear in a lazy element-wise expression over
+// std::vector<double>. Derived types provide size() and at(i); they are
+// evaluated in a single pass when converted to a std::vector<double>, so
+// a + b - c allocates only its result and reads every operand once.
+template<class E>
+class VectorExpr {
+public:
+  const E &self() const {
+    return static_cast<const E &>(*this);
+  }
+
+  size_t size() const {
+    return self().size();
+  }
+  double at(size_t i) const {
+    return self().at(i);
+  }
+
+  operator std::vector<double>() const;
+};
+
+// A std::vector<double> operand. Nodes hold their operands by value and
+// vectors through this reference, so an expression must not outlive the
+// vectors it was built from: bind results to std::vector<double>, not auto.
+class VectorRef : public VectorExpr<VectorRef> {
+public:
+  VectorRef(const std::vector<double> &vec) : vec(vec) {}
+
+  size_t size() const {
+    return vec.size();
+  }
+  double at(size_t i) const {
+    return vec[i];
+  }
+  const double *data() const {
+    return vec.data();
+  }
+
+private:
+  const std::vector<double> &vec;
+};
+
+struct VectorPlus {
+  static double apply(double a, double b) {
+    return a + b;
+  }
+};
+
+struct VectorMinus {
+  static double apply(double a, double b) {
+    return a - b;
+  }
+};
+
+template<class L, class R, class Op>
+class VectorBinaryExpr : public VectorExpr<VectorBinaryExpr<L, R, Op>> {
+public:
+  VectorBinaryExpr(const L &lhs, const R &rhs) : lhs(lhs), rhs(rhs) {}
+
+  size_t size() const {
+    return lhs.size();
+  }
+  double at(size_t i) const {
+    return Op::apply(lhs.at(i), rhs.at(i));
+  }
+
+  const L &left() const {
+    return lhs;
+  }
+  const R &right() const {
+    return rhs;
+  }
+
+private:
+  const L lhs;
+  const R rhs;
+};
+
+template<class E>
+class VectorNegatedExpr : public VectorExpr<VectorNegatedExpr<E>> {
+public:
+  explicit VectorNegatedExpr(const E &expr) : expr(expr) {}
+
+  size_t size() const {
+    return expr.size();
+  }
+  double at(size_t i) const {
+    return -expr.at(i);
+  }
+
+  const E &operand() const {
+    return expr;
+  }
+
+private:
+  const E expr;
+};
+
+// Writes expr.size() elements of expr to dst. Element-wise nodes only read
+// position i to write it, so dst may be one of the operands.
+template<class E>
+void evaluate(const E &expr, double *dst) {
+  size_t n = expr.size();
+  for (size_t i = 0; i < n; ++i) {
+    dst[i] = expr.at(i);
+  }
+}
+
+// Nodes over two vectors go through the SIMD kernels, as the eager
+// operators did.
+inline void evaluate(const VectorBinaryExpr<VectorRef, VectorRef, VectorPlus> &expr, double *dst) {
+  kernels::active().add(dst, expr.left().data(), expr.right().data(), expr.size());
+}
+
+inline void evaluate(const VectorBinaryExpr<VectorRef, VectorRef, VectorMinus> &expr, double *dst) {
+  kernels::active().sub(dst, expr.left().data(), expr.right().data(), expr.size());
+}
+
+inline void evaluate(const VectorNegatedExpr<VectorRef> &expr, double *dst) {
+  kernels::active().negate(dst, expr.operand().data(), expr.size());
+}
+
+template<class E>
+VectorExpr<E>::operator std::vector<double>() const {
+  std::vector<double> c(size());
+  evaluate(self(), c.data());
+  return c;
+}
+
+// Sum of a[i] * b[i] in one pass without materialising either side, in
+// four partial sums like the scalar dot kernel.
+template<class L, class R>
+double reduceDot(const L &a, const R &b) {
+  size_t n = a.size(), i = 0;
+  double s0 = 0., s1 = 0., s2 = 0., s3 = 0.;
+  for (; i + 4 <= n; i += 4) {
+    s0 += a.at(i) * b.at(i);
+    s1 += a.at(i + 1) * b.at(i + 1);
+    s2 += a.at(i + 2) * b.at(i + 2);
+    s3 += a.at(i + 3) * b.at(i + 3);
+  }
+  for (; i < n; ++i) {
+    s0 += a.at(i) * b.at(i);
+  }
+  return (s0 + s1) + (s2 + s3);
+}
+
+// Operators for every mix of vectors and expressions; two plain vectors
+// are covered in vector_ops.h.
+
+template<class L, class R>
+VectorBinaryExpr<L, R, VectorPlus> operator+(const VectorExpr<L> &a, const VectorExpr<R> &b) {
+  return {a.self(), b.self()};
+}
+template<class R>
+VectorBinaryExpr<VectorRef, R, VectorPlus> operator+(const std::vector<double> &a, const VectorExpr<R> &b) {
+  return {a, b.self()};
+}
+template<class L>
+VectorBinaryExpr<L, VectorRef, VectorPlus> operator+(const VectorExpr<L> &a, const std::vector<double> &b) {
+  return {a.self(), b};
+}
+
+template<class L, class R>
+VectorBinaryExpr<L, R, VectorMinus> operator-(const VectorExpr<L> &a, const VectorExpr<R> &b) {
+  return {a.self(), b.self()};
+}
+template<class R>
+VectorBinaryExpr<VectorRef, R, VectorMinus> operator-(const std::vector<double> &a, const VectorExpr<R> &b) {
+  return {a, b.self()};
+}
+template<class L>
+VectorBinaryExpr<L, VectorRef, VectorMinus> operator-(const VectorExpr<L> &a, const std::vector<double> &b) {
+  return {a.self(), b};
+}
+
+template<class E>
+const E &operator+(const VectorExpr<E> &a) {
+  return a.self();
+}
+
+template<class E>
+VectorNegatedExpr<E> operator-(const VectorExpr<E> &a) {
+  return VectorNegatedExpr<E>(a.self());
+}
+
+template<class L, class R>
+double operator*(const VectorExpr<L> &a, const VectorExpr<R> &b) {
+  return reduceDot(a.self(), b.self());
+}
+template<class R>
+double operator*(const std::vector<double> &a, const VectorExpr<R> &b) {
+  return reduceDot(VectorRef(a), b.self());
+}
+template<class L>
+double operator*(const VectorExpr<L> &a, const std::vector<double> &b) {
+  return reduceDot(a.self(), VectorRef(b));
+}
+
+} // namespace task
@@ -3,42 +3,162 @@
 #include <cmath>
 #include <iostream>
 #include <vector>
+#include "kernels.h"
+#include "vec3.h"
+#include "vector_expr.h"
 
 namespace task {
-std::vector<double> operator+(const std::vector<double> &a, const std::vector<double> &b) {
-  std::vector<double> c(a.size());
-  for (size_t i = 0; i < a.size(); ++i) {
-    c[i] = a[i] + b[i];
-  }
-  return c;
+// Binary + and - and unary - are lazy, see vector_expr.h: chains are
+// evaluated in one pass when converted to std::vector<double>, and
+// dot products of expressions in one loop without temporaries.
+VectorBinaryExpr<VectorRef, VectorRef, VectorPlus> operator+(const std::vector<double> &a, const std::vector<double> &b) {
+  return {a, b};
 }
 
-std::vector<double> operator-(const std::vector<double> &a, const std::vector<double> &b) {
-  std::vector<double> c(a.size());
-  for (size_t i = 0; i < a.size(); ++i) {
-    c[i] = a[i] - b[i];
-  }
-  return c;
+VectorBinaryExpr<VectorRef, VectorRef, VectorMinus> operator-(const std::vector<double> &a, const std::vector<double> &b) {
+  return {a, b};
 }
 
 std::vector<double> operator+(const std::vector<double> &a) {
   return a;
 }
 
-std::vector<double> operator-(const std::vector<double> &a) {
-  std::vector<double> c(a.size());
-  for (size_t i = 0; i < a.size(); ++i) {
-    c[i] = -a[i];
-  }
-  return c;
+VectorNegatedExpr<VectorRef> operator-(const std::vector<double> &a) {
+  return VectorNegatedExpr<VectorRef>(a);
+}
+
+// Rvalue operands lend their buffer to the result, so
+// f(x) + y - z allocates nothing beyond what f(x) did.
+std::vector<double> operator+(std::vector<double> &&a, const std::vector<double> &b) {
+  kernels::active().add(a.data(), a.data(), b.data(), a.size());
+  return std::move(a);
+}
+
+std::vector<double> operator+(const std::vector<double> &a, std::vector<double> &&b) {
+  kernels::active().add(b.data(), a.data(), b.data(), b.size());
+  return std::move(b);
+}
+
+std::vector<double> operator+(std::vector<double> &&a, std::vector<double> &&b) {
+  return std::move(a) + b;
+}
+
+std::vector<double> operator-(std::vector<double> &&a, const std::vector<double> &b) {
+  kernels::active().sub(a.data(), a.data(), b.data(), a.size());
+  return std::move(a);
+}
+
+std::vector<double> operator-(const std::vector<double> &a, std::vector<double> &&b) {
+  kernels::active().sub(b.data(), a.data(), b.data(), b.size());
+  return std::move(b);
+}
+
+std::vector<double> operator-(std::vector<double> &&a, std::vector<double> &&b) {
+  return std::move(a) - b;
+}
+
+std::vector<double> operator+(std::vector<double> &&a) {
+  return std::move(a);
+}
+
+std::vector<double> operator-(std::vector<double> &&a) {
+  kernels::active().negate(a.data(), a.data(), a.size());
+  return std::move(a);
+}
+
+template<class E>
+std::vector<double> operator+(std::vector<double> &&a, const VectorExpr<E> &b) {
+  evaluate(VectorRef(a) + b.self(), a.data());
+  return std::move(a);
+}
+
+template<class E>
+std::vector<double> operator+(const VectorExpr<E> &a, std::vector<double> &&b) {
+  evaluate(a.self() + VectorRef(b), b.data());
+  return std::move(b);
+}
+
+template<class E>
+std::vector<double> operator-(std::vector<double> &&a, const VectorExpr<E> &b) {
+  evaluate(VectorRef(a) - b.self(), a.data());
+  return std::move(a);
+}
+
+template<class E>
+std::vector<double> operator-(const VectorExpr<E> &a, std::vector<double> &&b) {
+  evaluate(a.self() - VectorRef(b), b.data());
+  return std::move(b);
+}
+
+// In place.
+std::vector<double> &operator+=(std::vector<double> &a, const std::vector<double> &b) {
+  kernels::active().add(a.data(), a.data(), b.data(), a.size());
+  return a;
+}
+
+std::vector<double> &operator-=(std::vector<double> &a, const std::vector<double> &b) {
+  kernels::active().sub(a.data(), a.data(), b.data(), a.size());
+  return a;
+}
+
+std::vector<double> &operator*=(std::vector<double> &a, double factor) {
+  kernels::active().scale(a.data(), a.data(), factor, a.size());
+  return a;
+}
+
+template<class E>
+std::vector<double> &operator+=(std::vector<double> &a, const VectorExpr<E> &b) {
+  evaluate(VectorRef(a) + b.self(), a.data());
+  return a;
 }
 
+template<class E>
+std::vector<double> &operator-=(std::vector<double> &a, const VectorExpr<E> &b) {
+  evaluate(VectorRef(a) - b.self(), a.data());
+  return a;
+}
+
+// Into caller-owned storage. out is resized to the operands' size, which
+// allocates only if its capacity is too small, so calls on same-length
+// vectors in a loop allocate nothing. out may be one of the operands.
+void addInto(std::vector<double> &out, const std::vector<double> &a, const std::vector<double> &b) {
+  out.resize(a.size());
+  kernels::active().add(out.data(), a.data(), b.data(), a.size());
+}
+
+void subInto(std::vector<double> &out, const std::vector<double> &a, const std::vector<double> &b) {
+  out.resize(a.size());
+  kernels::active().sub(out.data(), a.data(), b.data(), a.size());
+}
+
+void negateInto(std::vector<double> &out, const std::vector<double> &a) {
+  out.resize(a.size());
+  kernels::active().negate(out.data(), a.data(), a.size());
+}
+
+void scaleInto(std::vector<double> &out, const std::vector<double> &a, double factor) {
+  out.resize(a.size());
+  kernels::active().scale(out.data(), a.data(), factor, a.size());
+}
+
+// Any chain, e.g. evaluateInto(out, a + b - c), in one pass.
+template<class E>
+void evaluateInto(std::vector<double> &out, const VectorExpr<E> &expr) {
+  out.resize(expr.size());
+  evaluate(expr.self(), out.data());
+}
+
+// Summed in several partial sums, which is faster and usually more
+// accurate than one running sum.
 double operator*(const std::vector<double> &a, const std::vector<double> &b) {
-  double c = 0;
-  for (size_t i = 0; i < a.size(); ++i) {
-    c += a[i] * b[i];
-  }
-  return c;
+  return kernels::active().dot(a.data(), b.data(), a.size());
+}
+
+// The same as accurately as if computed in twice the precision, for
+// sums with heavy cancellation; two to three times slower while the
+// operands are in cache, about as fast once memory is the limit.
+double compensatedDot(const std::vector<double> &a, const std::vector<double> &b) {
+  return kernels::active().compensated_dot(a.data(), b.data(), a.size());
 }
 
 std::vector<double> operator%(const std::vector<double> &a, const std::vector<double> &b) {
@@ -49,56 +169,65 @@ std::vector<double> operator%(const std::vector<double> &a, const std::vector<do
   return c;
 }
 
-bool operator||(const std::vector<double> &a, const std::vector<double> &b) {
-  int i;
-  int n = a.size();
-  const double EPS = 1e-12;
-  std::vector<double> c(n, 0.);
-  if (a == c || b == c) {
-    return true;
-  }
-  for (i = 0; i < n; ++i) {
-    if (a[i] != 0 && b[i] != 0) {
-      break;
-    }
+// How b lies along a: b = alpha * a with alpha > 0 counts as kSame, as
+// does a zero vector on either side. Ratios are compared to that of the
+// first elements where both are nonzero, to within COLLINEARITY_EPS, and
+// zeros must match; one pass, no allocation.
+enum class Direction { kNone, kSame, kOpposite };
+
+const double COLLINEARITY_EPS = 1e-12;
+
+Direction direction(const std::vector<double> &a, const std::vector<double> &b,
+                    const kernels::Table &table = kernels::active()) {
+  size_t n = a.size(), i = 0;
+  while (i < n && a[i] == 0 && b[i] == 0) {
+    ++i;
   }
   if (i == n) {
-    return false;
+    return Direction::kSame;
   }
-  double alpha = a[i] / b[i];
-  for (size_t j = 0; j < n; ++j) {
-    if ((b[j] == 0 && a[j] != 0) || (a[j] == 0 && b[j] != 0)) {
-      return false;
-    }
-    if ((b[j] != 0) && (fabs(a[j] / b[j] - alpha) >= EPS)) {
-      return false;
+  if (a[i] == 0 || b[i] == 0) {
+    // Collinear only if the vector that is zero here is zero throughout.
+    const std::vector<double> &zero_here = a[i] == 0 ? a : b;
+    for (size_t j = i + 1; j < n; ++j) {
+      if (zero_here[j] != 0) {
+        return Direction::kNone;
+      }
     }
+    return Direction::kSame;
+  }
+  double alpha = a[i] / b[i];
+  if (!table.proportional(a.data() + i + 1, b.data() + i + 1, alpha, COLLINEARITY_EPS, n - i - 1)) {
+    return Direction::kNone;
   }
-  return true;
+  return alpha > 0 ? Direction::kSame : Direction::kOpposite;
 }
 
+bool operator||(const std::vector<double> &a, const std::vector<double> &b) {
+  return direction(a, b) != Direction::kNone;
+}
 
 bool operator&&(const std::vector<double> &a, const std::vector<double> &b) {
-  int n = a.size();
-  std::vector<double> c(n, 0.);
-  int i;
-  if (a == c || b == c) {
-    return true;
-  }
-  for (i = 0; i < n; ++i) {
-    if (a[i] != 0 && b[i] != 0) {
-      break;
-    }
-  }
-  if (i == n) {
-    return false;
+  return direction(a, b) == Direction::kSame;
+}
+
+// a || b[k] and a && b[k] for every k, with the kernels looked up once.
+std::vector<bool> collinearEach(const std::vector<double> &a, const std::vector<std::vector<double>> &b) {
+  const kernels::Table &table = kernels::active();
+  std::vector<bool> result(b.size());
+  for (size_t k = 0; k < b.size(); ++k) {
+    result[k] = direction(a, b[k], table) != Direction::kNone;
   }
-  double alpha = a[i] / b[i];
-  if ((a || b) && (alpha > 0)) {
-    return true;
-  } else {
-    return false;
+  return result;
+}
+
+std::vector<bool> codirectionalEach(const std::vector<double> &a, const std::vector<std::vector<double>> &b) {
+  const kernels::Table &table = kernels::active();
+  std::vector<bool> result(b.size());
+  for (size_t k = 0; k < b.size(); ++k) {
+    result[k] = direction(a, b[k], table) == Direction::kSame;
   }
+  return result;
 }
 
 void reverse(std::vector<double> &a) {
@@ -112,17 +241,13 @@ void reverse(std::vector<double> &a) {
 
 std::vector<int> operator|(const std::vector<int> &a, const std::vector<int> &b) {
   std::vector<int> c(a.size());
-  for (size_t i = 0; i < a.size(); ++i) {
-    c[i] = a[i] | b[i];
-  }
+  kernels::active().bit_or(c.data(), a.data(), b.data(), a.size());
   return c;
 }
 
 std::vector<int> operator&(const std::vector<int> &a, const std::vector<int> &b) {
   std::vector<int> c(a.size());
-  for (size_t i = 0; i < a.size(); ++i) {
-    c[i] = a[i] & b[i];
-  }
+  kernels::active().bit_and(c.data(), a.data(), b.data(), a.size());
   return c;
 }
 
@@ -6,6 +6,8 @@
 #include <valarray>
 #include <sstream>
 #include <cmath>
+#include <cstdlib>
+#include <new>
 #include "src/vector_ops.h"
 
 
@@ -52,6 +54,27 @@ void RandomFillDouble(T& container, size_t count) {
 }
 
 
+// Every heap allocation in the program goes through here, so tests can
+// check that a piece of code allocates nothing.
+size_t allocation_count = 0;
+
+void* operator new(size_t size) {
+    ++allocation_count;
+    if (void* ptr = std::malloc(size == 0 ? 1 : size)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+    std::free(ptr);
+}
+
+
 void FailWithMsg(const std::string& msg, int line) {
     std::cerr << "Test failed!\n";
     std::cerr << "[Line " << line << "] "  << msg << std::endl;
@@ -159,6 +182,301 @@ int main() {
         ASSERT_EQUAL_MSG(vec, valarr, "Bitwise AND")
     }
 
+    for (auto isa : {kernels::Isa::kScalar, kernels::Isa::kAvx2, kernels::Isa::kAvx512}) {
+        if (!kernels::supported(isa)) {
+            continue;
+        }
+        kernels::setActiveIsa(isa);
+        std::string msg = std::string("Kernels, ") + kernels::isaName(isa) + ": ";
+
+        REPEAT(200)
+        {
+            // Lengths around the vector widths and unroll factors.
+            size_t size = RandomUInt(0, 100);
+            std::vector<double> vec, vec2;
+            RandomFillDouble(vec, size);
+            RandomFillDouble(vec2, size);
+            std::valarray<double> valarr(vec.data(), size), valarr2(vec2.data(), size);
+
+            std::vector<double> sum = vec + vec2, diff = vec - vec2, neg = -vec;
+            std::valarray<double> expected_sum = valarr + valarr2, expected_diff = valarr - valarr2, expected_neg = -valarr;
+            ASSERT_EQUAL_MSG(sum, expected_sum, msg + "Binary +")
+            ASSERT_EQUAL_MSG(diff, expected_diff, msg + "Binary -")
+            ASSERT_EQUAL_MSG(neg, expected_neg, msg + "Unary -")
+
+            double expected = (valarr * valarr2).sum(), magnitude = (std::abs(valarr) * std::abs(valarr2)).sum();
+            ASSERT_TRUE_MSG(fabs(vec * vec2 - expected) <= 1e-14 * magnitude, msg + "Dot product")
+            ASSERT_TRUE_MSG(fabs(compensatedDot(vec, vec2) - expected) <= 1e-14 * magnitude, msg + "Compensated dot product")
+
+            std::vector<int> ints, ints2;
+            RandomFill(ints, size);
+            RandomFill(ints2, size);
+            std::valarray<int> intarr(ints.data(), size), intarr2(ints2.data(), size);
+            auto bit_or = ints | ints2, bit_and = ints & ints2;
+            std::valarray<int> expected_or = intarr | intarr2, expected_and = intarr & intarr2;
+            ASSERT_EQUAL_MSG(bit_or, expected_or, msg + "Bitwise OR")
+            ASSERT_EQUAL_MSG(bit_and, expected_and, msg + "Bitwise AND")
+        }
+
+        REPEAT(20)
+        {
+            // Pairs of huge terms that cancel exactly, around small integer
+            // terms: the result is the sum of the small ones, which plain
+            // summation loses entirely.
+            size_t size = RandomUInt(1, 300);
+            std::vector<double> vec, ones;
+            double exact = 0.;
+            for (size_t i = 0; i < size; ++i) {
+                double big = RandomDouble() * 1e17, small = static_cast<double>(RandomUInt(10));
+                vec.insert(vec.end(), {big, small, -big});
+                exact += small;
+            }
+            std::shuffle(vec.begin(), vec.end(), std::mt19937(RandomUInt()));
+            ones.assign(vec.size(), 1.);
+            ASSERT_TRUE_MSG(fabs(compensatedDot(vec, ones) - exact) < 1e-6, msg + "Compensated dot product with cancellation")
+        }
+
+        REPEAT(200)
+        {
+            // Lengths across the kernels' blocks, with zeros shared by both
+            // vectors, and one element moved, zeroed or left alone.
+            size_t size = RandomUInt(1, 600);
+            std::vector<double> vec, vec2;
+            RandomFillDouble(vec, size);
+            for (auto& item : vec) {
+                if (RandomUInt(4) == 0) {
+                    item = 0.;
+                }
+            }
+            double mult = RandomDouble();
+            if (mult == 0.) {
+                mult = 1.;
+            }
+            for (auto item : vec) {
+                vec2.push_back(item * mult);
+            }
+            size_t before = allocation_count;
+            bool collinear = vec || vec2, codirectional = vec && vec2;
+            ASSERT_TRUE_MSG(allocation_count == before, msg + "Collinearity operators must not allocate")
+            ASSERT_TRUE_MSG(collinear, msg + "Collinearity operator")
+            ASSERT_TRUE_MSG(codirectional == (mult > 0 || std::all_of(vec.begin(), vec.end(), [](double x) { return x == 0.; })),
+                            msg + "Codirectionality operator")
+
+            // Moving one element breaks collinearity unless it is the only
+            // nonzero one; zeroing it in both keeps it.
+            size_t index = RandomUInt(size - 1);
+            size_t nonzero = std::count_if(vec.begin(), vec.end(), [](double x) { return x != 0.; });
+            bool expected;
+            if (TossCoin()) {
+                if (vec2[index] == 0.) {
+                    vec2[index] = 1.;
+                    expected = nonzero == 0;
+                } else {
+                    vec2[index] *= 1. + 1e-6;
+                    expected = nonzero == 1;
+                }
+            } else {
+                vec[index] = vec2[index] = 0.;
+                expected = true;
+            }
+            bool vec_zero = std::all_of(vec.begin(), vec.end(), [](double x) { return x == 0.; });
+            ASSERT_TRUE_MSG((vec || vec2) == expected, msg + "Collinearity operator after a change")
+            ASSERT_TRUE_MSG((vec && vec2) == (expected && (mult > 0 || vec_zero)), msg + "Codirectionality operator after a change")
+
+            std::vector<std::vector<double>> many = {vec2, vec, -vec, std::vector<double>(size, 0.), vec2 + vec};
+            std::vector<bool> collinear_each = collinearEach(vec, many), codirectional_each = codirectionalEach(vec, many);
+            for (size_t k = 0; k < many.size(); ++k) {
+                ASSERT_TRUE_MSG(collinear_each[k] == (vec || many[k]), msg + "collinearEach")
+                ASSERT_TRUE_MSG(codirectional_each[k] == (vec && many[k]), msg + "codirectionalEach")
+            }
+        }
+
+        REPEAT(100)
+        {
+            // Batches against Vec3, which may round multiply-adds differently,
+            // and Vec3 against std::vector.
+            size_t size = RandomUInt(0, 100);
+            Vec3Array vecs(size), vecs2(size), crosses(size);
+            std::vector<double> dots(size), norms(size);
+            for (size_t i = 0; i < size; ++i) {
+                vecs.set(i, {RandomDouble(), RandomDouble(), RandomDouble()});
+                vecs2.set(i, {RandomDouble(), RandomDouble(), RandomDouble()});
+            }
+
+            size_t before = allocation_count;
+            cross(vecs.span(), vecs2.span(), crosses.span());
+            dot(vecs.span(), vecs2.span(), dots.data());
+            norm(vecs.span(), norms.data());
+            Vec3 sum = {0., 0., 0.};
+            for (size_t i = 0; i < size; ++i) {
+                sum = sum + vecs.get(i) % vecs2.get(i) * 2. - -vecs.get(i);
+            }
+            ASSERT_TRUE_MSG(allocation_count == before, msg + "Vec3 and batches must not allocate")
+
+            for (size_t i = 0; i < size; ++i) {
+                Vec3 a = vecs.get(i), b = vecs2.get(i);
+                Vec3 diff = crosses.get(i) - a % b;
+                ASSERT_TRUE_MSG(norm(diff) <= 1e-14 * norm(a) * norm(b), msg + "Batch cross product")
+                ASSERT_TRUE_MSG(fabs(dots[i] - a * b) <= 1e-14 * norm(a) * norm(b), msg + "Batch dot product")
+                ASSERT_TRUE_MSG(fabs(norms[i] - norm(a)) <= 1e-14 * norm(a), msg + "Batch norm")
+
+                std::vector<double> vec = {a.x, a.y, a.z}, vec2 = {b.x, b.y, b.z};
+                std::vector<double> vec_cross = vec % vec2, vec_sum = vec + vec2, vec_diff = vec - vec2;
+                Vec3 c = a % b, d = a + b, e = a - b;
+                ASSERT_TRUE_MSG(c.x == vec_cross[0] && c.y == vec_cross[1] && c.z == vec_cross[2], msg + "Vec3 cross product")
+                ASSERT_TRUE_MSG(d.x == vec_sum[0] && d.y == vec_sum[1] && d.z == vec_sum[2], msg + "Vec3 binary +")
+                ASSERT_TRUE_MSG(e.x == vec_diff[0] && e.y == vec_diff[1] && e.z == vec_diff[2], msg + "Vec3 binary -")
+                ASSERT_TRUE_MSG(fabs(a * b - vec * vec2) < EPS, msg + "Vec3 dot product")
+                ASSERT_TRUE_MSG(fabs(c * a) < EPS && fabs(c * b) < EPS, msg + "Vec3 cross product is orthogonal")
+            }
+
+            // The result may replace an operand.
+            Vec3Array copy = vecs, reversed(size);
+            cross(vecs2.span(), copy.span(), reversed.span());
+            cross(vecs.span(), vecs2.span(), vecs.span());
+            for (size_t i = 0; i < size; ++i) {
+                ASSERT_TRUE_MSG(vecs.get(i) == crosses.get(i), msg + "Batch cross product into an operand")
+            }
+            cross(vecs2.span(), copy.span(), copy.span());
+            for (size_t i = 0; i < size; ++i) {
+                ASSERT_TRUE_MSG(copy.get(i) == reversed.get(i), msg + "Batch cross product into the second operand")
+            }
+        }
+    }
+    kernels::setActiveIsa(kernels::detectedIsa());
+
+    REPEAT(100)
+    {
+        // Lazy chains against valarray, which evaluates one operator at
+        // a time; one-pass evaluation must round the same way.
+        size_t size = RandomUInt(0, 100);
+        std::vector<double> vec, vec2, vec3;
+        RandomFillDouble(vec, size);
+        RandomFillDouble(vec2, size);
+        RandomFillDouble(vec3, size);
+        std::valarray<double> valarr(vec.data(), size), valarr2(vec2.data(), size), valarr3(vec3.data(), size);
+
+        std::vector<double> chain = vec + vec2 - vec3, nested = -(vec - vec2) + -vec3, grouped = vec - (vec2 + vec3);
+        std::valarray<double> expected_chain = valarr + valarr2 - valarr3, expected_nested = -(valarr - valarr2) + -valarr3,
+                              expected_grouped = valarr - (valarr2 + valarr3);
+        ASSERT_EQUAL_MSG(chain, expected_chain, "Expression a + b - c")
+        ASSERT_EQUAL_MSG(nested, expected_nested, "Expression -(a - b) + -c")
+        ASSERT_EQUAL_MSG(grouped, expected_grouped, "Expression a - (b + c)")
+
+        std::vector<double> temporary = std::vector<double>(vec) + vec2 - std::vector<double>(vec3);
+        ASSERT_EQUAL_MSG(temporary, expected_chain, "Expression over temporaries")
+
+        double expected = ((valarr - valarr2) * (valarr - valarr2)).sum(), magnitude = expected;
+        ASSERT_TRUE_MSG(fabs((vec - vec2) * (vec - vec2) - expected) <= 1e-14 * magnitude, "Dot product of expressions")
+        expected = (valarr * (valarr2 + valarr3)).sum();
+        magnitude = (std::abs(valarr) * (std::abs(valarr2) + std::abs(valarr3))).sum();
+        ASSERT_TRUE_MSG(fabs(vec * (vec2 + vec3) - expected) <= 1e-14 * magnitude, "Dot product of vector and expression")
+        ASSERT_TRUE_MSG(fabs((vec2 + vec3) * vec - expected) <= 1e-14 * magnitude, "Dot product of expression and vector")
+        ASSERT_TRUE_MSG(fabs(compensatedDot(vec, vec2 + vec3) - expected) <= 1e-14 * magnitude, "Compensated dot product of expression")
+
+        // The result may be an operand.
+        vec = vec + vec2 - vec;
+        valarr = valarr + valarr2 - valarr;
+        ASSERT_EQUAL_MSG(vec, valarr, "Expression assigned to an operand")
+        vec2 = -vec2;
+        valarr2 = -valarr2;
+        ASSERT_EQUAL_MSG(vec2, valarr2, "Negation assigned to its operand")
+    }
+
+    REPEAT(100)
+    {
+        size_t size = RandomUInt(0, 100);
+        std::vector<double> vec, vec2, vec3;
+        RandomFillDouble(vec, size);
+        RandomFillDouble(vec2, size);
+        RandomFillDouble(vec3, size);
+        std::valarray<double> valarr(vec.data(), size), valarr2(vec2.data(), size), valarr3(vec3.data(), size);
+        double factor = RandomDouble();
+
+        std::vector<double> out = vec;
+        std::valarray<double> expected = valarr;
+        out += vec2;
+        expected += valarr2;
+        ASSERT_EQUAL_MSG(out, expected, "Operator +=")
+        out -= vec3;
+        expected -= valarr3;
+        ASSERT_EQUAL_MSG(out, expected, "Operator -=")
+        out *= factor;
+        expected *= factor;
+        ASSERT_EQUAL_MSG(out, expected, "Operator *=")
+        out += vec2 - vec3;
+        expected += valarr2 - valarr3;
+        ASSERT_EQUAL_MSG(out, expected, "Operator += with an expression")
+        out -= -vec;
+        expected -= -valarr;
+        ASSERT_EQUAL_MSG(out, expected, "Operator -= with an expression")
+
+        std::vector<double> into(RandomUInt(0, 100), 1.);
+        addInto(into, vec, vec2);
+        expected = valarr + valarr2;
+        ASSERT_EQUAL_MSG(into, expected, "addInto")
+        subInto(into, into, vec3);
+        expected -= valarr3;
+        ASSERT_EQUAL_MSG(into, expected, "subInto into an operand")
+        negateInto(into, into);
+        expected = -expected;
+        ASSERT_EQUAL_MSG(into, expected, "negateInto into its operand")
+        scaleInto(into, vec, factor);
+        expected = valarr * factor;
+        ASSERT_EQUAL_MSG(into, expected, "scaleInto")
+        evaluateInto(into, vec + vec2 - vec3);
+        expected = valarr + valarr2 - valarr3;
+        ASSERT_EQUAL_MSG(into, expected, "evaluateInto")
+
+        // Rvalue operands, on either side.
+        std::vector<double> moved = std::vector<double>(vec) + vec2 - vec3;
+        ASSERT_EQUAL_MSG(moved, expected, "Binary + and - reusing an rvalue")
+        moved = vec - (std::vector<double>(vec2) + vec3);
+        expected = valarr - (valarr2 + valarr3);
+        ASSERT_EQUAL_MSG(moved, expected, "Binary - into a right-hand rvalue")
+        moved = (vec + vec2) - std::vector<double>(vec3);
+        expected = valarr + valarr2 - valarr3;
+        ASSERT_EQUAL_MSG(moved, expected, "Expression minus an rvalue")
+        moved = std::vector<double>(vec) - (vec2 - vec3);
+        expected = valarr - (valarr2 - valarr3);
+        ASSERT_EQUAL_MSG(moved, expected, "Rvalue minus an expression")
+        moved = -std::vector<double>(vec) + std::vector<double>(vec2);
+        expected = -valarr + valarr2;
+        ASSERT_EQUAL_MSG(moved, expected, "Unary - and binary + of rvalues")
+    }
+
+    {
+        // A hot loop over same-length vectors, once its storage exists.
+        std::vector<double> vec, vec2, vec3;
+        RandomFillDouble(vec, 1000);
+        RandomFillDouble(vec2, vec.size());
+        RandomFillDouble(vec3, vec.size());
+        std::vector<double> out(vec.size()), acc(vec.size());
+        double sum = 0.;
+
+        size_t before = allocation_count;
+        REPEAT(100)
+        {
+            addInto(out, vec, vec2);
+            subInto(out, out, vec3);
+            negateInto(out, out);
+            scaleInto(out, out, 0.5);
+            evaluateInto(out, vec + vec2 - vec3);
+            out += vec;
+            out -= vec2 - vec3;
+            out *= 0.5;
+            acc = std::move(acc) + out - vec;
+            acc = -std::move(acc);
+            sum += (out - vec) * (out + vec2) + out * vec + compensatedDot(out, vec);
+        }
+        ASSERT_TRUE_MSG(allocation_count == before, "In-place and into variants must not allocate")
+        ASSERT_TRUE_MSG(std::isfinite(sum), "In-place and into variants")
+
+        before = allocation_count;
+        std::vector<double> result = vec + vec2 - vec3;
+        ASSERT_TRUE_MSG(allocation_count == before + 1, "A chain allocates only its result")
+    }
+
     REPEAT(100)
     {
         std::vector<double> vec, vec2;